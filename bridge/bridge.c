@@ -28,6 +28,7 @@ int compress_vlans;
 int json;
 int timestamp;
 static const char *batch_file;
+static const char *server_path;
 int force;
 
 static void usage(void) __attribute__((noreturn));
@@ -37,10 +38,12 @@ static void usage(void)
 	fprintf(stderr,
 "Usage: bridge [ OPTIONS ] OBJECT { COMMAND | help }\n"
 "       bridge [ -force ] -batch filename\n"
+"       bridge -server socket\n"
 "where	OBJECT := { link | fdb | mdb | vlan | monitor }\n"
 "	OPTIONS := { -V[ersion] | -s[tatistics] | -d[etails] |\n"
 "		     -o[neline] | -t[imestamp] | -n[etns] name |\n"
-"		     -c[ompressvlans] -color -p[retty] -j[son] }\n");
+"		     -c[ompressvlans] -color -p[retty] -j[son] -cb[or] |\n"
+"		     -rc[vbuf] [size] }\n");
 	exit(-1);
 }
 
@@ -63,14 +66,14 @@ static const struct cmd {
 	{ 0 }
 };
 
+static struct keyword_index cmds_index = KEYWORD_INDEX(cmds);
+
 static int do_cmd(const char *argv0, int argc, char **argv)
 {
-	const struct cmd *c;
+	int i = keyword_lookup(&cmds_index, argv0);
 
-	for (c = cmds; c->cmd; ++c) {
-		if (matches(argv0, c->cmd) == 0)
-			return c->func(argc-1, argv+1);
-	}
+	if (i >= 0)
+		return cmds[i].func(argc-1, argv+1);
 
 	fprintf(stderr,
 		"Object \"%s\" is unknown, try \"bridge help\".\n", argv0);
@@ -99,6 +102,17 @@ static int batch(const char *name)
 	return ret;
 }
 
+static int server_init(void *data)
+{
+	if (rtnl_open(&rth, 0) < 0) {
+		fprintf(stderr, "Cannot open rtnetlink\n");
+		return -1;
+	}
+
+	rtnl_set_strict_dump(&rth);
+	return 0;
+}
+
 int
 main(int argc, char **argv)
 {
@@ -152,6 +166,9 @@ main(int argc, char **argv)
 		} else if (matches(opt, "-compressvlans") == 0) {
 			++compress_vlans;
 		} else if (matches_color(opt, &color)) {
+		} else if (matches(opt, "-cbor") == 0) {
+			++json;
+			cbor = 1;
 		} else if (matches(opt, "-force") == 0) {
 			++force;
 		} else if (matches(opt, "-json") == 0) {
@@ -164,6 +181,26 @@ main(int argc, char **argv)
 			if (argc <= 1)
 				usage();
 			batch_file = argv[1];
+		} else if (matches(opt, "-server") == 0) {
+			argc--;
+			argv++;
+			if (argc <= 1)
+				usage();
+			server_path = argv[1];
+		} else if (matches(opt, "-rcvbuf") == 0) {
+			unsigned int size;
+
+			argc--;
+			argv++;
+			if (argc <= 1)
+				usage();
+			if (get_unsigned(&size, argv[1], 0)) {
+				fprintf(stderr, "Invalid rcvbuf size '%s'\n",
+					argv[1]);
+				exit(-1);
+			}
+			rcvbuf = size;
+			rcvbuf_force = 1;
 		} else {
 			fprintf(stderr,
 				"Option \"%s\" is unknown, try \"bridge help\".\n",
@@ -180,6 +217,9 @@ main(int argc, char **argv)
 	if (batch_file)
 		return batch(batch_file);
 
+	if (server_path)
+		return do_server(server_path, server_init, br_batch_cmd, NULL);
+
 	if (rtnl_open(&rth, 0) < 0)
 		exit(1);
 
@@ -31,7 +31,7 @@ static int prefix_banner;
 
 static void usage(void)
 {
-	fprintf(stderr, "Usage: bridge monitor [file | link | fdb | mdb | vlan | all]\n");
+	fprintf(stderr, "Usage: bridge monitor [file | link | fdb | mdb | vlan | all] [stats]\n");
 	exit(-1);
 }
 
@@ -46,6 +46,7 @@ static int accept_msg(struct rtnl_ctrl_data *ctrl,
 	switch (n->nlmsg_type) {
 	case RTM_NEWLINK:
 	case RTM_DELLINK:
+		ll_remember_index(n, NULL);
 		if (prefix_banner)
 			fprintf(fp, "[LINK]");
 
@@ -86,6 +87,7 @@ int do_monitor(int argc, char **argv)
 	int lneigh = 0;
 	int lmdb = 0;
 	int lvlan = 0;
+	int lstats = 0;
 
 	rtnl_close(&rth);
 
@@ -109,6 +111,8 @@ int do_monitor(int argc, char **argv)
 			groups = ~RTMGRP_TC;
 			lvlan = 1;
 			prefix_banner = 1;
+		} else if (strcmp(*argv, "stats") == 0) {
+			lstats = 1;
 		} else if (matches(*argv, "help") == 0) {
 			usage();
 		} else {
@@ -138,7 +142,9 @@ int do_monitor(int argc, char **argv)
 			perror("Cannot fopen");
 			exit(-1);
 		}
+		new_json_obj(json);
 		err = rtnl_from_file(fp, accept_msg, stdout);
+		delete_json_obj();
 		fclose(fp);
 		return err;
 	}
@@ -153,8 +159,12 @@ int do_monitor(int argc, char **argv)
 
 	ll_init_map(&rth);
 
-	if (rtnl_listen(&rth, accept_msg, stdout) < 0)
+	if (lstats) {
+		if (rtnl_listen_counted(&rth, accept_msg, stdout) < 0)
+			exit(2);
+	} else if (rtnl_listen(&rth, accept_msg, stdout) < 0) {
 		exit(2);
+	}
 
 	return 0;
 }
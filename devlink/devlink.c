@@ -18,6 +18,7 @@
 #include <getopt.h>
 #include <limits.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <inttypes.h>
 #include <signal.h>
 #include <time.h>
@@ -43,6 +44,7 @@
 #include "json_print.h"
 #include "utils.h"
 #include "namespace.h"
+#include "ll_map.h"
 
 #define ESWITCH_MODE_LEGACY "legacy"
 #define ESWITCH_MODE_SWITCHDEV "switchdev"
@@ -199,8 +201,85 @@ static int _mnlg_socket_group_add(struct mnlu_gen_socket *nlg,
 	return 0;
 }
 
+/* Periodic sampling for the watch commands. The loop sleeps to absolute
+ * deadlines so that the time spent sampling does not skew the interval,
+ * and stops on SIGINT. The handler restarts system calls, so a sample in
+ * progress completes and the loop ends at the next dl_watch_running().
+ */
+#define DL_WATCH_INTERVAL_DEFAULT	1000
+
+struct dl_watch {
+	struct timespec start;
+	struct timespec next;
+	uint32_t interval;	/* msec */
+	struct sigaction oact;
+};
+
+static volatile sig_atomic_t dl_watch_stopped;
+
+static void dl_watch_sig_handler(int signum)
+{
+	dl_watch_stopped = 1;
+}
+
+static void dl_watch_start(struct dl_watch *watch, uint32_t interval)
+{
+	struct sigaction act;
+
+	dl_watch_stopped = 0;
+	act.sa_handler = dl_watch_sig_handler;
+	sigemptyset(&act.sa_mask);
+	act.sa_flags = SA_RESTART;
+	sigaction(SIGINT, &act, &watch->oact);
+
+	watch->interval = interval;
+	clock_gettime(CLOCK_MONOTONIC, &watch->start);
+	watch->next = watch->start;
+}
+
+static void dl_watch_end(struct dl_watch *watch)
+{
+	sigaction(SIGINT, &watch->oact, NULL);
+}
+
+static bool dl_watch_running(void)
+{
+	return !dl_watch_stopped;
+}
+
+/* a sample cut short by the stop request is not an error */
+static int dl_watch_sample_err(int err)
+{
+	return dl_watch_stopped && err == -EINTR ? 0 : err;
+}
+
+static void dl_watch_sleep(struct dl_watch *watch)
+{
+	watch->next.tv_sec += watch->interval / 1000;
+	watch->next.tv_nsec += (watch->interval % 1000) * 1000000;
+	if (watch->next.tv_nsec >= 1000000000) {
+		watch->next.tv_sec++;
+		watch->next.tv_nsec -= 1000000000;
+	}
+	while (!dl_watch_stopped &&
+	       clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME,
+			       &watch->next, NULL) == EINTR)
+		;
+}
+
+static uint64_t dl_watch_elapsed_ms(const struct dl_watch *watch)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - watch->start.tv_sec) * 1000 +
+	       (now.tv_nsec - watch->start.tv_nsec) / 1000000;
+}
+
 struct ifname_map {
 	struct list_head list;
+	struct hlist_node ifname_hash;
+	struct hlist_node handle_hash;
 	char *bus_name;
 	char *dev_name;
 	uint32_t port_index;
@@ -286,9 +365,15 @@ static void ifname_map_free(struct ifname_map *ifname_map)
 #define DL_OPT_PORT_PFNUMBER BIT(43)
 #define DL_OPT_PORT_SFNUMBER BIT(44)
 #define DL_OPT_PORT_FUNCTION_STATE BIT(45)
+#define DL_OPT_REGION_FILE_NAME	BIT(46)
+#define DL_OPT_INTERVAL		BIT(47)
+#define DL_OPT_COUNT		BIT(48)
+#define DL_OPT_TOP		BIT(49)
+#define DL_OPT_DPIPE_COMPACT	BIT(50)
 
 struct dl_opts {
 	uint64_t present; /* flags of present items */
+	uint64_t parsed; /* flags of items given on the command line */
 	char *bus_name;
 	char *dev_name;
 	uint32_t port_index;
@@ -317,6 +402,10 @@ struct dl_opts {
 	uint32_t region_snapshot_id;
 	uint64_t region_address;
 	uint64_t region_length;
+	const char *region_file_name;
+	uint32_t interval;
+	uint32_t count;
+	uint32_t top;
 	const char *flash_file_name;
 	const char *flash_component;
 	const char *reporter_name;
@@ -342,9 +431,31 @@ struct dl_opts {
 	uint8_t port_fn_state;
 };
 
+#define IFNAME_MAP_HASH_SIZE	1024
+
+#define DL_BATCH_WINDOW		64
+
+struct dl_batch_req {
+	unsigned int seq;
+	int lineno;
+};
+
+struct dl_batch {
+	const char *name;
+	char *recv_buf;
+	unsigned int seq;
+	struct dl_batch_req reqs[DL_BATCH_WINDOW];
+	unsigned int head;
+	unsigned int count;
+	bool failed;
+};
+
 struct dl {
 	struct mnlu_gen_socket nlg;
 	struct list_head ifname_map_list;
+	struct hlist_head ifname_map_ifname_head[IFNAME_MAP_HASH_SIZE];
+	struct hlist_head ifname_map_handle_head[IFNAME_MAP_HASH_SIZE];
+	bool ifname_map_loaded;
 	int argc;
 	char **argv;
 	bool no_nice_names;
@@ -359,8 +470,120 @@ struct dl {
 		char *dev_name;
 		uint32_t port_index;
 	} arr_last;
+	struct dl_batch batch;
 };
 
+/* In batch mode with -force, requests which only expect an ACK are sent
+ * without waiting for it. Each one gets its own sequence number so that
+ * the ACKs, which the kernel queues in order, can be mapped back to the
+ * batch line that produced them. The window bounds the number of ACKs
+ * queued on the socket so that its receive buffer never overruns.
+ */
+static bool dl_batch_pipelined(struct dl *dl)
+{
+	return dl->batch.recv_buf;
+}
+
+static int dl_batch_ack_process(struct dl *dl, const struct nlmsghdr *nlh)
+{
+	const struct nlmsgerr *nlerr = mnl_nlmsg_get_payload(nlh);
+	struct dl_batch *batch = &dl->batch;
+	unsigned int i;
+
+	for (i = 0; i < batch->count; i++) {
+		struct dl_batch_req *req;
+
+		req = &batch->reqs[(batch->head + i) % DL_BATCH_WINDOW];
+		if (req->seq != nlh->nlmsg_seq)
+			continue;
+
+		/* ACKs come in the order the requests were sent. */
+		batch->head = (batch->head + i + 1) % DL_BATCH_WINDOW;
+		batch->count -= i + 1;
+		if (!nlerr->error)
+			return 0;
+
+		errno = nlerr->error < 0 ? -nlerr->error : nlerr->error;
+		nl_dump_ext_ack(nlh, NULL);
+		fprintf(stderr, "kernel answers: %s\n", strerror(errno));
+		fprintf(stderr, "Command failed %s:%d\n",
+			batch->name, req->lineno);
+		return -errno;
+	}
+	return 0;
+}
+
+static int dl_batch_flush(struct dl *dl)
+{
+	unsigned int portid = mnl_socket_get_portid(dl->nlg.nl);
+	struct dl_batch *batch = &dl->batch;
+	int ret = 0;
+
+	while (batch->count) {
+		const struct nlmsghdr *nlh;
+		int len;
+
+		len = mnl_socket_recvfrom(dl->nlg.nl, batch->recv_buf,
+					  MNL_SOCKET_BUFFER_SIZE);
+		if (len <= 0) {
+			pr_err("Failed to receive batch answers: %s\n",
+			       strerror(errno));
+			batch->count = 0;
+			return -errno;
+		}
+
+		nlh = (const struct nlmsghdr *)batch->recv_buf;
+		for (; mnl_nlmsg_ok(nlh, len); nlh = mnl_nlmsg_next(nlh, &len)) {
+			if (nlh->nlmsg_pid != portid ||
+			    nlh->nlmsg_type != NLMSG_ERROR)
+				continue;
+			if (dl_batch_ack_process(dl, nlh))
+				ret = -EINVAL;
+		}
+	}
+	if (ret)
+		batch->failed = true;
+	return ret;
+}
+
+static int dl_batch_send(struct dl *dl, struct nlmsghdr *nlh)
+{
+	struct dl_batch *batch = &dl->batch;
+	struct dl_batch_req *req;
+	int err;
+
+	if (batch->count == DL_BATCH_WINDOW)
+		dl_batch_flush(dl);
+
+	nlh->nlmsg_seq = ++batch->seq;
+	err = mnl_socket_sendto(dl->nlg.nl, nlh, nlh->nlmsg_len);
+	if (err < 0) {
+		perror("Failed to send data");
+		return -errno;
+	}
+
+	req = &batch->reqs[(batch->head + batch->count) % DL_BATCH_WINDOW];
+	req->seq = nlh->nlmsg_seq;
+	req->lineno = cmdlineno;
+	batch->count++;
+	return 0;
+}
+
+/* Every request of the tool goes through here. Anything that is not
+ * pipelined first collects the outstanding ACKs, so that its own answer
+ * is the next thing on the socket.
+ */
+static int dl_sndrcv(struct dl *dl, struct nlmsghdr *nlh,
+		     mnl_cb_t data_cb, void *data)
+{
+	if (dl_batch_pipelined(dl)) {
+		if (!data_cb && !(nlh->nlmsg_flags & NLM_F_DUMP))
+			return dl_batch_send(dl, nlh);
+		dl_batch_flush(dl);
+	}
+	return mnlu_gen_socket_sndrcv(&dl->nlg, nlh, data_cb, data);
+}
+
 static int dl_argc(struct dl *dl)
 {
 	return dl->argc;
@@ -747,6 +970,23 @@ static int function_attr_cb(const struct nlattr *attr, void *data)
 	return MNL_CB_OK;
 }
 
+static unsigned int ifname_map_ifname_hash(const char *ifname)
+{
+	return namehash(ifname) & (IFNAME_MAP_HASH_SIZE - 1);
+}
+
+static unsigned int ifname_map_handle_hash(const char *bus_name,
+					   const char *dev_name,
+					   uint32_t port_index)
+{
+	unsigned int hash;
+
+	hash = namehash(bus_name);
+	hash = hash * 33 + namehash(dev_name);
+	hash = hash * 33 + port_index;
+	return hash & (IFNAME_MAP_HASH_SIZE - 1);
+}
+
 static int ifname_map_cb(const struct nlmsghdr *nlh, void *data)
 {
 	struct nlattr *tb[DEVLINK_ATTR_MAX + 1] = {};
@@ -757,6 +997,7 @@ static int ifname_map_cb(const struct nlmsghdr *nlh, void *data)
 	const char *dev_name;
 	uint32_t port_ifindex;
 	const char *port_ifname;
+	unsigned int h;
 
 	mnl_attr_parse(nlh, sizeof(*genl), attr_cb, tb);
 	if (!tb[DEVLINK_ATTR_BUS_NAME] || !tb[DEVLINK_ATTR_DEV_NAME] ||
@@ -776,6 +1017,13 @@ static int ifname_map_cb(const struct nlmsghdr *nlh, void *data)
 		return MNL_CB_ERROR;
 	list_add(&ifname_map->list, &dl->ifname_map_list);
 
+	h = ifname_map_ifname_hash(port_ifname);
+	hlist_add_head(&ifname_map->ifname_hash,
+		       &dl->ifname_map_ifname_head[h]);
+	h = ifname_map_handle_hash(bus_name, dev_name, port_ifindex);
+	hlist_add_head(&ifname_map->handle_hash,
+		       &dl->ifname_map_handle_head[h]);
+
 	return MNL_CB_OK;
 }
 
@@ -786,27 +1034,84 @@ static void ifname_map_fini(struct dl *dl)
 	list_for_each_entry_safe(ifname_map, tmp,
 				 &dl->ifname_map_list, list) {
 		list_del(&ifname_map->list);
+		hlist_del(&ifname_map->ifname_hash);
+		hlist_del(&ifname_map->handle_hash);
 		ifname_map_free(ifname_map);
 	}
+	dl->ifname_map_loaded = false;
 }
 
-static int ifname_map_init(struct dl *dl)
+static void ifname_map_init(struct dl *dl)
 {
+	INIT_LIST_HEAD(&dl->ifname_map_list);
+	memset(dl->ifname_map_ifname_head, 0,
+	       sizeof(dl->ifname_map_ifname_head));
+	memset(dl->ifname_map_handle_head, 0,
+	       sizeof(dl->ifname_map_handle_head));
+	dl->ifname_map_loaded = false;
+}
+
+/* The map is only needed to translate between netdev names and port
+ * handles, so the port dump is deferred until the first command that
+ * actually does that. It uses a private buffer so that a request already
+ * prepared in the socket buffer survives, but it must not be called from
+ * within a dump callback.
+ */
+static int ifname_map_load(struct dl *dl)
+{
+	struct genlmsghdr hdr = {};
 	struct nlmsghdr *nlh;
+	char *buf;
 	int err;
 
-	INIT_LIST_HEAD(&dl->ifname_map_list);
+	if (dl->ifname_map_loaded)
+		return 0;
 
+	if (dl_batch_pipelined(dl))
+		dl_batch_flush(dl);
 
-	nlh = mnlu_gen_socket_cmd_prepare(&dl->nlg, DEVLINK_CMD_PORT_GET,
-			       NLM_F_REQUEST | NLM_F_ACK | NLM_F_DUMP);
+	buf = malloc(MNL_SOCKET_BUFFER_SIZE);
+	if (!buf)
+		return -ENOMEM;
 
-	err = mnlu_gen_socket_sndrcv(&dl->nlg, nlh, ifname_map_cb, dl);
-	if (err) {
-		ifname_map_fini(dl);
-		return err;
+	hdr.cmd = DEVLINK_CMD_PORT_GET;
+	hdr.version = dl->nlg.version;
+	nlh = mnlu_msg_prepare(buf, dl->nlg.family,
+			       NLM_F_REQUEST | NLM_F_ACK | NLM_F_DUMP,
+			       &hdr, sizeof(hdr));
+
+	err = mnl_socket_sendto(dl->nlg.nl, nlh, nlh->nlmsg_len);
+	if (err < 0) {
+		err = -errno;
+		goto err_out;
 	}
+
+	err = mnlu_socket_recv_run(dl->nlg.nl, nlh->nlmsg_seq, buf,
+				   MNL_SOCKET_BUFFER_SIZE, ifname_map_cb, dl);
+	if (err < 0) {
+		err = -errno;
+		goto err_out;
+	}
+
+	free(buf);
+	dl->ifname_map_loaded = true;
 	return 0;
+
+err_out:
+	pr_err("Failed to create index map\n");
+	ifname_map_fini(dl);
+	free(buf);
+	return err;
+}
+
+/* Load the map upfront for commands printing port handles by netdev name,
+ * so that ifname_map_rev_lookup() does not need to dump from a callback.
+ */
+static int ifname_map_nice_names_load(struct dl *dl)
+{
+	if (dl->no_nice_names)
+		return 0;
+	return ifname_map_load(dl);
 }
 
 static int ifname_map_lookup(struct dl *dl, const char *ifname,
@@ -814,8 +1119,16 @@ static int ifname_map_lookup(struct dl *dl, const char *ifname,
 			     uint32_t *p_port_index)
 {
 	struct ifname_map *ifname_map;
+	unsigned int h;
+	int err;
+
+	err = ifname_map_load(dl);
+	if (err)
+		return err;
 
-	list_for_each_entry(ifname_map, &dl->ifname_map_list, list) {
+	h = ifname_map_ifname_hash(ifname);
+	hlist_for_each_entry(ifname_map, &dl->ifname_map_ifname_head[h],
+			     ifname_hash) {
 		if (strcmp(ifname, ifname_map->ifname) == 0) {
 			*p_bus_name = ifname_map->bus_name;
 			*p_dev_name = ifname_map->dev_name;
@@ -831,11 +1144,17 @@ static int ifname_map_rev_lookup(struct dl *dl, const char *bus_name,
 				 char **p_ifname)
 {
 	struct ifname_map *ifname_map;
+	unsigned int h;
+
+	if (!dl->ifname_map_loaded)
+		return -ENOENT;
 
-	list_for_each_entry(ifname_map, &dl->ifname_map_list, list) {
-		if (strcmp(bus_name, ifname_map->bus_name) == 0 &&
-		    strcmp(dev_name, ifname_map->dev_name) == 0 &&
-		    port_index == ifname_map->port_index) {
+	h = ifname_map_handle_hash(bus_name, dev_name, port_index);
+	hlist_for_each_entry(ifname_map, &dl->ifname_map_handle_head[h],
+			     handle_hash) {
+		if (port_index == ifname_map->port_index &&
+		    strcmp(bus_name, ifname_map->bus_name) == 0 &&
+		    strcmp(dev_name, ifname_map->dev_name) == 0) {
 			*p_ifname = ifname_map->ifname;
 			return 0;
 		}
@@ -1693,6 +2012,42 @@ static int dl_argv_parse(struct dl *dl, uint64_t o_required,
 			if (err)
 				return err;
 			o_found |= DL_OPT_FLASH_FILE_NAME;
+		} else if (dl_argv_match(dl, "file") &&
+			   (o_all & DL_OPT_REGION_FILE_NAME)) {
+			dl_arg_inc(dl);
+			err = dl_argv_str(dl, &opts->region_file_name);
+			if (err)
+				return err;
+			o_found |= DL_OPT_REGION_FILE_NAME;
+		} else if (dl_argv_match(dl, "interval") &&
+			   (o_all & DL_OPT_INTERVAL)) {
+			dl_arg_inc(dl);
+			err = dl_argv_uint32_t(dl, &opts->interval);
+			if (err)
+				return err;
+			if (!opts->interval) {
+				pr_err("Interval must be greater than zero\n");
+				return -EINVAL;
+			}
+			o_found |= DL_OPT_INTERVAL;
+		} else if (dl_argv_match(dl, "count") &&
+			   (o_all & DL_OPT_COUNT)) {
+			dl_arg_inc(dl);
+			err = dl_argv_uint32_t(dl, &opts->count);
+			if (err)
+				return err;
+			o_found |= DL_OPT_COUNT;
+		} else if (dl_argv_match(dl, "top") &&
+			   (o_all & DL_OPT_TOP)) {
+			dl_arg_inc(dl);
+			err = dl_argv_uint32_t(dl, &opts->top);
+			if (err)
+				return err;
+			o_found |= DL_OPT_TOP;
+		} else if (dl_argv_match(dl, "compact") &&
+			   (o_all & DL_OPT_DPIPE_COMPACT)) {
+			dl_arg_inc(dl);
+			o_found |= DL_OPT_DPIPE_COMPACT;
 		} else if (dl_argv_match(dl, "component") &&
 			   (o_all & DL_OPT_FLASH_COMPONENT)) {
 			dl_arg_inc(dl);
@@ -1893,6 +2248,7 @@ static int dl_argv_parse(struct dl *dl, uint64_t o_required,
 	}
 
 	opts->present = o_found;
+	opts->parsed = o_found;
 
 	if ((o_optional & DL_OPT_SB) && !(o_found & DL_OPT_SB)) {
 		opts->sb_index = 0;
@@ -2130,6 +2486,62 @@ static bool dl_dump_filter(struct dl *dl, struct nlattr **tb)
 	return true;
 }
 
+/* Kernels supporting dump selectors only return the objects of the
+ * devlink instance given by the handle attributes of a dump request.
+ * Older kernels ignore them, so the replies are still passed through
+ * dl_dump_filter().
+ */
+static void dl_dump_selector_put(struct nlmsghdr *nlh, struct dl *dl)
+{
+	struct dl_opts *opts = &dl->opts;
+
+	if (!(opts->present & (DL_OPT_HANDLE | DL_OPT_HANDLEP)))
+		return;
+	mnl_attr_put_strz(nlh, DEVLINK_ATTR_BUS_NAME, opts->bus_name);
+	mnl_attr_put_strz(nlh, DEVLINK_ATTR_DEV_NAME, opts->dev_name);
+}
+
+/* Cheap variant of dl_dump_filter() to be run before the full attribute
+ * parse. Devlink puts the object handle first in every message, so only
+ * the leading attributes are looked at.
+ */
+static bool dl_dump_filter_nlh(struct dl *dl, const struct nlmsghdr *nlh)
+{
+	struct dl_opts *opts = &dl->opts;
+	const struct nlattr *attr;
+
+	if (!(opts->present & (DL_OPT_HANDLE | DL_OPT_HANDLEP)))
+		return true;
+
+	mnl_attr_for_each(attr, nlh, sizeof(struct genlmsghdr)) {
+		switch (mnl_attr_get_type(attr)) {
+		case DEVLINK_ATTR_BUS_NAME:
+			if (mnl_attr_validate(attr, MNL_TYPE_NUL_STRING) < 0)
+				return true;
+			if (strcmp(mnl_attr_get_str(attr), opts->bus_name))
+				return false;
+			break;
+		case DEVLINK_ATTR_DEV_NAME:
+			if (mnl_attr_validate(attr, MNL_TYPE_NUL_STRING) < 0)
+				return true;
+			if (strcmp(mnl_attr_get_str(attr), opts->dev_name))
+				return false;
+			break;
+		case DEVLINK_ATTR_PORT_INDEX:
+			if (!(opts->present & DL_OPT_HANDLEP))
+				break;
+			if (mnl_attr_validate(attr, MNL_TYPE_U32) < 0)
+				return true;
+			if (mnl_attr_get_u32(attr) != opts->port_index)
+				return false;
+			break;
+		default:
+			return true;
+		}
+	}
+	return true;
+}
+
 static void cmd_dev_help(void)
 {
 	pr_err("Usage: devlink dev show [ DEV ]\n");
@@ -2138,7 +2550,7 @@ static void cmd_dev_help(void)
 	pr_err("                               [ encap-mode { none | basic } ]\n");
 	pr_err("       devlink dev eswitch show DEV\n");
 	pr_err("       devlink dev param set DEV name PARAMETER value VALUE cmode { permanent | driverinit | runtime }\n");
-	pr_err("       devlink dev param show [DEV name PARAMETER]\n");
+	pr_err("       devlink dev param show [ DEV [ name PARAMETER ] ]\n");
 	pr_err("       devlink dev reload DEV [ netns { PID | NAME | ID } ]\n");
 	pr_err("                              [ action { driver_reinit | fw_activate } ] [ limit no_reset ]\n");
 	pr_err("       devlink dev info [ DEV ]\n");
@@ -2351,6 +2763,13 @@ static void pr_out_port_handle_end(struct dl *dl)
 		pr_out("\n");
 }
 
+struct region_read_ctx {
+	struct dl *dl;
+	int fd;			/* raw output, -1 for formatted output */
+	uint64_t base;		/* address stored at file offset 0 */
+	uint64_t byte_count;	/* bytes printed so far, for line breaks */
+};
+
 static void pr_out_region_chunk_start(struct dl *dl, uint64_t addr)
 {
 	if (dl->json_output) {
@@ -2365,31 +2784,99 @@ static void pr_out_region_chunk_end(struct dl *dl)
 		close_json_array(PRINT_JSON, NULL);
 }
 
-static void pr_out_region_chunk(struct dl *dl, uint8_t *data, uint32_t len,
-				uint64_t addr)
+static const char hex_byte_str[256][4] = {
+#define HEX_BYTE(x) \
+	{ "0123456789abcdef"[(x) >> 4], "0123456789abcdef"[(x) & 0xf], ' ' }
+#define HEX_ROW(r) \
+	HEX_BYTE(r + 0x0), HEX_BYTE(r + 0x1), HEX_BYTE(r + 0x2), \
+	HEX_BYTE(r + 0x3), HEX_BYTE(r + 0x4), HEX_BYTE(r + 0x5), \
+	HEX_BYTE(r + 0x6), HEX_BYTE(r + 0x7), HEX_BYTE(r + 0x8), \
+	HEX_BYTE(r + 0x9), HEX_BYTE(r + 0xa), HEX_BYTE(r + 0xb), \
+	HEX_BYTE(r + 0xc), HEX_BYTE(r + 0xd), HEX_BYTE(r + 0xe), \
+	HEX_BYTE(r + 0xf)
+	HEX_ROW(0x00), HEX_ROW(0x10), HEX_ROW(0x20), HEX_ROW(0x30),
+	HEX_ROW(0x40), HEX_ROW(0x50), HEX_ROW(0x60), HEX_ROW(0x70),
+	HEX_ROW(0x80), HEX_ROW(0x90), HEX_ROW(0xa0), HEX_ROW(0xb0),
+	HEX_ROW(0xc0), HEX_ROW(0xd0), HEX_ROW(0xe0), HEX_ROW(0xf0),
+#undef HEX_ROW
+#undef HEX_BYTE
+};
+
+/* Text dump: every 16 printed bytes start a new line prefixed by the
+ * address of its first byte. Lines are assembled from a lookup table and
+ * written with a single call instead of one printf() per byte.
+ */
+static void pr_out_region_chunk_text(struct region_read_ctx *ctx,
+				     const uint8_t *data, uint32_t len,
+				     uint64_t addr)
 {
-	static uint64_t align_val;
+	/* "\n" + 16 address digits + ' ' + 16 * "xx " */
+	char line[1 + 16 + 1 + 16 * 3 + 1];
 	uint32_t i = 0;
 
-	pr_out_region_chunk_start(dl, addr);
 	while (i < len) {
-		if (!dl->json_output)
-			if (!(align_val % 16))
-				pr_out("%s%016"PRIx64" ",
-				       align_val ? "\n" : "",
-				       addr);
+		unsigned int line_pos = ctx->byte_count % 16;
+		uint32_t n = min(len - i, 16 - line_pos);
+		char *p = line;
+		uint32_t j;
+
+		if (!line_pos) {
+			if (ctx->byte_count)
+				*p++ = '\n';
+			p += sprintf(p, "%016"PRIx64" ", addr);
+		}
+		for (j = 0; j < n; j++, p += 3)
+			memcpy(p, hex_byte_str[data[i + j]], 3);
+		*p = '\0';
+		pr_out("%s", line);
 
-		align_val++;
+		ctx->byte_count += n;
+		addr += n;
+		i += n;
+	}
+}
 
-		if (dl->json_output)
-			print_int(PRINT_JSON, NULL, NULL, data[i]);
-		else
-			pr_out("%02x ", data[i]);
+static int pr_out_region_chunk_raw(struct region_read_ctx *ctx,
+				   const uint8_t *data, uint32_t len,
+				   uint64_t addr)
+{
+	off_t off = addr - ctx->base;
+	ssize_t ret;
 
-		addr++;
-		i++;
+	while (len) {
+		ret = pwrite(ctx->fd, data, len, off);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			pr_err("Failed to write region data: %s\n",
+			       strerror(errno));
+			return -errno;
+		}
+		data += ret;
+		len -= ret;
+		off += ret;
+	}
+	return 0;
+}
+
+static int pr_out_region_chunk(struct region_read_ctx *ctx, uint8_t *data,
+			       uint32_t len, uint64_t addr)
+{
+	struct dl *dl = ctx->dl;
+	uint32_t i;
+
+	if (ctx->fd >= 0)
+		return pr_out_region_chunk_raw(ctx, data, len, addr);
+
+	pr_out_region_chunk_start(dl, addr);
+	if (dl->json_output) {
+		for (i = 0; i < len; i++)
+			print_int(PRINT_JSON, NULL, NULL, data[i]);
+	} else {
+		pr_out_region_chunk_text(ctx, data, len, addr);
 	}
 	pr_out_region_chunk_end(dl);
+	return 0;
 }
 
 static void pr_out_stats(struct dl *dl, struct nlattr *nla_stats)
@@ -2545,7 +3032,7 @@ static int cmd_dev_eswitch_show(struct dl *dl)
 		return err;
 
 	pr_out_section_start(dl, "dev");
-	err = mnlu_gen_socket_sndrcv(&dl->nlg, nlh, cmd_dev_eswitch_show_cb, dl);
+	err = dl_sndrcv(dl, nlh, cmd_dev_eswitch_show_cb, dl);
 	pr_out_section_end(dl);
 	return err;
 }
@@ -2571,7 +3058,7 @@ static int cmd_dev_eswitch_set(struct dl *dl)
 		return -ENOENT;
 	}
 
-	return mnlu_gen_socket_sndrcv(&dl->nlg, nlh, NULL, NULL);
+	return dl_sndrcv(dl, nlh, NULL, NULL);
 }
 
 static int cmd_dev_eswitch(struct dl *dl)
@@ -2828,10 +3315,15 @@ static int cmd_dev_param_show_cb(const struct nlmsghdr *nlh, void *data)
 	struct nlattr *tb[DEVLINK_ATTR_MAX + 1] = {};
 	struct dl *dl = data;
 
+	if (!dl_dump_filter_nlh(dl, nlh))
+		return MNL_CB_OK;
+
 	mnl_attr_parse(nlh, sizeof(*genl), attr_cb, tb);
 	if (!tb[DEVLINK_ATTR_BUS_NAME] || !tb[DEVLINK_ATTR_DEV_NAME] ||
 	    !tb[DEVLINK_ATTR_PARAM])
 		return MNL_CB_ERROR;
+	if (!dl_dump_filter(dl, tb))
+		return MNL_CB_OK;
 	pr_out_param(dl, tb, true, false);
 	return MNL_CB_OK;
 }
@@ -2940,7 +3432,7 @@ static int cmd_dev_param_set(struct dl *dl)
 	dl_opts_put(nlh, dl);
 
 	ctx.dl = dl;
-	err = mnlu_gen_socket_sndrcv(&dl->nlg, nlh, cmd_dev_param_set_cb, &ctx);
+	err = dl_sndrcv(dl, nlh, cmd_dev_param_set_cb, &ctx);
 	if (err)
 		return err;
 
@@ -3022,7 +3514,7 @@ static int cmd_dev_param_set(struct dl *dl)
 		printf("Value type not supported\n");
 		return -ENOTSUP;
 	}
-	return mnlu_gen_socket_sndrcv(&dl->nlg, nlh, NULL, NULL);
+	return dl_sndrcv(dl, nlh, NULL, NULL);
 
 err_param_value_parse:
 	pr_err("Value \"%s\" is not a number or not within range\n",
@@ -3036,10 +3528,15 @@ static int cmd_port_param_show_cb(const struct nlmsghdr *nlh, void *data)
 	struct nlattr *tb[DEVLINK_ATTR_MAX + 1] = {};
 	struct dl *dl = data;
 
+	if (!dl_dump_filter_nlh(dl, nlh))
+		return MNL_CB_OK;
+
 	mnl_attr_parse(nlh, sizeof(*genl), attr_cb, tb);
 	if (!tb[DEVLINK_ATTR_BUS_NAME] || !tb[DEVLINK_ATTR_DEV_NAME] ||
 	    !tb[DEVLINK_ATTR_PORT_INDEX] || !tb[DEVLINK_ATTR_PARAM])
 		return MNL_CB_ERROR;
+	if (!dl_dump_filter(dl, tb))
+		return MNL_CB_OK;
 
 	pr_out_param(dl, tb, true, true);
 	return MNL_CB_OK;
@@ -3051,20 +3548,25 @@ static int cmd_dev_param_show(struct dl *dl)
 	struct nlmsghdr *nlh;
 	int err;
 
-	if (dl_argc(dl) == 0)
-		flags |= NLM_F_DUMP;
-
-	nlh = mnlu_gen_socket_cmd_prepare(&dl->nlg, DEVLINK_CMD_PARAM_GET, flags);
-
 	if (dl_argc(dl) > 0) {
-		err = dl_argv_parse_put(nlh, dl, DL_OPT_HANDLE |
-					DL_OPT_PARAM_NAME, 0);
+		err = dl_argv_parse(dl, DL_OPT_HANDLE, DL_OPT_PARAM_NAME);
 		if (err)
 			return err;
 	}
 
+	/* A device handle selects all of its parameters. */
+	if (!(dl->opts.present & DL_OPT_PARAM_NAME))
+		flags |= NLM_F_DUMP;
+
+	nlh = mnlu_gen_socket_cmd_prepare(&dl->nlg, DEVLINK_CMD_PARAM_GET, flags);
+
+	if (flags & NLM_F_DUMP)
+		dl_dump_selector_put(nlh, dl);
+	else
+		dl_opts_put(nlh, dl);
+
 	pr_out_section_start(dl, "param");
-	err = mnlu_gen_socket_sndrcv(&dl->nlg, nlh, cmd_dev_param_show_cb, dl);
+	err = dl_sndrcv(dl, nlh, cmd_dev_param_show_cb, dl);
 	pr_out_section_end(dl);
 	return err;
 }
@@ -3219,7 +3721,7 @@ static int cmd_dev_show(struct dl *dl)
 	}
 
 	pr_out_section_start(dl, "dev");
-	err = mnlu_gen_socket_sndrcv(&dl->nlg, nlh, cmd_dev_show_cb, dl);
+	err = dl_sndrcv(dl, nlh, cmd_dev_show_cb, dl);
 	pr_out_section_end(dl);
 	return err;
 }
@@ -3294,7 +3796,7 @@ static int cmd_dev_reload(struct dl *dl)
 	if (err)
 		return err;
 
-	return mnlu_gen_socket_sndrcv(&dl->nlg, nlh, cmd_dev_reload_cb, dl);
+	return dl_sndrcv(dl, nlh, cmd_dev_reload_cb, dl);
 }
 
 static void pr_out_versions_single(struct dl *dl, const struct nlmsghdr *nlh,
@@ -3439,7 +3941,7 @@ static int cmd_dev_info(struct dl *dl)
 	}
 
 	pr_out_section_start(dl, "info");
-	err = mnlu_gen_socket_sndrcv(&dl->nlg, nlh, cmd_versions_show_cb, dl);
+	err = dl_sndrcv(dl, nlh, cmd_versions_show_cb, dl);
 	pr_out_section_end(dl);
 	return err;
 }
@@ -3700,6 +4202,9 @@ static int cmd_dev_flash(struct dl *dl)
 	if (err)
 		return err;
 
+	if (dl_batch_pipelined(dl))
+		dl_batch_flush(dl);
+
 	err = mnlu_gen_socket_open(&nlg_ntf, DEVLINK_GENL_NAME,
 				   DEVLINK_GENL_VERSION);
 	if (err)
@@ -3787,13 +4292,13 @@ static int cmd_dev(struct dl *dl)
 
 static void cmd_port_help(void)
 {
-	pr_err("Usage: devlink port show [ DEV/PORT_INDEX ]\n");
+	pr_err("Usage: devlink port show [ DEV | DEV/PORT_INDEX ]\n");
 	pr_err("       devlink port set DEV/PORT_INDEX [ type { eth | ib | auto} ]\n");
 	pr_err("       devlink port split DEV/PORT_INDEX count COUNT\n");
 	pr_err("       devlink port unsplit DEV/PORT_INDEX\n");
 	pr_err("       devlink port function set DEV/PORT_INDEX [ hw_addr ADDR ] [ state STATE ]\n");
 	pr_err("       devlink port param set DEV/PORT_INDEX name PARAMETER value VALUE cmode { permanent | driverinit | runtime }\n");
-	pr_err("       devlink port param show [DEV/PORT_INDEX name PARAMETER]\n");
+	pr_err("       devlink port param show [ DEV/PORT_INDEX [ name PARAMETER ] ]\n");
 	pr_err("       devlink port health show [ DEV/PORT_INDEX reporter REPORTER_NAME ]\n");
 	pr_err("       devlink port add DEV/PORT_INDEX flavour FLAVOUR pfnum PFNUM [ sfnum SFNUM ]\n");
 	pr_err("       devlink port del DEV/PORT_INDEX\n");
@@ -3980,10 +4485,15 @@ static int cmd_port_show_cb(const struct nlmsghdr *nlh, void *data)
 	struct nlattr *tb[DEVLINK_ATTR_MAX + 1] = {};
 	struct genlmsghdr *genl = mnl_nlmsg_get_payload(nlh);
 
+	if (!dl_dump_filter_nlh(dl, nlh))
+		return MNL_CB_OK;
+
 	mnl_attr_parse(nlh, sizeof(*genl), attr_cb, tb);
 	if (!tb[DEVLINK_ATTR_BUS_NAME] || !tb[DEVLINK_ATTR_DEV_NAME] ||
 	    !tb[DEVLINK_ATTR_PORT_INDEX])
 		return MNL_CB_ERROR;
+	if (!dl_dump_filter(dl, tb))
+		return MNL_CB_OK;
 	pr_out_port(dl, tb);
 	return MNL_CB_OK;
 }
@@ -3994,19 +4504,25 @@ static int cmd_port_show(struct dl *dl)
 	uint16_t flags = NLM_F_REQUEST | NLM_F_ACK;
 	int err;
 
-	if (dl_argc(dl) == 0)
-		flags |= NLM_F_DUMP;
-
-	nlh = mnlu_gen_socket_cmd_prepare(&dl->nlg, DEVLINK_CMD_PORT_GET, flags);
-
 	if (dl_argc(dl) > 0) {
-		err = dl_argv_parse_put(nlh, dl, DL_OPT_HANDLEP, 0);
+		err = dl_argv_parse(dl, DL_OPT_HANDLE | DL_OPT_HANDLEP, 0);
 		if (err)
 			return err;
 	}
 
+	/* A device handle selects all of its ports. */
+	if (!(dl->opts.present & DL_OPT_HANDLEP))
+		flags |= NLM_F_DUMP;
+
+	nlh = mnlu_gen_socket_cmd_prepare(&dl->nlg, DEVLINK_CMD_PORT_GET, flags);
+
+	if (flags & NLM_F_DUMP)
+		dl_dump_selector_put(nlh, dl);
+	else
+		dl_opts_put(nlh, dl);
+
 	pr_out_section_start(dl, "port");
-	err = mnlu_gen_socket_sndrcv(&dl->nlg, nlh, cmd_port_show_cb, dl);
+	err = dl_sndrcv(dl, nlh, cmd_port_show_cb, dl);
 	pr_out_section_end(dl);
 	return err;
 }
@@ -4023,7 +4539,7 @@ static int cmd_port_set(struct dl *dl)
 	if (err)
 		return err;
 
-	return mnlu_gen_socket_sndrcv(&dl->nlg, nlh, NULL, NULL);
+	return dl_sndrcv(dl, nlh, NULL, NULL);
 }
 
 static int cmd_port_split(struct dl *dl)
@@ -4038,7 +4554,7 @@ static int cmd_port_split(struct dl *dl)
 	if (err)
 		return err;
 
-	return mnlu_gen_socket_sndrcv(&dl->nlg, nlh, NULL, NULL);
+	return dl_sndrcv(dl, nlh, NULL, NULL);
 }
 
 static int cmd_port_unsplit(struct dl *dl)
@@ -4053,7 +4569,7 @@ static int cmd_port_unsplit(struct dl *dl)
 	if (err)
 		return err;
 
-	return mnlu_gen_socket_sndrcv(&dl->nlg, nlh, NULL, NULL);
+	return dl_sndrcv(dl, nlh, NULL, NULL);
 }
 
 static int cmd_port_param_show(struct dl *dl)
@@ -4062,21 +4578,26 @@ static int cmd_port_param_show(struct dl *dl)
 	struct nlmsghdr *nlh;
 	int err;
 
-	if (dl_argc(dl) == 0)
+	if (dl_argc(dl) > 0) {
+		err = dl_argv_parse(dl, DL_OPT_HANDLEP, DL_OPT_PARAM_NAME);
+		if (err)
+			return err;
+	}
+
+	/* A port handle selects all of its parameters. */
+	if (!(dl->opts.present & DL_OPT_PARAM_NAME))
 		flags |= NLM_F_DUMP;
 
 	nlh = mnlu_gen_socket_cmd_prepare(&dl->nlg, DEVLINK_CMD_PORT_PARAM_GET,
 					  flags);
 
-	if (dl_argc(dl) > 0) {
-		err = dl_argv_parse_put(nlh, dl, DL_OPT_HANDLEP |
-					DL_OPT_PARAM_NAME, 0);
-		if (err)
-			return err;
-	}
+	if (flags & NLM_F_DUMP)
+		dl_dump_selector_put(nlh, dl);
+	else
+		dl_opts_put(nlh, dl);
 
 	pr_out_section_start(dl, "param");
-	err = mnlu_gen_socket_sndrcv(&dl->nlg, nlh, cmd_port_param_show_cb, dl);
+	err = dl_sndrcv(dl, nlh, cmd_port_param_show_cb, dl);
 	pr_out_section_end(dl);
 
 	return err;
@@ -4104,7 +4625,7 @@ static int cmd_port_function_set(struct dl *dl)
 	if (err)
 		return err;
 
-	return mnlu_gen_socket_sndrcv(&dl->nlg, nlh, NULL, NULL);
+	return dl_sndrcv(dl, nlh, NULL, NULL);
 }
 
 static int cmd_port_param_set_cb(const struct nlmsghdr *nlh, void *data)
@@ -4199,7 +4720,7 @@ static int cmd_port_param_set(struct dl *dl)
 	dl_opts_put(nlh, dl);
 
 	ctx.dl = dl;
-	err = mnlu_gen_socket_sndrcv(&dl->nlg, nlh, cmd_port_param_set_cb, &ctx);
+	err = dl_sndrcv(dl, nlh, cmd_port_param_set_cb, &ctx);
 	if (err)
 		return err;
 
@@ -4281,7 +4802,7 @@ static int cmd_port_param_set(struct dl *dl)
 		printf("Value type not supported\n");
 		return -ENOTSUP;
 	}
-	return mnlu_gen_socket_sndrcv(&dl->nlg, nlh, NULL, NULL);
+	return dl_sndrcv(dl, nlh, NULL, NULL);
 
 err_param_value_parse:
 	pr_err("Value \"%s\" is not a number or not within range\n",
@@ -4346,7 +4867,7 @@ static int cmd_port_add(struct dl *dl)
 	if (err)
 		return err;
 
-	return mnlu_gen_socket_sndrcv(&dl->nlg, nlh, cmd_port_show_cb, dl);
+	return dl_sndrcv(dl, nlh, cmd_port_show_cb, dl);
 }
 
 static void cmd_port_del_help(void)
@@ -4371,7 +4892,7 @@ static int cmd_port_del(struct dl *dl)
 	if (err)
 		return err;
 
-	return mnlu_gen_socket_sndrcv(&dl->nlg, nlh, NULL, NULL);
+	return dl_sndrcv(dl, nlh, NULL, NULL);
 }
 
 static int cmd_port(struct dl *dl)
@@ -4437,6 +4958,8 @@ static void cmd_sb_help(void)
 	pr_err("       devlink sb occupancy show { DEV | DEV/PORT_INDEX } [ sb SB_INDEX ]\n");
 	pr_err("       devlink sb occupancy snapshot DEV [ sb SB_INDEX ]\n");
 	pr_err("       devlink sb occupancy clearmax DEV [ sb SB_INDEX ]\n");
+	pr_err("       devlink sb occupancy watch { DEV | DEV/PORT_INDEX } [ sb SB_INDEX ]\n");
+	pr_err("                                  [ interval MSEC ] [ count COUNT ]\n");
 }
 
 static void pr_out_sb(struct dl *dl, struct nlattr **tb)
@@ -4464,6 +4987,9 @@ static int cmd_sb_show_cb(const struct nlmsghdr *nlh, void *data)
 	struct nlattr *tb[DEVLINK_ATTR_MAX + 1] = {};
 	struct genlmsghdr *genl = mnl_nlmsg_get_payload(nlh);
 
+	if (!dl_dump_filter_nlh(dl, nlh))
+		return MNL_CB_OK;
+
 	mnl_attr_parse(nlh, sizeof(*genl), attr_cb, tb);
 	if (!tb[DEVLINK_ATTR_BUS_NAME] || !tb[DEVLINK_ATTR_DEV_NAME] ||
 	    !tb[DEVLINK_ATTR_SB_INDEX] || !tb[DEVLINK_ATTR_SB_SIZE] ||
@@ -4472,6 +4998,8 @@ static int cmd_sb_show_cb(const struct nlmsghdr *nlh, void *data)
 	    !tb[DEVLINK_ATTR_SB_INGRESS_TC_COUNT] ||
 	    !tb[DEVLINK_ATTR_SB_EGRESS_TC_COUNT])
 		return MNL_CB_ERROR;
+	if (!dl_dump_filter(dl, tb))
+		return MNL_CB_OK;
 	pr_out_sb(dl, tb);
 	return MNL_CB_OK;
 }
@@ -4480,21 +5008,32 @@ static int cmd_sb_show(struct dl *dl)
 {
 	struct nlmsghdr *nlh;
 	uint16_t flags = NLM_F_REQUEST | NLM_F_ACK;
+	bool sb_given = false;
 	int err;
 
-	if (dl_argc(dl) == 0)
-		flags |= NLM_F_DUMP;
-
-	nlh = mnlu_gen_socket_cmd_prepare(&dl->nlg, DEVLINK_CMD_SB_GET, flags);
-
 	if (dl_argc(dl) > 0) {
-		err = dl_argv_parse_put(nlh, dl, DL_OPT_HANDLE, DL_OPT_SB);
+		err = dl_argv_parse(dl, DL_OPT_HANDLE, DL_OPT_SB);
 		if (err)
 			return err;
+		/* the parser defaults to sb 0, only a given one is a doit */
+		sb_given = dl->opts.parsed & DL_OPT_SB;
+		if (!sb_given)
+			dl->opts.present &= ~DL_OPT_SB;
 	}
 
+	/* A device handle selects all of its shared buffers. */
+	if (!sb_given)
+		flags |= NLM_F_DUMP;
+
+	nlh = mnlu_gen_socket_cmd_prepare(&dl->nlg, DEVLINK_CMD_SB_GET, flags);
+
+	if (flags & NLM_F_DUMP)
+		dl_dump_selector_put(nlh, dl);
+	else
+		dl_opts_put(nlh, dl);
+
 	pr_out_section_start(dl, "sb");
-	err = mnlu_gen_socket_sndrcv(&dl->nlg, nlh, cmd_sb_show_cb, dl);
+	err = dl_sndrcv(dl, nlh, cmd_sb_show_cb, dl);
 	pr_out_section_end(dl);
 	return err;
 }
@@ -4572,7 +5111,7 @@ static int cmd_sb_pool_show(struct dl *dl)
 	}
 
 	pr_out_section_start(dl, "pool");
-	err = mnlu_gen_socket_sndrcv(&dl->nlg, nlh, cmd_sb_pool_show_cb, dl);
+	err = dl_sndrcv(dl, nlh, cmd_sb_pool_show_cb, dl);
 	pr_out_section_end(dl);
 	return err;
 }
@@ -4590,7 +5129,7 @@ static int cmd_sb_pool_set(struct dl *dl)
 	if (err)
 		return err;
 
-	return mnlu_gen_socket_sndrcv(&dl->nlg, nlh, NULL, NULL);
+	return dl_sndrcv(dl, nlh, NULL, NULL);
 }
 
 static int cmd_sb_pool(struct dl *dl)
@@ -4644,8 +5183,12 @@ static int cmd_sb_port_pool_show(struct dl *dl)
 	uint16_t flags = NLM_F_REQUEST | NLM_F_ACK;
 	int err;
 
-	if (dl_argc(dl) == 0)
-		flags |= NLM_F_DUMP;
+	err = ifname_map_nice_names_load(dl);
+	if (err)
+		return err;
+
+	if (dl_argc(dl) == 0)
+		flags |= NLM_F_DUMP;
 
 	nlh = mnlu_gen_socket_cmd_prepare(&dl->nlg, DEVLINK_CMD_SB_PORT_POOL_GET, flags);
 
@@ -4658,7 +5201,7 @@ static int cmd_sb_port_pool_show(struct dl *dl)
 	}
 
 	pr_out_section_start(dl, "port_pool");
-	err = mnlu_gen_socket_sndrcv(&dl->nlg, nlh, cmd_sb_port_pool_show_cb, dl);
+	err = dl_sndrcv(dl, nlh, cmd_sb_port_pool_show_cb, dl);
 	pr_out_section_end(dl);
 	return 0;
 }
@@ -4676,7 +5219,7 @@ static int cmd_sb_port_pool_set(struct dl *dl)
 	if (err)
 		return err;
 
-	return mnlu_gen_socket_sndrcv(&dl->nlg, nlh, NULL, NULL);
+	return dl_sndrcv(dl, nlh, NULL, NULL);
 }
 
 static int cmd_sb_port_pool(struct dl *dl)
@@ -4748,6 +5291,10 @@ static int cmd_sb_tc_bind_show(struct dl *dl)
 	uint16_t flags = NLM_F_REQUEST | NLM_F_ACK;
 	int err;
 
+	err = ifname_map_nice_names_load(dl);
+	if (err)
+		return err;
+
 	if (dl_argc(dl) == 0)
 		flags |= NLM_F_DUMP;
 
@@ -4761,7 +5308,7 @@ static int cmd_sb_tc_bind_show(struct dl *dl)
 	}
 
 	pr_out_section_start(dl, "tc_bind");
-	err = mnlu_gen_socket_sndrcv(&dl->nlg, nlh, cmd_sb_tc_bind_show_cb, dl);
+	err = dl_sndrcv(dl, nlh, cmd_sb_tc_bind_show_cb, dl);
 	pr_out_section_end(dl);
 	return err;
 }
@@ -4780,7 +5327,7 @@ static int cmd_sb_tc_bind_set(struct dl *dl)
 	if (err)
 		return err;
 
-	return mnlu_gen_socket_sndrcv(&dl->nlg, nlh, NULL, NULL);
+	return dl_sndrcv(dl, nlh, NULL, NULL);
 }
 
 static int cmd_sb_tc_bind(struct dl *dl)
@@ -5020,6 +5567,9 @@ static int cmd_sb_occ_port_pool_process_cb(const struct nlmsghdr *nlh, void *dat
 	struct nlattr *tb[DEVLINK_ATTR_MAX + 1] = {};
 	struct genlmsghdr *genl = mnl_nlmsg_get_payload(nlh);
 
+	if (!dl_dump_filter_nlh(occ_show->dl, nlh))
+		return MNL_CB_OK;
+
 	mnl_attr_parse(nlh, sizeof(*genl), attr_cb, tb);
 	if (!tb[DEVLINK_ATTR_BUS_NAME] || !tb[DEVLINK_ATTR_DEV_NAME] ||
 	    !tb[DEVLINK_ATTR_PORT_INDEX] || !tb[DEVLINK_ATTR_SB_INDEX] ||
@@ -5071,6 +5621,9 @@ static int cmd_sb_occ_tc_pool_process_cb(const struct nlmsghdr *nlh, void *data)
 	struct nlattr *tb[DEVLINK_ATTR_MAX + 1] = {};
 	struct genlmsghdr *genl = mnl_nlmsg_get_payload(nlh);
 
+	if (!dl_dump_filter_nlh(occ_show->dl, nlh))
+		return MNL_CB_OK;
+
 	mnl_attr_parse(nlh, sizeof(*genl), attr_cb, tb);
 	if (!tb[DEVLINK_ATTR_BUS_NAME] || !tb[DEVLINK_ATTR_DEV_NAME] ||
 	    !tb[DEVLINK_ATTR_PORT_INDEX] || !tb[DEVLINK_ATTR_SB_INDEX] ||
@@ -5093,21 +5646,25 @@ static int cmd_sb_occ_show(struct dl *dl)
 	if (err)
 		return err;
 
+	err = ifname_map_nice_names_load(dl);
+	if (err)
+		return err;
+
 	occ_show = occ_show_alloc(dl);
 	if (!occ_show)
 		return -ENOMEM;
 
 	nlh = mnlu_gen_socket_cmd_prepare(&dl->nlg, DEVLINK_CMD_SB_PORT_POOL_GET, flags);
+	dl_dump_selector_put(nlh, dl);
 
-	err = mnlu_gen_socket_sndrcv(&dl->nlg, nlh,
-				  cmd_sb_occ_port_pool_process_cb, occ_show);
+	err = dl_sndrcv(dl, nlh, cmd_sb_occ_port_pool_process_cb, occ_show);
 	if (err)
 		goto out;
 
 	nlh = mnlu_gen_socket_cmd_prepare(&dl->nlg, DEVLINK_CMD_SB_TC_POOL_BIND_GET, flags);
+	dl_dump_selector_put(nlh, dl);
 
-	err = mnlu_gen_socket_sndrcv(&dl->nlg, nlh,
-				  cmd_sb_occ_tc_pool_process_cb, occ_show);
+	err = dl_sndrcv(dl, nlh, cmd_sb_occ_tc_pool_process_cb, occ_show);
 	if (err)
 		goto out;
 
@@ -5132,7 +5689,7 @@ static int cmd_sb_occ_snapshot(struct dl *dl)
 	if (err)
 		return err;
 
-	return mnlu_gen_socket_sndrcv(&dl->nlg, nlh, NULL, NULL);
+	return dl_sndrcv(dl, nlh, NULL, NULL);
 }
 
 static int cmd_sb_occ_clearmax(struct dl *dl)
@@ -5147,7 +5704,498 @@ static int cmd_sb_occ_clearmax(struct dl *dl)
 	if (err)
 		return err;
 
-	return mnlu_gen_socket_sndrcv(&dl->nlg, nlh, NULL, NULL);
+	return dl_sndrcv(dl, nlh, NULL, NULL);
+}
+
+/* Occupancy watch: snapshot, dump and clear the watermarks of a device in
+ * a loop. Results are kept in arrays indexed by port and by pool / tc
+ * index, so that an iteration only overwrites values in place. The
+ * percentiles are taken over a ring of the most recent samples, which
+ * bounds memory on devices with many ports and pools.
+ */
+#define OCC_WATCH_SAMPLES_MAX		1024
+
+enum occ_watch_kind {
+	OCC_WATCH_POOL,
+	OCC_WATCH_ITC,
+	OCC_WATCH_ETC,
+	OCC_WATCH_KIND_MAX,
+};
+
+static const char *occ_watch_kind_label[OCC_WATCH_KIND_MAX] = {
+	[OCC_WATCH_POOL] = "pool",
+	[OCC_WATCH_ITC] = "itc",
+	[OCC_WATCH_ETC] = "etc",
+};
+
+struct occ_watch_item {
+	bool present;
+	uint32_t cur;
+	uint32_t prev_cur;
+	uint32_t max;
+	uint32_t peak;
+	uint16_t bound_pool_index;
+	uint32_t *samples;	/* ring of the most recent cur values */
+	uint32_t sample_count;
+	uint32_t sample_pos;
+};
+
+struct occ_watch_port {
+	bool present;
+	struct occ_watch_item *items[OCC_WATCH_KIND_MAX];
+	unsigned int item_count[OCC_WATCH_KIND_MAX];
+};
+
+struct occ_watch {
+	struct dl *dl;
+	int err;
+	struct occ_watch_port *ports;
+	uint32_t port_count;
+	uint32_t samples_max;
+	unsigned int iteration;
+};
+
+static void occ_watch_free(struct occ_watch *watch)
+{
+	struct occ_watch_port *port;
+	unsigned int i, kind;
+	uint32_t port_index;
+
+	for (port_index = 0; port_index < watch->port_count; port_index++) {
+		port = &watch->ports[port_index];
+		for (kind = 0; kind < OCC_WATCH_KIND_MAX; kind++) {
+			for (i = 0; i < port->item_count[kind]; i++)
+				free(port->items[kind][i].samples);
+			free(port->items[kind]);
+		}
+	}
+	free(watch->ports);
+}
+
+static struct occ_watch_item *occ_watch_item_get(struct occ_watch *watch,
+						 uint32_t port_index,
+						 enum occ_watch_kind kind,
+						 unsigned int index)
+{
+	struct occ_watch_item *items;
+	struct occ_watch_port *port;
+	unsigned int count;
+
+	if (port_index >= watch->port_count) {
+		struct occ_watch_port *ports;
+
+		count = port_index + 1;
+		ports = realloc(watch->ports, count * sizeof(*ports));
+		if (!ports)
+			return NULL;
+		memset(ports + watch->port_count, 0,
+		       (count - watch->port_count) * sizeof(*ports));
+		watch->ports = ports;
+		watch->port_count = count;
+	}
+	port = &watch->ports[port_index];
+	port->present = true;
+
+	if (index >= port->item_count[kind]) {
+		count = index + 1;
+		items = realloc(port->items[kind], count * sizeof(*items));
+		if (!items)
+			return NULL;
+		memset(items + port->item_count[kind], 0,
+		       (count - port->item_count[kind]) * sizeof(*items));
+		port->items[kind] = items;
+		port->item_count[kind] = count;
+	}
+	return &port->items[kind][index];
+}
+
+static void occ_watch_item_update(struct occ_watch *watch,
+				  struct occ_watch_item *item,
+				  struct nlattr **tb)
+{
+	if (!item->samples) {
+		item->samples = calloc(watch->samples_max,
+				       sizeof(*item->samples));
+		if (!item->samples) {
+			watch->err = -ENOMEM;
+			return;
+		}
+		item->present = true;
+		item->prev_cur = mnl_attr_get_u32(tb[DEVLINK_ATTR_SB_OCC_CUR]);
+	} else {
+		item->prev_cur = item->cur;
+	}
+	item->cur = mnl_attr_get_u32(tb[DEVLINK_ATTR_SB_OCC_CUR]);
+	item->max = mnl_attr_get_u32(tb[DEVLINK_ATTR_SB_OCC_MAX]);
+	if (item->max > item->peak)
+		item->peak = item->max;
+
+	item->samples[item->sample_pos] = item->cur;
+	item->sample_pos = (item->sample_pos + 1) % watch->samples_max;
+	if (item->sample_count < watch->samples_max)
+		item->sample_count++;
+}
+
+static int cmd_sb_occ_watch_port_pool_cb(const struct nlmsghdr *nlh,
+					 void *data)
+{
+	struct genlmsghdr *genl = mnl_nlmsg_get_payload(nlh);
+	struct nlattr *tb[DEVLINK_ATTR_MAX + 1] = {};
+	struct occ_watch *watch = data;
+	struct occ_watch_item *item;
+
+	if (!dl_dump_filter_nlh(watch->dl, nlh))
+		return MNL_CB_OK;
+
+	mnl_attr_parse(nlh, sizeof(*genl), attr_cb, tb);
+	if (!tb[DEVLINK_ATTR_BUS_NAME] || !tb[DEVLINK_ATTR_DEV_NAME] ||
+	    !tb[DEVLINK_ATTR_PORT_INDEX] || !tb[DEVLINK_ATTR_SB_INDEX] ||
+	    !tb[DEVLINK_ATTR_SB_POOL_INDEX] ||
+	    !tb[DEVLINK_ATTR_SB_OCC_CUR] || !tb[DEVLINK_ATTR_SB_OCC_MAX])
+		return MNL_CB_ERROR;
+
+	if (watch->err || !dl_dump_filter(watch->dl, tb))
+		return MNL_CB_OK;
+
+	item = occ_watch_item_get(watch,
+				  mnl_attr_get_u32(tb[DEVLINK_ATTR_PORT_INDEX]),
+				  OCC_WATCH_POOL,
+				  mnl_attr_get_u16(tb[DEVLINK_ATTR_SB_POOL_INDEX]));
+	if (!item) {
+		watch->err = -ENOMEM;
+		return MNL_CB_OK;
+	}
+	occ_watch_item_update(watch, item, tb);
+	return MNL_CB_OK;
+}
+
+static int cmd_sb_occ_watch_tc_pool_cb(const struct nlmsghdr *nlh,
+				       void *data)
+{
+	struct genlmsghdr *genl = mnl_nlmsg_get_payload(nlh);
+	struct nlattr *tb[DEVLINK_ATTR_MAX + 1] = {};
+	struct occ_watch *watch = data;
+	struct occ_watch_item *item;
+	enum occ_watch_kind kind;
+	uint8_t pool_type;
+
+	if (!dl_dump_filter_nlh(watch->dl, nlh))
+		return MNL_CB_OK;
+
+	mnl_attr_parse(nlh, sizeof(*genl), attr_cb, tb);
+	if (!tb[DEVLINK_ATTR_BUS_NAME] || !tb[DEVLINK_ATTR_DEV_NAME] ||
+	    !tb[DEVLINK_ATTR_PORT_INDEX] || !tb[DEVLINK_ATTR_SB_INDEX] ||
+	    !tb[DEVLINK_ATTR_SB_TC_INDEX] || !tb[DEVLINK_ATTR_SB_POOL_TYPE] ||
+	    !tb[DEVLINK_ATTR_SB_POOL_INDEX] ||
+	    !tb[DEVLINK_ATTR_SB_OCC_CUR] || !tb[DEVLINK_ATTR_SB_OCC_MAX])
+		return MNL_CB_ERROR;
+
+	if (watch->err || !dl_dump_filter(watch->dl, tb))
+		return MNL_CB_OK;
+
+	pool_type = mnl_attr_get_u8(tb[DEVLINK_ATTR_SB_POOL_TYPE]);
+	if (pool_type == DEVLINK_SB_POOL_TYPE_INGRESS)
+		kind = OCC_WATCH_ITC;
+	else if (pool_type == DEVLINK_SB_POOL_TYPE_EGRESS)
+		kind = OCC_WATCH_ETC;
+	else
+		return MNL_CB_OK;
+
+	item = occ_watch_item_get(watch,
+				  mnl_attr_get_u32(tb[DEVLINK_ATTR_PORT_INDEX]),
+				  kind,
+				  mnl_attr_get_u16(tb[DEVLINK_ATTR_SB_TC_INDEX]));
+	if (!item) {
+		watch->err = -ENOMEM;
+		return MNL_CB_OK;
+	}
+	item->bound_pool_index =
+			mnl_attr_get_u16(tb[DEVLINK_ATTR_SB_POOL_INDEX]);
+	occ_watch_item_update(watch, item, tb);
+	return MNL_CB_OK;
+}
+
+static int occ_watch_dev_cmd(struct dl *dl, uint8_t cmd)
+{
+	struct dl_opts *opts = &dl->opts;
+	struct nlmsghdr *nlh;
+
+	nlh = mnlu_gen_socket_cmd_prepare(&dl->nlg, cmd,
+					  NLM_F_REQUEST | NLM_F_ACK);
+	mnl_attr_put_strz(nlh, DEVLINK_ATTR_BUS_NAME, opts->bus_name);
+	mnl_attr_put_strz(nlh, DEVLINK_ATTR_DEV_NAME, opts->dev_name);
+	if (opts->present & DL_OPT_SB)
+		mnl_attr_put_u32(nlh, DEVLINK_ATTR_SB_INDEX, opts->sb_index);
+	return dl_sndrcv(dl, nlh, NULL, NULL);
+}
+
+static int occ_watch_sample(struct occ_watch *watch)
+{
+	uint16_t flags = NLM_F_REQUEST | NLM_F_ACK | NLM_F_DUMP;
+	struct dl *dl = watch->dl;
+	struct nlmsghdr *nlh;
+	int err;
+
+	err = occ_watch_dev_cmd(dl, DEVLINK_CMD_SB_OCC_SNAPSHOT);
+	if (err)
+		return err;
+
+	nlh = mnlu_gen_socket_cmd_prepare(&dl->nlg,
+					  DEVLINK_CMD_SB_PORT_POOL_GET, flags);
+	dl_dump_selector_put(nlh, dl);
+	err = dl_sndrcv(dl, nlh, cmd_sb_occ_watch_port_pool_cb, watch);
+	if (err)
+		return err;
+
+	nlh = mnlu_gen_socket_cmd_prepare(&dl->nlg,
+					  DEVLINK_CMD_SB_TC_POOL_BIND_GET, flags);
+	dl_dump_selector_put(nlh, dl);
+	err = dl_sndrcv(dl, nlh, cmd_sb_occ_watch_tc_pool_cb, watch);
+	if (err)
+		return err;
+	if (watch->err)
+		return watch->err;
+
+	/* Restart the watermarks so that the next max is per interval. */
+	return occ_watch_dev_cmd(dl, DEVLINK_CMD_SB_OCC_MAX_CLEAR);
+}
+
+static bool occ_watch_item_active(const struct occ_watch_item *item)
+{
+	return item->present && (item->max || item->cur != item->prev_cur);
+}
+
+static bool occ_watch_port_active(const struct occ_watch_port *port)
+{
+	unsigned int i, kind;
+
+	for (kind = 0; kind < OCC_WATCH_KIND_MAX; kind++)
+		for (i = 0; i < port->item_count[kind]; i++)
+			if (occ_watch_item_active(&port->items[kind][i]))
+				return true;
+	return false;
+}
+
+static void pr_out_occ_watch_item_list(struct dl *dl,
+				       struct occ_watch_port *port,
+				       enum occ_watch_kind kind)
+{
+	bool bound_pool = kind != OCC_WATCH_POOL;
+	struct occ_watch_item *item;
+	unsigned int i;
+	char buf[32];
+
+	if (dl->json_output)
+		open_json_object(occ_watch_kind_label[kind]);
+	else
+		pr_out_sp(7, "  %s:", occ_watch_kind_label[kind]);
+
+	for (i = 0; i < port->item_count[kind]; i++) {
+		item = &port->items[kind][i];
+		if (!occ_watch_item_active(item))
+			continue;
+
+		if (dl->json_output) {
+			sprintf(buf, "%u", i);
+			open_json_object(buf);
+			if (bound_pool)
+				print_uint(PRINT_JSON, "bound_pool", NULL,
+					   item->bound_pool_index);
+			print_uint(PRINT_JSON, "current", NULL, item->cur);
+			print_s64(PRINT_JSON, "delta", NULL,
+				  (int64_t)item->cur - item->prev_cur);
+			print_uint(PRINT_JSON, "max", NULL, item->max);
+			close_json_object();
+		} else {
+			if (bound_pool)
+				pr_out(" %u(%u): ", i, item->bound_pool_index);
+			else
+				pr_out(" %u: ", i);
+			pr_out("%u/%u (%+" PRId64 ")", item->cur, item->max,
+			       (int64_t)item->cur - item->prev_cur);
+		}
+	}
+
+	if (dl->json_output)
+		close_json_object();
+	else
+		pr_out("\n");
+}
+
+static void pr_out_occ_watch(struct occ_watch *watch, uint64_t elapsed_ms)
+{
+	struct dl *dl = watch->dl;
+	struct dl_opts *opts = &dl->opts;
+	struct occ_watch_port *port;
+	unsigned int kind;
+	uint32_t port_index;
+
+	pr_out_section_start(dl, "occupancy");
+	if (dl->json_output) {
+		print_uint(PRINT_JSON, "iteration", NULL, watch->iteration);
+		print_u64(PRINT_JSON, "time_ms", NULL, elapsed_ms);
+	} else {
+		pr_out("iteration %u time %" PRIu64 "ms:\n",
+		       watch->iteration, elapsed_ms);
+	}
+	for (port_index = 0; port_index < watch->port_count; port_index++) {
+		port = &watch->ports[port_index];
+		if (!port->present || !occ_watch_port_active(port))
+			continue;
+
+		__pr_out_port_handle_start(dl, opts->bus_name, opts->dev_name,
+					   port_index, true, false);
+		if (!dl->json_output)
+			pr_out("\n");
+		for (kind = 0; kind < OCC_WATCH_KIND_MAX; kind++)
+			pr_out_occ_watch_item_list(dl, port, kind);
+		if (dl->json_output)
+			close_json_object();
+	}
+	pr_out_section_end(dl);
+	fflush(stdout);
+}
+
+static int occ_watch_u32_cmp(const void *a, const void *b)
+{
+	uint32_t x = *(const uint32_t *)a;
+	uint32_t y = *(const uint32_t *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static int pr_out_occ_watch_summary_item(struct dl *dl,
+					 struct occ_watch_item *item,
+					 unsigned int index, bool bound_pool)
+{
+	static const unsigned int pcts[] = { 50, 90, 99 };
+	uint32_t *sorted;
+	char buf[32];
+	unsigned int i;
+
+	sorted = malloc(item->sample_count * sizeof(*sorted));
+	if (!sorted)
+		return -ENOMEM;
+	memcpy(sorted, item->samples, item->sample_count * sizeof(*sorted));
+	qsort(sorted, item->sample_count, sizeof(*sorted), occ_watch_u32_cmp);
+
+	if (dl->json_output) {
+		sprintf(buf, "%u", index);
+		open_json_object(buf);
+		if (bound_pool)
+			print_uint(PRINT_JSON, "bound_pool", NULL,
+				   item->bound_pool_index);
+		print_uint(PRINT_JSON, "samples", NULL, item->sample_count);
+	} else {
+		if (bound_pool)
+			pr_out("    %u(%u):", index, item->bound_pool_index);
+		else
+			pr_out("    %u:", index);
+	}
+	for (i = 0; i < ARRAY_SIZE(pcts); i++) {
+		uint32_t val = sorted[(item->sample_count - 1) * pcts[i] / 100];
+
+		sprintf(buf, "p%u", pcts[i]);
+		if (dl->json_output)
+			print_uint(PRINT_JSON, buf, NULL, val);
+		else
+			pr_out(" %s %u", buf, val);
+	}
+	if (dl->json_output) {
+		print_uint(PRINT_JSON, "peak", NULL, item->peak);
+		close_json_object();
+	} else {
+		pr_out(" peak %u\n", item->peak);
+	}
+	free(sorted);
+	return 0;
+}
+
+static int pr_out_occ_watch_summary(struct occ_watch *watch)
+{
+	struct dl *dl = watch->dl;
+	struct dl_opts *opts = &dl->opts;
+	struct occ_watch_port *port;
+	struct occ_watch_item *item;
+	unsigned int i, kind;
+	uint32_t port_index;
+	int err = 0;
+
+	pr_out_section_start(dl, "occupancy_summary");
+	for (port_index = 0; port_index < watch->port_count; port_index++) {
+		port = &watch->ports[port_index];
+		if (!port->present)
+			continue;
+
+		__pr_out_port_handle_start(dl, opts->bus_name, opts->dev_name,
+					   port_index, true, false);
+		if (!dl->json_output)
+			pr_out("\n");
+		for (kind = 0; kind < OCC_WATCH_KIND_MAX && !err; kind++) {
+			if (dl->json_output)
+				open_json_object(occ_watch_kind_label[kind]);
+			else
+				pr_out("  %s:\n", occ_watch_kind_label[kind]);
+			for (i = 0; i < port->item_count[kind] && !err; i++) {
+				item = &port->items[kind][i];
+				if (!item->sample_count)
+					continue;
+				err = pr_out_occ_watch_summary_item(dl, item, i,
+						kind != OCC_WATCH_POOL);
+			}
+			if (dl->json_output)
+				close_json_object();
+		}
+		if (dl->json_output)
+			close_json_object();
+	}
+	pr_out_section_end(dl);
+	return err;
+}
+
+static int cmd_sb_occ_watch(struct dl *dl)
+{
+	struct dl_opts *opts = &dl->opts;
+	struct occ_watch watch = {
+		.dl = dl,
+	};
+	struct dl_watch dl_watch;
+	int err;
+
+	err = dl_argv_parse(dl, DL_OPT_HANDLE | DL_OPT_HANDLEP,
+			    DL_OPT_SB | DL_OPT_INTERVAL | DL_OPT_COUNT);
+	if (err)
+		return err;
+
+	err = ifname_map_nice_names_load(dl);
+	if (err)
+		return err;
+
+	watch.samples_max = OCC_WATCH_SAMPLES_MAX;
+	if (opts->present & DL_OPT_COUNT && opts->count &&
+	    opts->count < watch.samples_max)
+		watch.samples_max = opts->count;
+
+	dl_watch_start(&dl_watch, opts->present & DL_OPT_INTERVAL ?
+		       opts->interval : DL_WATCH_INTERVAL_DEFAULT);
+	while (dl_watch_running()) {
+		err = dl_watch_sample_err(occ_watch_sample(&watch));
+		if (err)
+			break;
+		pr_out_occ_watch(&watch, dl_watch_elapsed_ms(&dl_watch));
+
+		watch.iteration++;
+		if (opts->present & DL_OPT_COUNT &&
+		    watch.iteration == opts->count)
+			break;
+		dl_watch_sleep(&dl_watch);
+	}
+	dl_watch_end(&dl_watch);
+
+	if (!err && watch.iteration)
+		err = pr_out_occ_watch_summary(&watch);
+	occ_watch_free(&watch);
+	return err;
 }
 
 static int cmd_sb_occ(struct dl *dl)
@@ -5165,6 +6213,9 @@ static int cmd_sb_occ(struct dl *dl)
 	} else if (dl_argv_match(dl, "clearmax")) {
 		dl_arg_inc(dl);
 		return cmd_sb_occ_clearmax(dl);
+	} else if (dl_argv_match(dl, "watch")) {
+		dl_arg_inc(dl);
+		return cmd_sb_occ_watch(dl);
 	}
 	pr_err("Command \"%s\" not found\n", dl_argv(dl));
 	return -ENOENT;
@@ -5504,6 +6555,9 @@ static int cmd_mon_show(struct dl *dl)
 			return -EINVAL;
 		}
 	}
+	if (dl_batch_pipelined(dl))
+		dl_batch_flush(dl);
+
 	err = _mnlg_socket_group_add(&dl->nlg, DEVLINK_GENL_MCGRP_CONFIG_NAME);
 	if (err)
 		return err;
@@ -5649,6 +6703,12 @@ struct dpipe_ctx {
 	int err;
 	struct list_head global_headers;
 	struct list_head local_headers;
+	/* Headers indexed by id, [0] local and [1] global. */
+	struct dpipe_header **header_index[2];
+	unsigned int header_index_len[2];
+	bool header_index_valid;
+	bool compact;
+	json_writer_t *jw;
 	struct dpipe_tables *tables;
 	struct resources *resources;
 	bool print_headers;
@@ -5698,6 +6758,7 @@ static void dpipe_header_add(struct dpipe_ctx *ctx,
 		list_add(&header->list, &ctx->global_headers);
 	else
 		list_add(&header->list, &ctx->local_headers);
+	ctx->header_index_valid = false;
 }
 
 static void dpipe_header_del(struct dpipe_header *header)
@@ -5763,44 +6824,103 @@ static void dpipe_ctx_fini(struct dpipe_ctx *ctx)
 		dpipe_header_clear(header);
 		dpipe_header_free(header);
 	}
+	free(ctx->header_index[0]);
+	free(ctx->header_index[1]);
 	dpipe_tables_free(ctx->tables);
 }
 
-static const char *dpipe_header_id2s(struct dpipe_ctx *ctx,
-				     uint32_t header_id, bool global)
+/* Header ids are small in practice. Devices reporting larger ones are
+ * looked up by walking the header list instead of indexing.
+ */
+#define DPIPE_HEADER_INDEX_MAX	4096
+
+static struct list_head *dpipe_header_list(struct dpipe_ctx *ctx, bool global)
 {
-	struct list_head *header_list;
-	struct dpipe_header *header;
+	return global ? &ctx->global_headers : &ctx->local_headers;
+}
+
+static int dpipe_header_index_build_one(struct dpipe_ctx *ctx, bool global)
+{
+	struct list_head *header_list = dpipe_header_list(ctx, global);
+	struct dpipe_header **index, *header;
+	unsigned int len = 0;
+
+	free(ctx->header_index[global]);
+	ctx->header_index[global] = NULL;
+	ctx->header_index_len[global] = 0;
 
-	if (global)
-		header_list = &ctx->global_headers;
-	else
-		header_list = &ctx->local_headers;
 	list_for_each_entry(header, header_list, list) {
-		if (header->id != header_id)
-			continue;
-		return header->name;
+		if (header->id >= DPIPE_HEADER_INDEX_MAX)
+			return 0;
+		if (header->id >= len)
+			len = header->id + 1;
+	}
+
+	index = calloc(len ? len : 1, sizeof(*index));
+	if (!index)
+		return -ENOMEM;
+	/* Same pick as a linear search of the newest first list. */
+	list_for_each_entry(header, header_list, list)
+		if (!index[header->id])
+			index[header->id] = header;
+
+	ctx->header_index[global] = index;
+	ctx->header_index_len[global] = len;
+	return 0;
+}
+
+static struct dpipe_header *dpipe_header_lookup(struct dpipe_ctx *ctx,
+						uint32_t header_id, bool global)
+{
+	struct dpipe_header *header;
+
+	if (!ctx->header_index_valid) {
+		if (dpipe_header_index_build_one(ctx, false) ||
+		    dpipe_header_index_build_one(ctx, true))
+			return NULL;
+		ctx->header_index_valid = true;
+	}
+	if (ctx->header_index[global]) {
+		if (header_id >= ctx->header_index_len[global])
+			return NULL;
+		return ctx->header_index[global][header_id];
 	}
+
+	list_for_each_entry(header, dpipe_header_list(ctx, global), list)
+		if (header->id == header_id)
+			return header;
 	return NULL;
 }
 
+static struct dpipe_field *dpipe_field_lookup(struct dpipe_ctx *ctx,
+					      uint32_t header_id,
+					      uint32_t field_id, bool global)
+{
+	struct dpipe_header *header;
+
+	header = dpipe_header_lookup(ctx, header_id, global);
+	if (!header || field_id >= header->fields_count)
+		return NULL;
+	return &header->fields[field_id];
+}
+
+static const char *dpipe_header_id2s(struct dpipe_ctx *ctx,
+				     uint32_t header_id, bool global)
+{
+	struct dpipe_header *header;
+
+	header = dpipe_header_lookup(ctx, header_id, global);
+	return header ? header->name : NULL;
+}
+
 static const char *dpipe_field_id2s(struct dpipe_ctx *ctx,
 				    uint32_t header_id,
 				    uint32_t field_id, bool global)
 {
-	struct list_head *header_list;
-	struct dpipe_header *header;
+	struct dpipe_field *field;
 
-	if (global)
-		header_list = &ctx->global_headers;
-	else
-		header_list = &ctx->local_headers;
-	list_for_each_entry(header, header_list, list) {
-		if (header->id != header_id)
-			continue;
-		return header->fields[field_id].name;
-	}
-	return NULL;
+	field = dpipe_field_lookup(ctx, header_id, field_id, global);
+	return field ? field->name : NULL;
 }
 
 static const char *
@@ -5820,21 +6940,10 @@ static const char *
 dpipe_mapping_get(struct dpipe_ctx *ctx, uint32_t header_id,
 		  uint32_t field_id, bool global)
 {
-	enum devlink_dpipe_field_mapping_type mapping_type;
-	struct list_head *header_list;
-	struct dpipe_header *header;
+	struct dpipe_field *field;
 
-	if (global)
-		header_list = &ctx->global_headers;
-	else
-		header_list = &ctx->local_headers;
-	list_for_each_entry(header, header_list, list) {
-		if (header->id != header_id)
-			continue;
-		mapping_type = header->fields[field_id].mapping_type;
-		return dpipe_field_mapping_e2s(mapping_type);
-	}
-	return NULL;
+	field = dpipe_field_lookup(ctx, header_id, field_id, global);
+	return field ? dpipe_field_mapping_e2s(field->mapping_type) : NULL;
 }
 
 static void pr_out_dpipe_fields(struct dpipe_ctx *ctx,
@@ -6038,7 +7147,7 @@ static int cmd_dpipe_headers_show(struct dl *dl)
 	ctx.print_headers = true;
 
 	pr_out_section_start(dl, "header");
-	err = mnlu_gen_socket_sndrcv(&dl->nlg, nlh, cmd_dpipe_header_cb, &ctx);
+	err = dl_sndrcv(dl, nlh, cmd_dpipe_header_cb, &ctx);
 	if (err)
 		pr_err("error get headers %s\n", strerror(ctx.err));
 	pr_out_section_end(dl);
@@ -6052,7 +7161,7 @@ static void cmd_dpipe_help(void)
 	pr_err("Usage: devlink dpipe table show DEV [ name TABLE_NAME ]\n");
 	pr_err("       devlink dpipe table set DEV name TABLE_NAME\n");
 	pr_err("                               [ counters_enabled { true | false } ]\n");
-	pr_err("       devlink dpipe table dump DEV name TABLE_NAME\n");
+	pr_err("       devlink dpipe table dump DEV name TABLE_NAME [ compact ]\n");
 	pr_err("       devlink dpipe header show DEV\n");
 }
 
@@ -6436,8 +7545,7 @@ static int cmd_dpipe_table_show(struct dl *dl)
 	dpipe_ctx.print_tables = true;
 
 	dl_opts_put(nlh, dl);
-	err = mnlu_gen_socket_sndrcv(&dl->nlg, nlh, cmd_dpipe_header_cb,
-				  &dpipe_ctx);
+	err = dl_sndrcv(dl, nlh, cmd_dpipe_header_cb, &dpipe_ctx);
 	if (err) {
 		pr_err("error get headers %s\n", strerror(dpipe_ctx.err));
 		goto err_headers_get;
@@ -6450,8 +7558,7 @@ static int cmd_dpipe_table_show(struct dl *dl)
 	resource_ctx.print_resources = false;
 	nlh = mnlu_gen_socket_cmd_prepare(&dl->nlg, DEVLINK_CMD_RESOURCE_DUMP, flags);
 	dl_opts_put(nlh, dl);
-	err = mnlu_gen_socket_sndrcv(&dl->nlg, nlh, cmd_resource_dump_cb,
-				  &resource_ctx);
+	err = dl_sndrcv(dl, nlh, cmd_resource_dump_cb, &resource_ctx);
 	if (!err)
 		dpipe_ctx.resources = resource_ctx.resources;
 
@@ -6460,7 +7567,7 @@ static int cmd_dpipe_table_show(struct dl *dl)
 	dl_opts_put(nlh, dl);
 
 	pr_out_section_start(dl, "table");
-	mnlu_gen_socket_sndrcv(&dl->nlg, nlh, cmd_dpipe_table_show_cb, &dpipe_ctx);
+	dl_sndrcv(dl, nlh, cmd_dpipe_table_show_cb, &dpipe_ctx);
 	pr_out_section_end(dl);
 
 	resource_ctx_fini(&resource_ctx);
@@ -6487,7 +7594,7 @@ static int cmd_dpipe_table_set(struct dl *dl)
 	if (err)
 		return err;
 
-	return mnlu_gen_socket_sndrcv(&dl->nlg, nlh, NULL, NULL);
+	return dl_sndrcv(dl, nlh, NULL, NULL);
 }
 
 enum dpipe_value_type {
@@ -6824,18 +7931,250 @@ err_entry_show:
 	return -EINVAL;
 }
 
+/* Compact output prints every entry on its own line, as a single JSON
+ * object in JSON mode, so that huge tables can be processed as they are
+ * dumped instead of as one nested document.
+ */
+#define DPIPE_COMPACT_STR_LEN	128
+
+static void dpipe_compact_field_name(struct dpipe_ctx *ctx,
+				     struct dpipe_op_info *info,
+				     char *buf, size_t size)
+{
+	struct dpipe_header *header;
+	struct dpipe_field *field;
+
+	header = dpipe_header_lookup(ctx, info->header_id, info->header_global);
+	field = dpipe_field_lookup(ctx, info->header_id, info->field_id,
+				   info->header_global);
+	if (header && field)
+		snprintf(buf, size, "%s.%s", header->name, field->name);
+	else
+		snprintf(buf, size, "%u.%u", info->header_id, info->field_id);
+}
+
+/* Returns true if the value is a plain number rather than a string. */
+static bool dpipe_compact_value_str(struct dpipe_op_info *info,
+				    struct nlattr *nla_value,
+				    char *buf, size_t size)
+{
+	uint16_t value_len = mnl_attr_get_payload_len(nla_value);
+	uint8_t *value = mnl_attr_get_payload(nla_value);
+	struct in_addr ip_addr;
+	int i, n;
+
+	if (info->header_global) {
+		if (info->header_id == DEVLINK_DPIPE_HEADER_IPV4 &&
+		    info->field_id == DEVLINK_DPIPE_FIELD_IPV4_DST_IP &&
+		    value_len == sizeof(uint32_t)) {
+			ip_addr.s_addr = htonl(*(uint32_t *)value);
+			inet_ntop(AF_INET, &ip_addr, buf, size);
+			return false;
+		}
+		if (info->header_id == DEVLINK_DPIPE_HEADER_ETHERNET &&
+		    info->field_id == DEVLINK_DPIPE_FIELD_ETHERNET_DST_MAC &&
+		    value_len == ETH_ALEN) {
+			ll_addr_n2a(value, ETH_ALEN, 0, buf, size);
+			return false;
+		}
+		if (info->header_id == DEVLINK_DPIPE_HEADER_IPV6 &&
+		    info->field_id == DEVLINK_DPIPE_FIELD_IPV6_DST_IP &&
+		    value_len == sizeof(struct in6_addr)) {
+			inet_ntop(AF_INET6, value, buf, size);
+			return false;
+		}
+	}
+
+	if (value_len == sizeof(uint32_t)) {
+		snprintf(buf, size, "%u", *(uint32_t *)value);
+		return true;
+	}
+
+	n = snprintf(buf, size, "0x");
+	for (i = 0; i < value_len && n + 3 <= size; i++)
+		n += sprintf(buf + n, "%02x", value[i]);
+	return false;
+}
+
+static int dpipe_compact_value_show(struct dpipe_ctx *ctx,
+				    json_writer_t *jw,
+				    struct nlattr *nl, bool action)
+{
+	struct nlattr *nla_value[DEVLINK_ATTR_MAX + 1] = {};
+	char field[DPIPE_COMPACT_STR_LEN];
+	char value[DPIPE_COMPACT_STR_LEN];
+	char mask[DPIPE_COMPACT_STR_LEN];
+	struct nlattr *nla_value_mask;
+	struct nlattr *nla_mapping;
+	struct dpipe_op_info *info;
+	struct dpipe_action act;
+	struct dpipe_match match;
+	const char *mapping;
+	bool numeric;
+	int err;
+
+	err = mnl_attr_parse_nested(nl, attr_cb, nla_value);
+	if (err != MNL_CB_OK || !nla_value[DEVLINK_ATTR_DPIPE_VALUE])
+		return -EINVAL;
+
+	if (action) {
+		if (!nla_value[DEVLINK_ATTR_DPIPE_ACTION] ||
+		    dpipe_action_parse(&act, nla_value[DEVLINK_ATTR_DPIPE_ACTION]))
+			return -EINVAL;
+		info = &act.info;
+	} else {
+		if (!nla_value[DEVLINK_ATTR_DPIPE_MATCH] ||
+		    dpipe_match_parse(&match, nla_value[DEVLINK_ATTR_DPIPE_MATCH]))
+			return -EINVAL;
+		info = &match.info;
+	}
+
+	dpipe_compact_field_name(ctx, info, field, sizeof(field));
+	numeric = dpipe_compact_value_str(info, nla_value[DEVLINK_ATTR_DPIPE_VALUE],
+					  value, sizeof(value));
+	nla_value_mask = nla_value[DEVLINK_ATTR_DPIPE_VALUE_MASK];
+	if (nla_value_mask)
+		dpipe_compact_value_str(info, nla_value_mask, mask,
+					sizeof(mask));
+	nla_mapping = nla_value[DEVLINK_ATTR_DPIPE_VALUE_MAPPING];
+	mapping = dpipe_mapping_get(ctx, info->header_id, info->field_id,
+				    info->header_global);
+
+	if (!jw) {
+		pr_out(" %s=%s", field, value);
+		if (nla_value_mask)
+			pr_out("/%s", mask);
+		if (mapping && nla_mapping)
+			pr_out(",%s=%u", mapping, mnl_attr_get_u32(nla_mapping));
+		return 0;
+	}
+
+	jsonw_start_object(jw);
+	jsonw_string_field(jw, "field", field);
+	if (numeric)
+		jsonw_uint_field(jw, "value",
+				 mnl_attr_get_u32(nla_value[DEVLINK_ATTR_DPIPE_VALUE]));
+	else
+		jsonw_string_field(jw, "value", value);
+	if (nla_value_mask)
+		jsonw_string_field(jw, "mask", mask);
+	if (mapping && nla_mapping) {
+		jsonw_string_field(jw, "mapping", mapping);
+		jsonw_uint_field(jw, "mapping_value",
+				 mnl_attr_get_u32(nla_mapping));
+	}
+	jsonw_end_object(jw);
+	return 0;
+}
+
+static int dpipe_compact_values_show(struct dpipe_ctx *ctx,
+				     json_writer_t *jw, const char *name,
+				     struct nlattr *nla_values, bool action)
+{
+	struct nlattr *nla_value;
+	int err = 0;
+
+	if (jw) {
+		jsonw_name(jw, name);
+		jsonw_start_array(jw);
+	} else {
+		pr_out(" %s", name);
+	}
+	mnl_attr_for_each_nested(nla_value, nla_values) {
+		err = dpipe_compact_value_show(ctx, jw, nla_value, action);
+		if (err)
+			break;
+	}
+	if (jw)
+		jsonw_end_array(jw);
+	return err;
+}
+
+static int dpipe_entry_compact_show(struct dpipe_ctx *ctx, struct nlattr **tb,
+				    struct nlattr *nl)
+{
+	struct nlattr *nla_entry[DEVLINK_ATTR_MAX + 1] = {};
+	const char *bus_name, *dev_name;
+	char handle[DPIPE_COMPACT_STR_LEN];
+	json_writer_t *jw = ctx->jw;
+	uint32_t entry_index;
+	int err;
+
+	err = mnl_attr_parse_nested(nl, attr_cb, nla_entry);
+	if (err != MNL_CB_OK)
+		return -EINVAL;
+
+	if (!nla_entry[DEVLINK_ATTR_DPIPE_ENTRY_INDEX] ||
+	    !nla_entry[DEVLINK_ATTR_DPIPE_ENTRY_MATCH_VALUES] ||
+	    !nla_entry[DEVLINK_ATTR_DPIPE_ENTRY_ACTION_VALUES]) {
+		return -EINVAL;
+	}
+
+	bus_name = mnl_attr_get_str(tb[DEVLINK_ATTR_BUS_NAME]);
+	dev_name = mnl_attr_get_str(tb[DEVLINK_ATTR_DEV_NAME]);
+	entry_index = mnl_attr_get_u32(nla_entry[DEVLINK_ATTR_DPIPE_ENTRY_INDEX]);
+
+	if (jw) {
+		jsonw_new_line(jw);
+		snprintf(handle, sizeof(handle), "%s/%s", bus_name, dev_name);
+		jsonw_start_object(jw);
+		jsonw_string_field(jw, "dev", handle);
+		jsonw_uint_field(jw, "index", entry_index);
+		if (nla_entry[DEVLINK_ATTR_DPIPE_ENTRY_COUNTER])
+			jsonw_u64_field(jw, "counter",
+					mnl_attr_get_u64(nla_entry[DEVLINK_ATTR_DPIPE_ENTRY_COUNTER]));
+	} else {
+		pr_out("%s/%s index %u", bus_name, dev_name, entry_index);
+		if (nla_entry[DEVLINK_ATTR_DPIPE_ENTRY_COUNTER])
+			pr_out(" counter %" PRIu64,
+			       mnl_attr_get_u64(nla_entry[DEVLINK_ATTR_DPIPE_ENTRY_COUNTER]));
+	}
+
+	err = dpipe_compact_values_show(ctx, jw, "match",
+					nla_entry[DEVLINK_ATTR_DPIPE_ENTRY_MATCH_VALUES],
+					false);
+	if (!err)
+		err = dpipe_compact_values_show(ctx, jw, "action",
+						nla_entry[DEVLINK_ATTR_DPIPE_ENTRY_ACTION_VALUES],
+						true);
+
+	if (jw)
+		jsonw_end_object(jw);
+	else
+		pr_out("\n");
+	return err;
+}
+
+static int dpipe_table_entries_compact_show(struct dpipe_ctx *ctx,
+					    struct nlattr **tb)
+{
+	struct nlattr *nla_entries = tb[DEVLINK_ATTR_DPIPE_ENTRIES];
+	struct nlattr *nla_entry;
+
+	mnl_attr_for_each_nested(nla_entry, nla_entries) {
+		if (dpipe_entry_compact_show(ctx, tb, nla_entry))
+			return -EINVAL;
+	}
+	return 0;
+}
+
 static int cmd_dpipe_table_entry_dump_cb(const struct nlmsghdr *nlh, void *data)
 {
 	struct dpipe_ctx *ctx = data;
 	struct nlattr *tb[DEVLINK_ATTR_MAX + 1] = {};
 	struct genlmsghdr *genl = mnl_nlmsg_get_payload(nlh);
+	int err;
 
 	mnl_attr_parse(nlh, sizeof(*genl), attr_cb, tb);
 	if (!tb[DEVLINK_ATTR_BUS_NAME] || !tb[DEVLINK_ATTR_DEV_NAME] ||
 	    !tb[DEVLINK_ATTR_DPIPE_ENTRIES])
 		return MNL_CB_ERROR;
 
-	if (dpipe_table_entries_show(ctx, tb))
+	if (ctx->compact)
+		err = dpipe_table_entries_compact_show(ctx, tb);
+	else
+		err = dpipe_table_entries_show(ctx, tb);
+	if (err)
 		return MNL_CB_ERROR;
 	return MNL_CB_OK;
 }
@@ -6851,13 +8190,15 @@ static int cmd_dpipe_table_dump(struct dl *dl)
 	if (err)
 		return err;
 
-	err = dl_argv_parse(dl, DL_OPT_HANDLE | DL_OPT_DPIPE_TABLE_NAME, 0);
+	err = dl_argv_parse(dl, DL_OPT_HANDLE | DL_OPT_DPIPE_TABLE_NAME,
+			    DL_OPT_DPIPE_COMPACT);
 	if (err)
 		goto out;
+	ctx.compact = dl->opts.present & DL_OPT_DPIPE_COMPACT;
 
 	nlh = mnlu_gen_socket_cmd_prepare(&dl->nlg, DEVLINK_CMD_DPIPE_HEADERS_GET, flags);
 	dl_opts_put(nlh, dl);
-	err = mnlu_gen_socket_sndrcv(&dl->nlg, nlh, cmd_dpipe_header_cb, &ctx);
+	err = dl_sndrcv(dl, nlh, cmd_dpipe_header_cb, &ctx);
 	if (err) {
 		pr_err("error get headers %s\n", strerror(ctx.err));
 		goto out;
@@ -6867,8 +8208,14 @@ static int cmd_dpipe_table_dump(struct dl *dl)
 	nlh = mnlu_gen_socket_cmd_prepare(&dl->nlg, DEVLINK_CMD_DPIPE_ENTRIES_GET, flags);
 	dl_opts_put(nlh, dl);
 
+	if (ctx.compact) {
+		ctx.jw = get_json_writer();
+		err = dl_sndrcv(dl, nlh, cmd_dpipe_table_entry_dump_cb, &ctx);
+		goto out;
+	}
+
 	pr_out_section_start(dl, "table_entry");
-	mnlu_gen_socket_sndrcv(&dl->nlg, nlh, cmd_dpipe_table_entry_dump_cb, &ctx);
+	dl_sndrcv(dl, nlh, cmd_dpipe_table_entry_dump_cb, &ctx);
 	pr_out_section_end(dl);
 out:
 	dpipe_ctx_fini(&ctx);
@@ -7140,8 +8487,7 @@ static int cmd_resource_show(struct dl *dl)
 	if (err)
 		return err;
 
-	err = mnlu_gen_socket_sndrcv(&dl->nlg, nlh, cmd_dpipe_table_show_cb,
-				  &dpipe_ctx);
+	err = dl_sndrcv(dl, nlh, cmd_dpipe_table_show_cb, &dpipe_ctx);
 	if (err) {
 		pr_err("error get tables %s\n", strerror(dpipe_ctx.err));
 		goto out;
@@ -7157,8 +8503,7 @@ static int cmd_resource_show(struct dl *dl)
 			       NLM_F_REQUEST | NLM_F_ACK);
 	dl_opts_put(nlh, dl);
 	pr_out_section_start(dl, "resources");
-	err = mnlu_gen_socket_sndrcv(&dl->nlg, nlh, cmd_resource_dump_cb,
-				  &resource_ctx);
+	err = dl_sndrcv(dl, nlh, cmd_resource_dump_cb, &resource_ctx);
 	pr_out_section_end(dl);
 	resource_ctx_fini(&resource_ctx);
 out:
@@ -7236,7 +8581,7 @@ static int cmd_resource_set(struct dl *dl)
 	nlh = mnlu_gen_socket_cmd_prepare(&dl->nlg, DEVLINK_CMD_RESOURCE_DUMP,
 			       NLM_F_REQUEST);
 	dl_opts_put(nlh, dl);
-	err = mnlu_gen_socket_sndrcv(&dl->nlg, nlh, cmd_resource_dump_cb, &ctx);
+	err = dl_sndrcv(dl, nlh, cmd_resource_dump_cb, &ctx);
 	if (err) {
 		pr_err("error getting resources %s\n", strerror(ctx.err));
 		goto out;
@@ -7254,7 +8599,7 @@ static int cmd_resource_set(struct dl *dl)
 			       NLM_F_REQUEST | NLM_F_ACK);
 
 	dl_opts_put(nlh, dl);
-	err = mnlu_gen_socket_sndrcv(&dl->nlg, nlh, NULL, NULL);
+	err = dl_sndrcv(dl, nlh, NULL, NULL);
 out:
 	resource_ctx_fini(&ctx);
 	return err;
@@ -7404,7 +8749,7 @@ static int cmd_region_show(struct dl *dl)
 	}
 
 	pr_out_section_start(dl, "regions");
-	err = mnlu_gen_socket_sndrcv(&dl->nlg, nlh, cmd_region_show_cb, dl);
+	err = dl_sndrcv(dl, nlh, cmd_region_show_cb, dl);
 	pr_out_section_end(dl);
 	return err;
 }
@@ -7422,7 +8767,7 @@ static int cmd_region_snapshot_del(struct dl *dl)
 	if (err)
 		return err;
 
-	return mnlu_gen_socket_sndrcv(&dl->nlg, nlh, NULL, NULL);
+	return dl_sndrcv(dl, nlh, NULL, NULL);
 }
 
 static int cmd_region_read_cb(const struct nlmsghdr *nlh, void *data)
@@ -7431,7 +8776,7 @@ static int cmd_region_read_cb(const struct nlmsghdr *nlh, void *data)
 	struct genlmsghdr *genl = mnl_nlmsg_get_payload(nlh);
 	struct nlattr *tb_field[DEVLINK_ATTR_MAX + 1] = {};
 	struct nlattr *tb[DEVLINK_ATTR_MAX + 1] = {};
-	struct dl *dl = data;
+	struct region_read_ctx *ctx = data;
 	int err;
 
 	mnl_attr_parse(nlh, sizeof(*genl), attr_cb, tb);
@@ -7452,13 +8797,53 @@ static int cmd_region_read_cb(const struct nlmsghdr *nlh, void *data)
 		if (!nla_chunk_addr)
 			continue;
 
-		pr_out_region_chunk(dl, mnl_attr_get_payload(nla_chunk_data),
-				    mnl_attr_get_payload_len(nla_chunk_data),
-				    mnl_attr_get_u64(nla_chunk_addr));
+		err = pr_out_region_chunk(ctx,
+					  mnl_attr_get_payload(nla_chunk_data),
+					  mnl_attr_get_payload_len(nla_chunk_data),
+					  mnl_attr_get_u64(nla_chunk_addr));
+		if (err)
+			return MNL_CB_ERROR;
 	}
 	return MNL_CB_OK;
 }
 
+static int region_read_run(struct dl *dl, struct nlmsghdr *nlh,
+			   const char *section)
+{
+	struct dl_opts *opts = &dl->opts;
+	struct region_read_ctx ctx = {
+		.dl = dl,
+		.fd = -1,
+	};
+	int err;
+
+	if (opts->present & DL_OPT_REGION_FILE_NAME) {
+		ctx.fd = open(opts->region_file_name,
+			      O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if (ctx.fd < 0) {
+			pr_err("Failed to open \"%s\": %s\n",
+			       opts->region_file_name, strerror(errno));
+			return -errno;
+		}
+		if (opts->present & DL_OPT_REGION_ADDRESS)
+			ctx.base = opts->region_address;
+		err = dl_sndrcv(dl, nlh, cmd_region_read_cb, &ctx);
+		if (close(ctx.fd) && !err) {
+			pr_err("Failed to write \"%s\": %s\n",
+			       opts->region_file_name, strerror(errno));
+			err = -errno;
+		}
+		return err;
+	}
+
+	pr_out_section_start(dl, section);
+	err = dl_sndrcv(dl, nlh, cmd_region_read_cb, &ctx);
+	pr_out_section_end(dl);
+	if (!dl->json_output)
+		pr_out("\n");
+	return err;
+}
+
 static int cmd_region_dump(struct dl *dl)
 {
 	struct nlmsghdr *nlh;
@@ -7468,16 +8853,12 @@ static int cmd_region_dump(struct dl *dl)
 			       NLM_F_REQUEST | NLM_F_ACK | NLM_F_DUMP);
 
 	err = dl_argv_parse_put(nlh, dl, DL_OPT_HANDLE_REGION |
-				DL_OPT_REGION_SNAPSHOT_ID, 0);
+				DL_OPT_REGION_SNAPSHOT_ID,
+				DL_OPT_REGION_FILE_NAME);
 	if (err)
 		return err;
 
-	pr_out_section_start(dl, "dump");
-	err = mnlu_gen_socket_sndrcv(&dl->nlg, nlh, cmd_region_read_cb, dl);
-	pr_out_section_end(dl);
-	if (!dl->json_output)
-		pr_out("\n");
-	return err;
+	return region_read_run(dl, nlh, "dump");
 }
 
 static int cmd_region_read(struct dl *dl)
@@ -7490,16 +8871,12 @@ static int cmd_region_read(struct dl *dl)
 
 	err = dl_argv_parse_put(nlh, dl, DL_OPT_HANDLE_REGION |
 				DL_OPT_REGION_ADDRESS | DL_OPT_REGION_LENGTH |
-				DL_OPT_REGION_SNAPSHOT_ID, 0);
+				DL_OPT_REGION_SNAPSHOT_ID,
+				DL_OPT_REGION_FILE_NAME);
 	if (err)
 		return err;
 
-	pr_out_section_start(dl, "read");
-	err = mnlu_gen_socket_sndrcv(&dl->nlg, nlh, cmd_region_read_cb, dl);
-	pr_out_section_end(dl);
-	if (!dl->json_output)
-		pr_out("\n");
-	return err;
+	return region_read_run(dl, nlh, "read");
 }
 
 static int cmd_region_snapshot_new_cb(const struct nlmsghdr *nlh, void *data)
@@ -7533,7 +8910,7 @@ static int cmd_region_snapshot_new(struct dl *dl)
 		return err;
 
 	pr_out_section_start(dl, "regions");
-	err = mnlu_gen_socket_sndrcv(&dl->nlg, nlh, cmd_region_snapshot_new_cb, dl);
+	err = dl_sndrcv(dl, nlh, cmd_region_snapshot_new_cb, dl);
 	pr_out_section_end(dl);
 	return err;
 }
@@ -7543,8 +8920,8 @@ static void cmd_region_help(void)
 	pr_err("Usage: devlink region show [ DEV/REGION ]\n");
 	pr_err("       devlink region del DEV/REGION snapshot SNAPSHOT_ID\n");
 	pr_err("       devlink region new DEV/REGION snapshot SNAPSHOT_ID\n");
-	pr_err("       devlink region dump DEV/REGION [ snapshot SNAPSHOT_ID ]\n");
-	pr_err("       devlink region read DEV/REGION [ snapshot SNAPSHOT_ID ] address ADDRESS length LENGTH\n");
+	pr_err("       devlink region dump DEV/REGION [ snapshot SNAPSHOT_ID ] [ file FILE ]\n");
+	pr_err("       devlink region read DEV/REGION [ snapshot SNAPSHOT_ID ] address ADDRESS length LENGTH [ file FILE ]\n");
 }
 
 static int cmd_region(struct dl *dl)
@@ -7589,7 +8966,7 @@ static int cmd_health_set_params(struct dl *dl)
 		return err;
 
 	dl_opts_put(nlh, dl);
-	return mnlu_gen_socket_sndrcv(&dl->nlg, nlh, NULL, NULL);
+	return dl_sndrcv(dl, nlh, NULL, NULL);
 }
 
 static int cmd_health_dump_clear(struct dl *dl)
@@ -7607,7 +8984,7 @@ static int cmd_health_dump_clear(struct dl *dl)
 		return err;
 
 	dl_opts_put(nlh, dl);
-	return mnlu_gen_socket_sndrcv(&dl->nlg, nlh, NULL, NULL);
+	return dl_sndrcv(dl, nlh, NULL, NULL);
 }
 
 static int fmsg_value_show(struct dl *dl, int type, struct nlattr *nl_data)
@@ -7855,7 +9232,7 @@ static int cmd_health_object_common(struct dl *dl, uint8_t cmd, uint16_t flags)
 		return err;
 
 	cmd_fmsg_init(dl, &data);
-	err = mnlu_gen_socket_sndrcv(&dl->nlg, nlh, cmd_fmsg_object_cb, &data);
+	err = dl_sndrcv(dl, nlh, cmd_fmsg_object_cb, &data);
 	free(data.name);
 	return err;
 }
@@ -7896,7 +9273,7 @@ static int cmd_health_recover(struct dl *dl)
 		return err;
 
 	dl_opts_put(nlh, dl);
-	return mnlu_gen_socket_sndrcv(&dl->nlg, nlh, NULL, NULL);
+	return dl_sndrcv(dl, nlh, NULL, NULL);
 }
 
 enum devlink_health_reporter_state {
@@ -8043,10 +9420,18 @@ static int cmd_health_show_cb(const struct nlmsghdr *nlh, void *data)
 	struct health_ctx *ctx = data;
 	struct dl *dl = ctx->dl;
 
+	if (!dl_dump_filter_nlh(dl, nlh))
+		return MNL_CB_OK;
+
 	mnl_attr_parse(nlh, sizeof(*genl), attr_cb, tb);
 	if (!tb[DEVLINK_ATTR_BUS_NAME] || !tb[DEVLINK_ATTR_DEV_NAME] ||
 	    !tb[DEVLINK_ATTR_HEALTH_REPORTER])
 		return MNL_CB_ERROR;
+	if (!dl_dump_filter(dl, tb))
+		return MNL_CB_OK;
+	/* a port handle leaves out the reporters of the device itself */
+	if (dl->opts.present & DL_OPT_HANDLEP && !tb[DEVLINK_ATTR_PORT_INDEX])
+		return MNL_CB_OK;
 
 	pr_out_health(dl, tb, ctx->show_device, ctx->show_port);
 
@@ -8060,29 +9445,35 @@ static int __cmd_health_show(struct dl *dl, bool show_device, bool show_port)
 	uint16_t flags = NLM_F_REQUEST | NLM_F_ACK;
 	int err;
 
-	if (dl_argc(dl) == 0)
-		flags |= NLM_F_DUMP;
-	nlh = mnlu_gen_socket_cmd_prepare(&dl->nlg, DEVLINK_CMD_HEALTH_REPORTER_GET,
-			       flags);
-
 	if (dl_argc(dl) > 0) {
 		ctx.show_port = true;
-		err = dl_argv_parse_put(nlh, dl,
-					DL_OPT_HANDLE | DL_OPT_HANDLEP |
-					DL_OPT_HEALTH_REPORTER_NAME, 0);
+		err = dl_argv_parse(dl, DL_OPT_HANDLE | DL_OPT_HANDLEP,
+				    DL_OPT_HEALTH_REPORTER_NAME);
 		if (err)
 			return err;
 	}
+
+	/* A device or port handle selects all of its reporters. */
+	if (!(dl->opts.present & DL_OPT_HEALTH_REPORTER_NAME))
+		flags |= NLM_F_DUMP;
+
+	nlh = mnlu_gen_socket_cmd_prepare(&dl->nlg, DEVLINK_CMD_HEALTH_REPORTER_GET,
+			       flags);
+
+	if (flags & NLM_F_DUMP)
+		dl_dump_selector_put(nlh, dl);
+	else
+		dl_opts_put(nlh, dl);
 	pr_out_section_start(dl, "health");
 
-	err = mnlu_gen_socket_sndrcv(&dl->nlg, nlh, cmd_health_show_cb, &ctx);
+	err = dl_sndrcv(dl, nlh, cmd_health_show_cb, &ctx);
 	pr_out_section_end(dl);
 	return err;
 }
 
 static void cmd_health_help(void)
 {
-	pr_err("Usage: devlink health show [ { DEV | DEV/PORT_INDEX } reporter REPORTER_NAME ]\n");
+	pr_err("Usage: devlink health show [ { DEV | DEV/PORT_INDEX } [ reporter REPORTER_NAME ] ]\n");
 	pr_err("       devlink health recover { DEV | DEV/PORT_INDEX } reporter REPORTER_NAME\n");
 	pr_err("       devlink health diagnose { DEV | DEV/PORT_INDEX } reporter REPORTER_NAME\n");
 	pr_err("       devlink health test { DEV | DEV/PORT_INDEX } reporter REPORTER_NAME\n");
@@ -8211,6 +9602,9 @@ static int cmd_trap_show_cb(const struct nlmsghdr *nlh, void *data)
 	struct nlattr *tb[DEVLINK_ATTR_MAX + 1] = {};
 	struct dl *dl = data;
 
+	if (!dl_dump_filter_nlh(dl, nlh))
+		return MNL_CB_OK;
+
 	mnl_attr_parse(nlh, sizeof(*genl), attr_cb, tb);
 	if (!tb[DEVLINK_ATTR_BUS_NAME] || !tb[DEVLINK_ATTR_DEV_NAME] ||
 	    !tb[DEVLINK_ATTR_TRAP_NAME] || !tb[DEVLINK_ATTR_TRAP_TYPE] ||
@@ -8218,6 +9612,8 @@ static int cmd_trap_show_cb(const struct nlmsghdr *nlh, void *data)
 	    !tb[DEVLINK_ATTR_TRAP_GROUP_NAME] ||
 	    !tb[DEVLINK_ATTR_TRAP_METADATA] || !tb[DEVLINK_ATTR_STATS])
 		return MNL_CB_ERROR;
+	if (!dl_dump_filter(dl, tb))
+		return MNL_CB_OK;
 
 	pr_out_trap(dl, tb, true);
 
@@ -8227,12 +9623,13 @@ static int cmd_trap_show_cb(const struct nlmsghdr *nlh, void *data)
 static void cmd_trap_help(void)
 {
 	pr_err("Usage: devlink trap set DEV trap TRAP [ action { trap | drop | mirror } ]\n");
-	pr_err("       devlink trap show [ DEV trap TRAP ]\n");
+	pr_err("       devlink trap show [ DEV [ trap TRAP ] ]\n");
 	pr_err("       devlink trap group set DEV group GROUP [ action { trap | drop | mirror } ]\n");
 	pr_err("                              [ policer POLICER ] [ nopolicer ]\n");
-	pr_err("       devlink trap group show [ DEV group GROUP ]\n");
+	pr_err("       devlink trap group show [ DEV [ group GROUP ] ]\n");
 	pr_err("       devlink trap policer set DEV policer POLICER [ rate RATE ] [ burst BURST ]\n");
-	pr_err("       devlink trap policer show DEV policer POLICER\n");
+	pr_err("       devlink trap policer show [ DEV [ policer POLICER ] ]\n");
+	pr_err("       devlink trap watch [ DEV ] [ interval MSEC ] [ count COUNT ] [ top COUNT ]\n");
 }
 
 static int cmd_trap_show(struct dl *dl)
@@ -8241,20 +9638,25 @@ static int cmd_trap_show(struct dl *dl)
 	struct nlmsghdr *nlh;
 	int err;
 
-	if (dl_argc(dl) == 0)
-		flags |= NLM_F_DUMP;
-
-	nlh = mnlu_gen_socket_cmd_prepare(&dl->nlg, DEVLINK_CMD_TRAP_GET, flags);
-
 	if (dl_argc(dl) > 0) {
-		err = dl_argv_parse_put(nlh, dl,
-					DL_OPT_HANDLE | DL_OPT_TRAP_NAME, 0);
+		err = dl_argv_parse(dl, DL_OPT_HANDLE, DL_OPT_TRAP_NAME);
 		if (err)
 			return err;
 	}
 
+	/* A device handle selects all of its traps. */
+	if (!(dl->opts.present & DL_OPT_TRAP_NAME))
+		flags |= NLM_F_DUMP;
+
+	nlh = mnlu_gen_socket_cmd_prepare(&dl->nlg, DEVLINK_CMD_TRAP_GET, flags);
+
+	if (flags & NLM_F_DUMP)
+		dl_dump_selector_put(nlh, dl);
+	else
+		dl_opts_put(nlh, dl);
+
 	pr_out_section_start(dl, "trap");
-	err = mnlu_gen_socket_sndrcv(&dl->nlg, nlh, cmd_trap_show_cb, dl);
+	err = dl_sndrcv(dl, nlh, cmd_trap_show_cb, dl);
 	pr_out_section_end(dl);
 
 	return err;
@@ -8273,7 +9675,7 @@ static int cmd_trap_set(struct dl *dl)
 	if (err)
 		return err;
 
-	return mnlu_gen_socket_sndrcv(&dl->nlg, nlh, NULL, NULL);
+	return dl_sndrcv(dl, nlh, NULL, NULL);
 }
 
 static void pr_out_trap_group(struct dl *dl, struct nlattr **tb, bool array)
@@ -8300,10 +9702,15 @@ static int cmd_trap_group_show_cb(const struct nlmsghdr *nlh, void *data)
 	struct nlattr *tb[DEVLINK_ATTR_MAX + 1] = {};
 	struct dl *dl = data;
 
+	if (!dl_dump_filter_nlh(dl, nlh))
+		return MNL_CB_OK;
+
 	mnl_attr_parse(nlh, sizeof(*genl), attr_cb, tb);
 	if (!tb[DEVLINK_ATTR_BUS_NAME] || !tb[DEVLINK_ATTR_DEV_NAME] ||
 	    !tb[DEVLINK_ATTR_TRAP_GROUP_NAME] || !tb[DEVLINK_ATTR_STATS])
 		return MNL_CB_ERROR;
+	if (!dl_dump_filter(dl, tb))
+		return MNL_CB_OK;
 
 	pr_out_trap_group(dl, tb, true);
 
@@ -8316,21 +9723,25 @@ static int cmd_trap_group_show(struct dl *dl)
 	struct nlmsghdr *nlh;
 	int err;
 
-	if (dl_argc(dl) == 0)
-		flags |= NLM_F_DUMP;
-
-	nlh = mnlu_gen_socket_cmd_prepare(&dl->nlg, DEVLINK_CMD_TRAP_GROUP_GET, flags);
-
 	if (dl_argc(dl) > 0) {
-		err = dl_argv_parse_put(nlh, dl,
-					DL_OPT_HANDLE | DL_OPT_TRAP_GROUP_NAME,
-					0);
+		err = dl_argv_parse(dl, DL_OPT_HANDLE, DL_OPT_TRAP_GROUP_NAME);
 		if (err)
 			return err;
 	}
 
+	/* A device handle selects all of its trap groups. */
+	if (!(dl->opts.present & DL_OPT_TRAP_GROUP_NAME))
+		flags |= NLM_F_DUMP;
+
+	nlh = mnlu_gen_socket_cmd_prepare(&dl->nlg, DEVLINK_CMD_TRAP_GROUP_GET, flags);
+
+	if (flags & NLM_F_DUMP)
+		dl_dump_selector_put(nlh, dl);
+	else
+		dl_opts_put(nlh, dl);
+
 	pr_out_section_start(dl, "trap_group");
-	err = mnlu_gen_socket_sndrcv(&dl->nlg, nlh, cmd_trap_group_show_cb, dl);
+	err = dl_sndrcv(dl, nlh, cmd_trap_group_show_cb, dl);
 	pr_out_section_end(dl);
 
 	return err;
@@ -8350,7 +9761,7 @@ static int cmd_trap_group_set(struct dl *dl)
 	if (err)
 		return err;
 
-	return mnlu_gen_socket_sndrcv(&dl->nlg, nlh, NULL, NULL);
+	return dl_sndrcv(dl, nlh, NULL, NULL);
 }
 
 static int cmd_trap_group(struct dl *dl)
@@ -8395,12 +9806,17 @@ static int cmd_trap_policer_show_cb(const struct nlmsghdr *nlh, void *data)
 	struct nlattr *tb[DEVLINK_ATTR_MAX + 1] = {};
 	struct dl *dl = data;
 
+	if (!dl_dump_filter_nlh(dl, nlh))
+		return MNL_CB_OK;
+
 	mnl_attr_parse(nlh, sizeof(*genl), attr_cb, tb);
 	if (!tb[DEVLINK_ATTR_BUS_NAME] || !tb[DEVLINK_ATTR_DEV_NAME] ||
 	    !tb[DEVLINK_ATTR_TRAP_POLICER_ID] ||
 	    !tb[DEVLINK_ATTR_TRAP_POLICER_RATE] ||
 	    !tb[DEVLINK_ATTR_TRAP_POLICER_BURST])
 		return MNL_CB_ERROR;
+	if (!dl_dump_filter(dl, tb))
+		return MNL_CB_OK;
 
 	pr_out_trap_policer(dl, tb, true);
 
@@ -8413,21 +9829,25 @@ static int cmd_trap_policer_show(struct dl *dl)
 	struct nlmsghdr *nlh;
 	int err;
 
-	if (dl_argc(dl) == 0)
-		flags |= NLM_F_DUMP;
-
-	nlh = mnlu_gen_socket_cmd_prepare(&dl->nlg, DEVLINK_CMD_TRAP_POLICER_GET, flags);
-
 	if (dl_argc(dl) > 0) {
-		err = dl_argv_parse_put(nlh, dl,
-					DL_OPT_HANDLE | DL_OPT_TRAP_POLICER_ID,
-					0);
+		err = dl_argv_parse(dl, DL_OPT_HANDLE, DL_OPT_TRAP_POLICER_ID);
 		if (err)
 			return err;
 	}
 
+	/* A device handle selects all of its policers. */
+	if (!(dl->opts.present & DL_OPT_TRAP_POLICER_ID))
+		flags |= NLM_F_DUMP;
+
+	nlh = mnlu_gen_socket_cmd_prepare(&dl->nlg, DEVLINK_CMD_TRAP_POLICER_GET, flags);
+
+	if (flags & NLM_F_DUMP)
+		dl_dump_selector_put(nlh, dl);
+	else
+		dl_opts_put(nlh, dl);
+
 	pr_out_section_start(dl, "trap_policer");
-	err = mnlu_gen_socket_sndrcv(&dl->nlg, nlh, cmd_trap_policer_show_cb, dl);
+	err = dl_sndrcv(dl, nlh, cmd_trap_policer_show_cb, dl);
 	pr_out_section_end(dl);
 
 	return err;
@@ -8448,7 +9868,7 @@ static int cmd_trap_policer_set(struct dl *dl)
 	if (err)
 		return err;
 
-	return mnlu_gen_socket_sndrcv(&dl->nlg, nlh, NULL, NULL);
+	return dl_sndrcv(dl, nlh, NULL, NULL);
 }
 
 static int cmd_trap_policer(struct dl *dl)
@@ -8468,6 +9888,405 @@ static int cmd_trap_policer(struct dl *dl)
 	return -ENOENT;
 }
 
+/* Trap watch: re-dump traps and policers periodically and report the
+ * ones whose counters moved the most since the previous dump. Objects
+ * are kept in a hash table keyed by device and trap name or policer id.
+ */
+#define TRAP_WATCH_HASH_SIZE	1024
+#define TRAP_WATCH_TOP_DEFAULT	10
+
+enum trap_watch_kind {
+	TRAP_WATCH_TRAP,
+	TRAP_WATCH_POLICER,
+};
+
+struct trap_watch_entry {
+	struct hlist_node hash;
+	struct list_head list;
+	enum trap_watch_kind kind;
+	char *bus_name;
+	char *dev_name;
+	char *name;		/* trap name */
+	uint32_t policer_id;
+	uint64_t packets;
+	uint64_t bytes;
+	uint64_t dropped;
+	uint64_t packet_rate;	/* per second, over the last interval */
+	uint64_t byte_rate;
+	uint64_t drop_rate;
+	unsigned int seen;	/* iteration the entry was last dumped in */
+};
+
+struct trap_watch {
+	struct dl *dl;
+	int err;
+	struct hlist_head hash[TRAP_WATCH_HASH_SIZE];
+	struct list_head list;
+	unsigned int entry_count;
+	unsigned int iteration;
+	uint64_t interval_ms;	/* time between the last two dumps */
+	bool no_policers;
+};
+
+static unsigned int trap_watch_hash(enum trap_watch_kind kind,
+				    const char *bus_name, const char *dev_name,
+				    const char *name, uint32_t policer_id)
+{
+	unsigned int hash;
+
+	hash = namehash(bus_name);
+	hash = hash * 33 + namehash(dev_name);
+	if (kind == TRAP_WATCH_TRAP)
+		hash = hash * 33 + namehash(name);
+	else
+		hash = hash * 33 + policer_id;
+	return hash & (TRAP_WATCH_HASH_SIZE - 1);
+}
+
+static struct trap_watch_entry *
+trap_watch_entry_get(struct trap_watch *watch, enum trap_watch_kind kind,
+		     struct nlattr **tb)
+{
+	const char *bus_name = mnl_attr_get_str(tb[DEVLINK_ATTR_BUS_NAME]);
+	const char *dev_name = mnl_attr_get_str(tb[DEVLINK_ATTR_DEV_NAME]);
+	struct trap_watch_entry *entry;
+	const char *name = NULL;
+	uint32_t policer_id = 0;
+	unsigned int h;
+
+	if (kind == TRAP_WATCH_TRAP)
+		name = mnl_attr_get_str(tb[DEVLINK_ATTR_TRAP_NAME]);
+	else
+		policer_id = mnl_attr_get_u32(tb[DEVLINK_ATTR_TRAP_POLICER_ID]);
+
+	h = trap_watch_hash(kind, bus_name, dev_name, name, policer_id);
+	hlist_for_each_entry(entry, &watch->hash[h], hash) {
+		if (entry->kind != kind ||
+		    strcmp(entry->bus_name, bus_name) ||
+		    strcmp(entry->dev_name, dev_name))
+			continue;
+		if (kind == TRAP_WATCH_TRAP ? !strcmp(entry->name, name) :
+					      entry->policer_id == policer_id)
+			return entry;
+	}
+
+	entry = calloc(1, sizeof(*entry));
+	if (!entry)
+		return NULL;
+	entry->kind = kind;
+	entry->policer_id = policer_id;
+	/* never seen, so the first dump gives no rate at any iteration */
+	entry->seen = UINT_MAX;
+	entry->bus_name = strdup(bus_name);
+	entry->dev_name = strdup(dev_name);
+	if (name)
+		entry->name = strdup(name);
+	if (!entry->bus_name || !entry->dev_name || (name && !entry->name)) {
+		free(entry->name);
+		free(entry->dev_name);
+		free(entry->bus_name);
+		free(entry);
+		return NULL;
+	}
+	hlist_add_head(&entry->hash, &watch->hash[h]);
+	list_add_tail(&entry->list, &watch->list);
+	watch->entry_count++;
+	return entry;
+}
+
+static void trap_watch_fini(struct trap_watch *watch)
+{
+	struct trap_watch_entry *entry, *tmp;
+
+	list_for_each_entry_safe(entry, tmp, &watch->list, list) {
+		list_del(&entry->list);
+		hlist_del(&entry->hash);
+		free(entry->name);
+		free(entry->dev_name);
+		free(entry->bus_name);
+		free(entry);
+	}
+}
+
+static uint64_t trap_watch_rate(uint64_t cur, uint64_t prev,
+				uint64_t interval_ms)
+{
+	if (cur < prev || !interval_ms)
+		return 0;
+	return (cur - prev) * 1000 / interval_ms;
+}
+
+static void trap_watch_entry_update(struct trap_watch *watch,
+				    enum trap_watch_kind kind,
+				    struct nlattr **tb)
+{
+	struct nlattr *tb_stats[DEVLINK_ATTR_STATS_MAX + 1] = {};
+	uint64_t packets = 0, bytes = 0, dropped = 0;
+	struct trap_watch_entry *entry;
+	bool first;
+
+	if (watch->err || !dl_dump_filter(watch->dl, tb))
+		return;
+	if (mnl_attr_parse_nested(tb[DEVLINK_ATTR_STATS], attr_stats_cb,
+				  tb_stats) != MNL_CB_OK)
+		return;
+
+	entry = trap_watch_entry_get(watch, kind, tb);
+	if (!entry) {
+		watch->err = -ENOMEM;
+		return;
+	}
+
+	if (tb_stats[DEVLINK_ATTR_STATS_RX_PACKETS])
+		packets = mnl_attr_get_u64(tb_stats[DEVLINK_ATTR_STATS_RX_PACKETS]);
+	if (tb_stats[DEVLINK_ATTR_STATS_RX_BYTES])
+		bytes = mnl_attr_get_u64(tb_stats[DEVLINK_ATTR_STATS_RX_BYTES]);
+	if (tb_stats[DEVLINK_ATTR_STATS_RX_DROPPED])
+		dropped = mnl_attr_get_u64(tb_stats[DEVLINK_ATTR_STATS_RX_DROPPED]);
+
+	/* Counters of an object missing from the previous dump cover an
+	 * unknown amount of time, so they give no rate yet.
+	 */
+	first = !watch->iteration || entry->seen != watch->iteration - 1;
+	if (first) {
+		entry->packet_rate = 0;
+		entry->byte_rate = 0;
+		entry->drop_rate = 0;
+	} else {
+		entry->packet_rate = trap_watch_rate(packets, entry->packets,
+						     watch->interval_ms);
+		entry->byte_rate = trap_watch_rate(bytes, entry->bytes,
+						   watch->interval_ms);
+		entry->drop_rate = trap_watch_rate(dropped, entry->dropped,
+						   watch->interval_ms);
+	}
+	entry->packets = packets;
+	entry->bytes = bytes;
+	entry->dropped = dropped;
+	entry->seen = watch->iteration;
+}
+
+static int cmd_trap_watch_trap_cb(const struct nlmsghdr *nlh, void *data)
+{
+	struct genlmsghdr *genl = mnl_nlmsg_get_payload(nlh);
+	struct nlattr *tb[DEVLINK_ATTR_MAX + 1] = {};
+	struct trap_watch *watch = data;
+
+	if (!dl_dump_filter_nlh(watch->dl, nlh))
+		return MNL_CB_OK;
+
+	mnl_attr_parse(nlh, sizeof(*genl), attr_cb, tb);
+	if (!tb[DEVLINK_ATTR_BUS_NAME] || !tb[DEVLINK_ATTR_DEV_NAME] ||
+	    !tb[DEVLINK_ATTR_TRAP_NAME] || !tb[DEVLINK_ATTR_STATS])
+		return MNL_CB_ERROR;
+
+	trap_watch_entry_update(watch, TRAP_WATCH_TRAP, tb);
+	return MNL_CB_OK;
+}
+
+static int cmd_trap_watch_policer_cb(const struct nlmsghdr *nlh, void *data)
+{
+	struct genlmsghdr *genl = mnl_nlmsg_get_payload(nlh);
+	struct nlattr *tb[DEVLINK_ATTR_MAX + 1] = {};
+	struct trap_watch *watch = data;
+
+	if (!dl_dump_filter_nlh(watch->dl, nlh))
+		return MNL_CB_OK;
+
+	mnl_attr_parse(nlh, sizeof(*genl), attr_cb, tb);
+	if (!tb[DEVLINK_ATTR_BUS_NAME] || !tb[DEVLINK_ATTR_DEV_NAME] ||
+	    !tb[DEVLINK_ATTR_TRAP_POLICER_ID])
+		return MNL_CB_ERROR;
+
+	/* Policers without counters have nothing to rank. */
+	if (tb[DEVLINK_ATTR_STATS])
+		trap_watch_entry_update(watch, TRAP_WATCH_POLICER, tb);
+	return MNL_CB_OK;
+}
+
+static int trap_watch_sample(struct trap_watch *watch)
+{
+	uint16_t flags = NLM_F_REQUEST | NLM_F_ACK | NLM_F_DUMP;
+	struct dl *dl = watch->dl;
+	struct nlmsghdr *nlh;
+	int err;
+
+	nlh = mnlu_gen_socket_cmd_prepare(&dl->nlg, DEVLINK_CMD_TRAP_GET, flags);
+	dl_dump_selector_put(nlh, dl);
+	err = dl_sndrcv(dl, nlh, cmd_trap_watch_trap_cb, watch);
+	if (err)
+		return err;
+
+	if (!watch->no_policers) {
+		nlh = mnlu_gen_socket_cmd_prepare(&dl->nlg,
+						  DEVLINK_CMD_TRAP_POLICER_GET,
+						  flags);
+		dl_dump_selector_put(nlh, dl);
+		err = dl_sndrcv(dl, nlh, cmd_trap_watch_policer_cb, watch);
+		/* Kernels without policer support still report traps. */
+		if (err == -EOPNOTSUPP)
+			watch->no_policers = true;
+		else if (err)
+			return err;
+	}
+	return watch->err;
+}
+
+static int trap_watch_u64_cmp_desc(uint64_t x, uint64_t y)
+{
+	return x < y ? 1 : x > y ? -1 : 0;
+}
+
+static int trap_watch_packet_rate_cmp(const void *a, const void *b)
+{
+	const struct trap_watch_entry *x = *(const struct trap_watch_entry **)a;
+	const struct trap_watch_entry *y = *(const struct trap_watch_entry **)b;
+
+	if (x->packet_rate != y->packet_rate)
+		return trap_watch_u64_cmp_desc(x->packet_rate, y->packet_rate);
+	return trap_watch_u64_cmp_desc(x->drop_rate, y->drop_rate);
+}
+
+static int trap_watch_drop_rate_cmp(const void *a, const void *b)
+{
+	const struct trap_watch_entry *x = *(const struct trap_watch_entry **)a;
+	const struct trap_watch_entry *y = *(const struct trap_watch_entry **)b;
+
+	if (x->drop_rate != y->drop_rate)
+		return trap_watch_u64_cmp_desc(x->drop_rate, y->drop_rate);
+	return trap_watch_u64_cmp_desc(x->packet_rate, y->packet_rate);
+}
+
+static void pr_out_trap_watch_entry(struct dl *dl,
+				    struct trap_watch_entry *entry)
+{
+	char buf[64];
+
+	snprintf(buf, sizeof(buf), "%s/%s", entry->bus_name, entry->dev_name);
+	open_json_object(NULL);
+	print_string(PRINT_ANY, "dev", "  %s", buf);
+	if (entry->kind == TRAP_WATCH_TRAP)
+		print_string(PRINT_ANY, "name", " name %s", entry->name);
+	else
+		print_uint(PRINT_ANY, "policer", " policer %u",
+			   entry->policer_id);
+	print_u64(PRINT_ANY, "packet_rate", " pps %" PRIu64,
+		  entry->packet_rate);
+	print_u64(PRINT_ANY, "byte_rate", " bps %" PRIu64, entry->byte_rate);
+	print_u64(PRINT_ANY, "drop_rate", " drops/s %" PRIu64,
+		  entry->drop_rate);
+	print_u64(PRINT_ANY, "packets", " packets %" PRIu64, entry->packets);
+	print_u64(PRINT_ANY, "dropped", " dropped %" PRIu64, entry->dropped);
+	close_json_object();
+	if (!dl->json_output)
+		pr_out("\n");
+}
+
+static void pr_out_trap_watch_top(struct trap_watch *watch,
+				  struct trap_watch_entry **entries,
+				  enum trap_watch_kind kind, const char *name,
+				  int (*cmp)(const void *, const void *))
+{
+	uint32_t top = TRAP_WATCH_TOP_DEFAULT;
+	struct dl *dl = watch->dl;
+	struct trap_watch_entry *entry;
+	unsigned int count = 0, i;
+
+	if (dl->opts.present & DL_OPT_TOP)
+		top = dl->opts.top;
+
+	list_for_each_entry(entry, &watch->list, list) {
+		if (entry->kind != kind || entry->seen != watch->iteration)
+			continue;
+		if (!entry->packet_rate && !entry->drop_rate)
+			continue;
+		entries[count++] = entry;
+	}
+	qsort(entries, count, sizeof(*entries), cmp);
+
+	open_json_array(PRINT_JSON, name);
+	if (!dl->json_output)
+		pr_out("%s:\n", name);
+	for (i = 0; i < count && (!top || i < top); i++)
+		pr_out_trap_watch_entry(dl, entries[i]);
+	close_json_array(PRINT_JSON, NULL);
+}
+
+static int pr_out_trap_watch(struct trap_watch *watch, uint64_t elapsed_ms)
+{
+	struct trap_watch_entry **entries;
+	struct dl *dl = watch->dl;
+
+	entries = calloc(watch->entry_count, sizeof(*entries));
+	if (watch->entry_count && !entries)
+		return -ENOMEM;
+
+	pr_out_section_start(dl, "trap_watch");
+	if (dl->json_output) {
+		print_uint(PRINT_JSON, "iteration", NULL, watch->iteration);
+		print_u64(PRINT_JSON, "time_ms", NULL, elapsed_ms);
+	} else {
+		pr_out("iteration %u time %" PRIu64 "ms:\n",
+		       watch->iteration, elapsed_ms);
+	}
+	pr_out_trap_watch_top(watch, entries, TRAP_WATCH_TRAP, "trap",
+			      trap_watch_packet_rate_cmp);
+	if (!watch->no_policers)
+		pr_out_trap_watch_top(watch, entries, TRAP_WATCH_POLICER,
+				      "policer", trap_watch_drop_rate_cmp);
+	pr_out_section_end(dl);
+	fflush(stdout);
+
+	free(entries);
+	return 0;
+}
+
+static int cmd_trap_watch(struct dl *dl)
+{
+	struct dl_opts *opts = &dl->opts;
+	struct trap_watch watch = {
+		.dl = dl,
+	};
+	struct dl_watch dl_watch;
+	uint64_t last_ms = 0, now_ms;
+	int err;
+
+	err = dl_argv_parse(dl, 0, DL_OPT_HANDLE | DL_OPT_INTERVAL |
+			    DL_OPT_COUNT | DL_OPT_TOP);
+	if (err)
+		return err;
+
+	INIT_LIST_HEAD(&watch.list);
+
+	dl_watch_start(&dl_watch, opts->present & DL_OPT_INTERVAL ?
+		       opts->interval : DL_WATCH_INTERVAL_DEFAULT);
+	while (dl_watch_running()) {
+		now_ms = dl_watch_elapsed_ms(&dl_watch);
+		watch.interval_ms = now_ms - last_ms;
+		last_ms = now_ms;
+
+		err = dl_watch_sample_err(trap_watch_sample(&watch));
+		if (err)
+			break;
+		/* The first dump only provides the base for the rates. */
+		if (watch.iteration) {
+			err = pr_out_trap_watch(&watch, now_ms);
+			if (err)
+				break;
+		}
+
+		if (opts->present & DL_OPT_COUNT && opts->count &&
+		    watch.iteration == opts->count)
+			break;
+		watch.iteration++;
+		dl_watch_sleep(&dl_watch);
+	}
+	dl_watch_end(&dl_watch);
+
+	trap_watch_fini(&watch);
+	return err;
+}
+
 static int cmd_trap(struct dl *dl)
 {
 	if (dl_argv_match(dl, "help")) {
@@ -8486,6 +10305,9 @@ static int cmd_trap(struct dl *dl)
 	} else if (dl_argv_match(dl, "policer")) {
 		dl_arg_inc(dl);
 		return cmd_trap_policer(dl);
+	} else if (dl_argv_match(dl, "watch")) {
+		dl_arg_inc(dl);
+		return cmd_trap_watch(dl);
 	}
 	pr_err("Command \"%s\" not found\n", dl_argv(dl));
 	return -ENOENT;
@@ -8496,13 +10318,15 @@ static void help(void)
 	pr_err("Usage: devlink [ OPTIONS ] OBJECT { COMMAND | help }\n"
 	       "       devlink [ -f[orce] ] -b[atch] filename -N[etns] netnsname\n"
 	       "where  OBJECT := { dev | port | sb | monitor | dpipe | resource | region | health | trap }\n"
-	       "       OPTIONS := { -V[ersion] | -n[o-nice-names] | -j[son] | -p[retty] | -v[erbose] -s[tatistics] }\n");
+	       "       OPTIONS := { -V[ersion] | -n[o-nice-names] | -j[son] | --cbor | -p[retty] | -v[erbose] -s[tatistics] }\n");
 }
 
 static int dl_cmd(struct dl *dl, int argc, char **argv)
 {
 	dl->argc = argc;
 	dl->argv = argv;
+	/* Do not let options of a previous batch line filter this one. */
+	dl->opts.present = 0;
 
 	if (dl_argv_match(dl, "help") || dl_no_arg(dl)) {
 		help();
@@ -8550,17 +10374,9 @@ static int dl_init(struct dl *dl)
 		return -errno;
 	}
 
-	err = ifname_map_init(dl);
-	if (err) {
-		pr_err("Failed to create index map\n");
-		goto err_ifname_map_create;
-	}
+	ifname_map_init(dl);
 	new_json_obj_plain(dl->json_output);
 	return 0;
-
-err_ifname_map_create:
-	mnlu_gen_socket_close(&dl->nlg);
-	return err;
 }
 
 static void dl_fini(struct dl *dl)
@@ -8594,7 +10410,28 @@ static int dl_batch_cmd(int argc, char *argv[], void *data)
 
 static int dl_batch(struct dl *dl, const char *name, bool force)
 {
-	return do_batch(name, force, dl_batch_cmd, dl);
+	int ret;
+
+	/* Without force the batch stops at the first failing line, which
+	 * pipelined requests cannot honour.
+	 */
+	if (!force)
+		return do_batch(name, force, dl_batch_cmd, dl);
+
+	dl->batch.recv_buf = malloc(MNL_SOCKET_BUFFER_SIZE);
+	if (!dl->batch.recv_buf)
+		return do_batch(name, force, dl_batch_cmd, dl);
+	dl->batch.name = name;
+	dl->batch.seq = time(NULL);
+
+	ret = do_batch(name, force, dl_batch_cmd, dl);
+	dl_batch_flush(dl);
+	if (dl->batch.failed)
+		ret = EXIT_FAILURE;
+
+	free(dl->batch.recv_buf);
+	dl->batch.recv_buf = NULL;
+	return ret;
 }
 
 int main(int argc, char **argv)
@@ -8606,6 +10443,7 @@ int main(int argc, char **argv)
 		{ "no-nice-names",	no_argument,		NULL, 'n' },
 		{ "json",		no_argument,		NULL, 'j' },
 		{ "pretty",		no_argument,		NULL, 'p' },
+		{ "cbor",		no_argument,		NULL, 'C' },
 		{ "verbose",		no_argument,		NULL, 'v' },
 		{ "statistics",		no_argument,		NULL, 's' },
 		{ "Netns",		required_argument,	NULL, 'N' },
@@ -8647,6 +10485,10 @@ int main(int argc, char **argv)
 		case 'p':
 			pretty = true;
 			break;
+		case 'C':
+			dl->json_output = true;
+			cbor = 1;
+			break;
 		case 'v':
 			dl->verbose = true;
 			break;
@@ -283,6 +283,12 @@ int bpf_program_load(enum bpf_prog_type type, const struct bpf_insn *insns,
 
 int bpf_prog_attach_fd(int prog_fd, int target_fd, enum bpf_attach_type type);
 int bpf_prog_detach_fd(int target_fd, enum bpf_attach_type type);
+int bpf_prog_query_fd(int target_fd, enum bpf_attach_type type,
+		      __u32 *prog_ids, __u32 *prog_cnt);
+int iproute2_bpf_obj_get(const char *pathname, enum bpf_prog_type type);
+int iproute2_bpf_obj_pin(int fd, const char *pathname);
+int bpf_prog_info_by_fd(int fd, struct bpf_prog_info *info,
+			uint32_t *info_len);
 int bpf_program_attach(int prog_fd, int target_fd, enum bpf_attach_type type);
 
 int bpf_dump_prog_info(FILE *f, uint32_t id);
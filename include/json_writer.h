@@ -19,11 +19,16 @@ typedef struct json_writer json_writer_t;
 
 /* Create a new JSON stream */
 json_writer_t *jsonw_new(FILE *f);
+/* Create a new CBOR stream */
+json_writer_t *jsonw_new_cbor(FILE *f);
+bool jsonw_is_cbor(const json_writer_t *self);
 /* End output to JSON stream */
 void jsonw_destroy(json_writer_t **self_p);
 
 /* Cause output to have pretty whitespace */
 void jsonw_pretty(json_writer_t *self, bool on);
+/* Put the next top level element on a new line instead of after a comma */
+void jsonw_new_line(json_writer_t *self);
 
 /* Add property name */
 void jsonw_name(json_writer_t *self, const char *name);
@@ -45,6 +50,8 @@ void jsonw_s64(json_writer_t *self, int64_t number);
 void jsonw_null(json_writer_t *self);
 void jsonw_luint(json_writer_t *self, unsigned long num);
 void jsonw_lluint(json_writer_t *self, unsigned long long num);
+void jsonw_tag(json_writer_t *self, uint64_t tag);
+void jsonw_bytes(json_writer_t *self, const void *buf, size_t len);
 
 /* Useful Combinations of name and value */
 void jsonw_string_field(json_writer_t *self, const char *prop, const char *val);
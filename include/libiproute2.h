@@ -0,0 +1,146 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * libiproute2.h	In-process API for common rtnetlink objects
+ *
+ * Every operation works on a context which owns its own netlink socket,
+ * so separate contexts can be used from separate threads. Dumps deliver
+ * each object to a callback; returning a negative value from it stops
+ * the dump and is passed back to the caller. Functions return 0 or a
+ * negative errno, the kernel's message for the last failure is kept in
+ * the context.
+ */
+#ifndef __LIBIPROUTE2_H__
+#define __LIBIPROUTE2_H__ 1
+
+#include <stdbool.h>
+#include <stdint.h>
+
+struct ipr2_ctx;
+
+struct ipr2_ctx *ipr2_open(void);
+void ipr2_close(struct ipr2_ctx *ctx);
+const char *ipr2_errmsg(const struct ipr2_ctx *ctx);
+
+enum ipr2_op {
+	IPR2_ADD,
+	IPR2_REPLACE,
+	IPR2_DEL,
+};
+
+/* Network address, len is in bytes and 0 for an unset address */
+struct ipr2_addr {
+	int		family;
+	int		len;
+	uint8_t		data[16];
+};
+
+int ipr2_parse_addr(const char *str, int family, struct ipr2_addr *addr,
+		    int *prefixlen);
+const char *ipr2_addr_ntop(const struct ipr2_addr *addr, char *buf,
+			   int buflen);
+
+/* Links */
+struct ipr2_link {
+	int		ifindex;
+	const char	*name;
+	const char	*kind;
+	unsigned int	flags;
+	unsigned int	mtu;
+	unsigned short	type;
+	uint8_t		operstate;
+	int		master;
+	int		link;
+	const uint8_t	*lladdr;
+	int		lladdr_len;
+};
+
+typedef int (*ipr2_link_cb)(const struct ipr2_link *link, void *data);
+
+int ipr2_link_dump(struct ipr2_ctx *ctx, ipr2_link_cb cb, void *data);
+int ipr2_link_get(struct ipr2_ctx *ctx, const char *name, ipr2_link_cb cb,
+		  void *data);
+int ipr2_link_index(struct ipr2_ctx *ctx, const char *name);
+int ipr2_link_set_up(struct ipr2_ctx *ctx, int ifindex, bool up);
+int ipr2_link_set_mtu(struct ipr2_ctx *ctx, int ifindex, unsigned int mtu);
+
+/* Addresses */
+struct ipr2_address {
+	int		ifindex;
+	int		family;
+	int		prefixlen;
+	int		scope;
+	unsigned int	flags;
+	struct ipr2_addr local;
+	struct ipr2_addr address;
+	struct ipr2_addr broadcast;
+	const char	*label;
+	uint32_t	valid_lft;
+	uint32_t	preferred_lft;
+};
+
+typedef int (*ipr2_address_cb)(const struct ipr2_address *addr, void *data);
+
+int ipr2_address_dump(struct ipr2_ctx *ctx, int family, ipr2_address_cb cb,
+		      void *data);
+int ipr2_address_modify(struct ipr2_ctx *ctx, enum ipr2_op op,
+			const struct ipr2_address *addr);
+
+/* Routes, table 0 is main on modification */
+struct ipr2_route {
+	int		family;
+	uint32_t	table;
+	int		protocol;
+	int		scope;
+	int		type;
+	unsigned int	flags;
+	struct ipr2_addr dst;
+	int		dst_len;
+	struct ipr2_addr src;
+	int		src_len;
+	struct ipr2_addr gateway;
+	struct ipr2_addr prefsrc;
+	int		oif;
+	int		iif;
+	uint32_t	priority;
+};
+
+typedef int (*ipr2_route_cb)(const struct ipr2_route *route, void *data);
+
+int ipr2_route_dump(struct ipr2_ctx *ctx, int family, ipr2_route_cb cb,
+		    void *data);
+int ipr2_route_modify(struct ipr2_ctx *ctx, enum ipr2_op op,
+		      const struct ipr2_route *route);
+
+/* Neighbours */
+struct ipr2_neigh {
+	int		ifindex;
+	int		family;
+	uint16_t	state;
+	uint8_t		flags;
+	struct ipr2_addr dst;
+	const uint8_t	*lladdr;
+	int		lladdr_len;
+};
+
+typedef int (*ipr2_neigh_cb)(const struct ipr2_neigh *neigh, void *data);
+
+int ipr2_neigh_dump(struct ipr2_ctx *ctx, int family, ipr2_neigh_cb cb,
+		    void *data);
+int ipr2_neigh_modify(struct ipr2_ctx *ctx, enum ipr2_op op,
+		      const struct ipr2_neigh *neigh);
+
+/* Queueing disciplines, parent TC_H_ROOT or TC_H_INGRESS at the top */
+struct ipr2_qdisc {
+	int		ifindex;
+	uint32_t	handle;
+	uint32_t	parent;
+	const char	*kind;
+};
+
+typedef int (*ipr2_qdisc_cb)(const struct ipr2_qdisc *qdisc, void *data);
+
+int ipr2_qdisc_dump(struct ipr2_ctx *ctx, int ifindex, ipr2_qdisc_cb cb,
+		    void *data);
+int ipr2_qdisc_del(struct ipr2_ctx *ctx, const struct ipr2_qdisc *qdisc);
+
+#endif /* __LIBIPROUTE2_H__ */
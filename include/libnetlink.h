@@ -24,7 +24,11 @@ struct rtnl_handle {
 #define RTNL_HANDLE_F_LISTEN_ALL_NSID		0x01
 #define RTNL_HANDLE_F_SUPPRESS_NLERR		0x02
 #define RTNL_HANDLE_F_STRICT_CHK		0x04
+/* rtnl_listen() returns -EINTR and -ENOBUFS instead of carrying on */
+#define RTNL_HANDLE_F_LISTEN_INTR		0x08
 	int			flags;
+	struct rtnl_stats      *stats;
+	struct rtnl_listen_counters *counters;
 };
 
 struct nlmsg_list {
@@ -38,6 +42,7 @@ struct nlmsg_chain {
 };
 
 extern int rcvbuf;
+extern int rcvbuf_force;
 
 int rtnl_open(struct rtnl_handle *rth, unsigned int subscriptions)
 	__attribute__((warn_unused_result));
@@ -132,6 +137,9 @@ int rtnl_talk(struct rtnl_handle *rtnl, struct nlmsghdr *n,
 int rtnl_talk_iov(struct rtnl_handle *rtnl, struct iovec *iovec, size_t iovlen,
 		  struct nlmsghdr **answer)
 	__attribute__((warn_unused_result));
+int rtnl_talk_iov_ignore(struct rtnl_handle *rtnl, struct iovec *iovec,
+			 size_t iovlen, int ignore_errno)
+	__attribute__((warn_unused_result));
 int rtnl_talk_suppress_rtnl_errmsg(struct rtnl_handle *rtnl, struct nlmsghdr *n,
 				   struct nlmsghdr **answer)
 	__attribute__((warn_unused_result));
@@ -234,6 +242,8 @@ static inline const char *rta_getattr_str(const struct rtattr *rta)
 int rtnl_listen_all_nsid(struct rtnl_handle *);
 int rtnl_listen(struct rtnl_handle *, rtnl_listen_filter_t handler,
 		void *jarg);
+int rtnl_listen_counted(struct rtnl_handle *, rtnl_listen_filter_t handler,
+			void *jarg);
 int rtnl_from_file(FILE *, rtnl_listen_filter_t handler,
 		   void *jarg);
 
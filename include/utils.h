@@ -28,6 +28,7 @@ extern int oneline;
 extern int brief;
 extern int json;
 extern int pretty;
+extern int cbor;
 extern int timestamp;
 extern int timestamp_short;
 extern const char * _SL_;
@@ -181,6 +182,12 @@ const char *format_host_r(int af, int len, const void *addr,
 		      buf, buflen)
 
 const char *format_host(int af, int lne, const void *addr);
+void resolve_prefetch(int af, int len, const void *addr);
+void resolve_prefetch_wait(void);
+/* queue of resolve_prefetch(), worked off by lib/resolve_pool.c */
+bool resolve_queue_run(unsigned int i);
+unsigned int resolve_queue_pending(void);
+void resolve_queue_done(void);
 #define format_host_rta(af, rta) \
 	format_host(af, RTA_PAYLOAD(rta), RTA_DATA(rta))
 const char *rt_addr_n2a_r(int af, int len, const void *addr,
@@ -202,6 +209,27 @@ int check_altifname(const char *name);
 int get_ifname(char *, const char *);
 const char *get_ifname_rta(int ifindex, const struct rtattr *rta);
 bool matches(const char *prefix, const char *string);
+
+/*
+ * Prefix lookup in a table terminated by a NULL keyword, whose entries
+ * start with the keyword, e.g. struct cmd { const char *cmd; ... }.
+ */
+struct keyword_slot {
+	const char	*word;
+	unsigned short	len;
+	unsigned short	idx;
+};
+
+struct keyword_index {
+	const void		*table;
+	size_t			stride;
+	unsigned int		mask;
+	struct keyword_slot	*slots;
+};
+
+#define KEYWORD_INDEX(tbl) { .table = (tbl), .stride = sizeof((tbl)[0]) }
+
+int keyword_lookup(struct keyword_index *ki, const char *word);
 int inet_addr_match(const inet_prefix *a, const inet_prefix *b, int bits);
 int inet_addr_match_rta(const inet_prefix *m, const struct rtattr *rta);
 
@@ -297,6 +325,19 @@ extern int cmdlineno;
 ssize_t getcmdline(char **line, size_t *len, FILE *in);
 int makeargs(char *line, char *argv[], int maxargs);
 
+struct cmdline_reader {
+	int	fd;
+	char	*buf;
+	size_t	size;
+	size_t	start;
+	size_t	end;
+	bool	eof;
+};
+
+void cmdline_reader_init(struct cmdline_reader *r, int fd);
+void cmdline_reader_free(struct cmdline_reader *r);
+char *cmdline_read(struct cmdline_reader *r);
+
 char *int_to_str(int val, char *buf);
 int get_guid(__u64 *guid, const char *arg);
 int get_real_family(int rtm_type, int rtm_family);
@@ -327,6 +368,8 @@ char *sprint_time64(__s64 time, char *buf);
 
 int do_batch(const char *name, bool force,
 	     int (*cmd)(int argc, char *argv[], void *user), void *user);
+int do_server(const char *path, int (*init)(void *data),
+	      int (*cmd)(int argc, char *argv[], void *data), void *data);
 
 int parse_one_of(const char *msg, const char *realval, const char * const *list,
 		 size_t len, int *p_err);
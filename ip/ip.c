@@ -64,6 +64,7 @@ static void usage(void)
 	fprintf(stderr,
 		"Usage: ip [ OPTIONS ] OBJECT { COMMAND | help }\n"
 		"       ip [ -force ] -batch filename\n"
+		"       ip -server socket\n"
 		"where  OBJECT := { address | addrlabel | fou | help | ila | l2tp | link |\n"
 		"                   macsec | maddress | monitor | mptcp | mroute | mrule |\n"
 		"                   neighbor | neighbour | netconf | netns | nexthop | ntable |\n"
@@ -76,7 +77,7 @@ static void usage(void)
 		"                    -l[oops] { maximum-addr-flush-attempts } | -br[ief] |\n"
 		"                    -o[neline] | -t[imestamp] | -ts[hort] | -b[atch] [filename] |\n"
 		"                    -rc[vbuf] [size] | -n[etns] name | -N[umeric] | -a[ll] |\n"
-		"                    -c[olor]}\n");
+		"                    -c[olor] | -cb[or] }\n");
 	exit(-1);
 }
 
@@ -125,14 +126,14 @@ static const struct cmd {
 	{ 0 }
 };
 
+static struct keyword_index cmds_index = KEYWORD_INDEX(cmds);
+
 static int do_cmd(const char *argv0, int argc, char **argv, bool final)
 {
-	const struct cmd *c;
+	int i = keyword_lookup(&cmds_index, argv0);
 
-	for (c = cmds; c->cmd; ++c) {
-		if (matches(argv0, c->cmd) == 0)
-			return -(c->func(argc-1, argv+1));
-	}
+	if (i >= 0)
+		return -(cmds[i].func(argc-1, argv+1));
 
 	if (final)
 		fprintf(stderr, "Object \"%s\" is unknown, try \"ip help\".\n", argv0);
@@ -164,10 +165,30 @@ static int batch(const char *name)
 	return ret;
 }
 
+static int server_init(void *data)
+{
+	if (rtnl_open(&rth, 0) < 0) {
+		fprintf(stderr, "Cannot open rtnetlink\n");
+		return -1;
+	}
+
+	rtnl_set_strict_dump(&rth);
+	return 0;
+}
+
+static int server(const char *path)
+{
+	int orig_family = preferred_family;
+
+	batch_mode = 1;
+	return do_server(path, server_init, ip_batch_cmd, &orig_family);
+}
+
 int main(int argc, char **argv)
 {
 	const char *libbpf_version;
 	char *batch_file = NULL;
+	char *server_path = NULL;
 	char *basename;
 	int color = 0;
 
@@ -263,6 +284,12 @@ int main(int argc, char **argv)
 			if (argc <= 1)
 				usage();
 			batch_file = argv[1];
+		} else if (matches(opt, "-server") == 0) {
+			argc--;
+			argv++;
+			if (argc <= 1)
+				usage();
+			server_path = argv[1];
 		} else if (matches(opt, "-brief") == 0) {
 			++brief;
 		} else if (matches(opt, "-json") == 0) {
@@ -282,7 +309,11 @@ int main(int argc, char **argv)
 				exit(-1);
 			}
 			rcvbuf = size;
+			rcvbuf_force = 1;
 		} else if (matches_color(opt, &color)) {
+		} else if (matches(opt, "-cbor") == 0) {
+			++json;
+			cbor = 1;
 		} else if (matches(opt, "-help") == 0) {
 			usage();
 		} else if (matches(opt, "-netns") == 0) {
@@ -309,6 +340,9 @@ int main(int argc, char **argv)
 	if (batch_file)
 		return batch(batch_file);
 
+	if (server_path)
+		return server(server_path);
+
 	if (rtnl_open(&rth, 0) < 0)
 		exit(1);
 
@@ -94,8 +94,26 @@ int do_mptcp(int argc, char **argv);
 int iplink_get(char *name, __u32 filt_mask);
 int iplink_ifla_xstats(int argc, char **argv);
 
+/* Object classes kept by "ip monitor mirror", in snapshot order */
+enum {
+	MIRROR_LINK,
+	MIRROR_ADDR,
+	MIRROR_NEXTHOP,
+	MIRROR_ROUTE,
+	MIRROR_NEIGH,
+	__MIRROR_MAX
+};
+
+int ipmonitor_mirror(struct rtnl_handle *rth, rtnl_listen_filter_t print,
+		     const char *file, unsigned int classes,
+		     unsigned int interval);
+
 int ip_link_list(req_filter_fn_t filter_fn, struct nlmsg_chain *linfo);
 void free_nlmsg_chain(struct nlmsg_chain *info);
+int store_nlmsg(struct nlmsghdr *n, void *arg);
+
+#define RTM_NHA(h)  ((struct rtattr *)(((char *)(h)) + \
+			NLMSG_ALIGN(sizeof(struct nhmsg))))
 
 static inline int rtm_get_table(struct rtmsg *r, struct rtattr **tb)
 {
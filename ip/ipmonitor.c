@@ -19,22 +19,35 @@
 #include <arpa/inet.h>
 #include <string.h>
 #include <time.h>
+#include <limits.h>
+#include <sys/stat.h>
 
 #include "utils.h"
 #include "ip_common.h"
+#include "rtmon.h"
 
 static void usage(void) __attribute__((noreturn));
 static int prefix_banner;
 int listen_all_nsid;
 
+/* Time range replayed from a file, 0 when unbounded */
+static struct {
+	__u32 since;
+	__u32 until;
+	bool in_range;
+	bool done;
+} replay;
+
 static void usage(void)
 {
 	fprintf(stderr,
 		"Usage: ip monitor [ all | OBJECTS ] [ FILE ] [ label ] [ all-nsid ]\n"
-		"                  [ dev DEVICE ]\n"
+		"                  [ dev DEVICE ] [ mirror SNAPSHOT [ interval SECONDS ] ]\n"
+		"                  [ stats ]\n"
 		"OBJECTS :=  address | link | mroute | neigh | netconf |\n"
 		"            nexthop | nsid | prefix | route | rule\n"
-		"FILE := file FILENAME\n");
+		"FILE := file FILENAME [ since TIME ] [ until TIME ]\n"
+		"TIME := { SECONDS | YYYY-MM-DD[ HH:MM[:SS]] }\n");
 	exit(-1);
 }
 
@@ -101,7 +114,9 @@ static int accept_msg(struct rtnl_ctrl_data *ctrl,
 	case RTM_DELLINK:
 		ll_remember_index(n, NULL);
 		print_headers(fp, "[LINK]", ctrl);
+		open_json_object(NULL);
 		print_linkinfo(n, arg);
+		close_json_object();
 		return 0;
 
 	case RTM_NEWADDR:
@@ -172,10 +187,134 @@ static int accept_msg(struct rtnl_ctrl_data *ctrl,
 	return 0;
 }
 
+static int accept_range_msg(struct rtnl_ctrl_data *ctrl,
+			    struct nlmsghdr *n, void *arg)
+{
+	if (n->nlmsg_type == NLMSG_TSTAMP) {
+		__u32 sec = ((__u32 *)NLMSG_DATA(n))[0];
+
+		if (replay.until && sec > replay.until) {
+			replay.done = true;
+			return -1;
+		}
+		replay.in_range = sec >= replay.since;
+	}
+
+	if (replay.in_range)
+		return accept_msg(ctrl, n, arg);
+
+	/* keep interface names current for the part that is shown */
+	if (n->nlmsg_type == RTM_NEWLINK || n->nlmsg_type == RTM_DELLINK)
+		ll_remember_index(n, NULL);
+	return 0;
+}
+
+/* The link dump at the start of a segment ends with the first event */
+static int accept_head_msg(struct rtnl_ctrl_data *ctrl,
+			   struct nlmsghdr *n, void *arg)
+{
+	int *stamps = arg;
+
+	if (n->nlmsg_type == NLMSG_TSTAMP && ++(*stamps) > 1)
+		return -1;
+	if (n->nlmsg_type == RTM_NEWLINK)
+		ll_remember_index(n, NULL);
+	return 0;
+}
+
+/*
+ * Position fp at the last indexed time stamp before replay.since, after
+ * learning the interface names from the head of the segment. Without a
+ * usable index the file is simply replayed from the start.
+ */
+static void monitor_file_seek(FILE *fp, const char *file)
+{
+	struct rtmon_idx_ent *ent = NULL;
+	struct rtmon_idx_hdr hdr;
+	char idxname[PATH_MAX];
+	int lo, hi, found = -1;
+	int stamps = 0;
+	struct stat st;
+	FILE *idx;
+	int n;
+
+	snprintf(idxname, sizeof(idxname), "%s" RTMON_IDX_SUFFIX, file);
+	idx = fopen(idxname, "r");
+	if (!idx)
+		return;
+
+	if (fread(&hdr, sizeof(hdr), 1, idx) != 1 ||
+	    memcmp(hdr.magic, RTMON_IDX_MAGIC, sizeof(hdr.magic)) ||
+	    fstat(fileno(idx), &st) < 0)
+		goto out;
+
+	n = (st.st_size - sizeof(hdr)) / sizeof(*ent);
+	ent = malloc(n * sizeof(*ent));
+	if (!ent || fread(ent, sizeof(*ent), n, idx) != n)
+		goto out;
+
+	/* entries are in log order, so also in time order */
+	for (lo = 0, hi = n - 1; lo <= hi; ) {
+		int mid = (lo + hi) / 2;
+
+		if (ent[mid].sec < replay.since) {
+			found = mid;
+			lo = mid + 1;
+		} else {
+			hi = mid - 1;
+		}
+	}
+	if (found < 0 || ent[found].offset <= hdr.head_len ||
+	    fstat(fileno(fp), &st) < 0 || ent[found].offset >= st.st_size)
+		goto out;
+
+	rtnl_from_file(fp, accept_head_msg, &stamps);
+	if (fseeko(fp, ent[found].offset, SEEK_SET) < 0)
+		rewind(fp);
+out:
+	free(ent);
+	fclose(idx);
+}
+
+/* Seconds since the epoch or a local date and time */
+static int get_replay_time(__u32 *t, const char *arg)
+{
+	static const char * const fmts[] = {
+		"%Y-%m-%d %H:%M:%S", "%Y-%m-%dT%H:%M:%S",
+		"%Y-%m-%d %H:%M", "%Y-%m-%d",
+	};
+	struct tm tm;
+	const char *end;
+	time_t secs;
+	int i;
+
+	if (get_u32(t, arg, 10) == 0)
+		return 0;
+
+	for (i = 0; i < ARRAY_SIZE(fmts); i++) {
+		memset(&tm, 0, sizeof(tm));
+		end = strptime(arg, fmts[i], &tm);
+		if (end && *end == '\0')
+			break;
+	}
+	if (i == ARRAY_SIZE(fmts))
+		return -1;
+
+	tm.tm_isdst = -1;
+	secs = mktime(&tm);
+	if (secs == (time_t)-1)
+		return -1;
+	*t = secs;
+	return 0;
+}
+
 int do_ipmonitor(int argc, char **argv)
 {
 	int lnexthop = 0, nh_set = 1;
 	char *file = NULL;
+	char *mirror_file = NULL;
+	unsigned int interval = 0;
+	int lstats = 0;
 	unsigned int groups = 0;
 	int llink = 0;
 	int laddr = 0;
@@ -211,6 +350,23 @@ int do_ipmonitor(int argc, char **argv)
 		if (matches(*argv, "file") == 0) {
 			NEXT_ARG();
 			file = *argv;
+		} else if (strcmp(*argv, "mirror") == 0) {
+			NEXT_ARG();
+			mirror_file = *argv;
+		} else if (strcmp(*argv, "interval") == 0) {
+			NEXT_ARG();
+			if (get_unsigned(&interval, *argv, 0))
+				invarg("invalid \"interval\"\n", *argv);
+		} else if (strcmp(*argv, "since") == 0) {
+			NEXT_ARG();
+			if (get_replay_time(&replay.since, *argv))
+				invarg("invalid \"since\" time", *argv);
+		} else if (strcmp(*argv, "until") == 0) {
+			NEXT_ARG();
+			if (get_replay_time(&replay.until, *argv))
+				invarg("invalid \"until\" time", *argv);
+		} else if (strcmp(*argv, "stats") == 0) {
+			lstats = 1;
 		} else if (matches(*argv, "label") == 0) {
 			prefix_banner = 1;
 		} else if (matches(*argv, "link") == 0) {
@@ -326,6 +482,19 @@ int do_ipmonitor(int argc, char **argv)
 	if (nh_set)
 		lnexthop = 1;
 
+	if ((replay.since || replay.until) && !file) {
+		fprintf(stderr, "\"since\" and \"until\" require \"file\"\n");
+		exit(-1);
+	}
+	if (mirror_file && (file || listen_all_nsid || lstats)) {
+		fprintf(stderr, "\"mirror\" can't be used with \"file\", \"all-nsid\" or \"stats\"\n");
+		exit(-1);
+	}
+	if (interval && !mirror_file) {
+		fprintf(stderr, "\"interval\" requires \"mirror\"\n");
+		exit(-1);
+	}
+
 	if (file) {
 		FILE *fp;
 		int err;
@@ -335,7 +504,19 @@ int do_ipmonitor(int argc, char **argv)
 			perror("Cannot fopen");
 			exit(-1);
 		}
-		err = rtnl_from_file(fp, accept_msg, stdout);
+		replay.in_range = !replay.since;
+		if (replay.since)
+			monitor_file_seek(fp, file);
+
+		new_json_obj(json);
+		if (replay.since || replay.until) {
+			err = rtnl_from_file(fp, accept_range_msg, stdout);
+			if (replay.done)
+				err = 0;
+		} else {
+			err = rtnl_from_file(fp, accept_msg, stdout);
+		}
+		delete_json_obj();
 		fclose(fp);
 		return err;
 	}
@@ -355,8 +536,32 @@ int do_ipmonitor(int argc, char **argv)
 	netns_nsid_socket_init();
 	netns_map_init();
 
-	if (rtnl_listen(&rth, accept_msg, stdout) < 0)
+	if (mirror_file) {
+		unsigned int classes = 0;
+
+		if (groups & nl_mgrp(RTNLGRP_LINK))
+			classes |= 1 << MIRROR_LINK;
+		if (groups & (nl_mgrp(RTNLGRP_IPV4_IFADDR) |
+			      nl_mgrp(RTNLGRP_IPV6_IFADDR)))
+			classes |= 1 << MIRROR_ADDR;
+		if (lnexthop)
+			classes |= 1 << MIRROR_NEXTHOP;
+		if (groups & (nl_mgrp(RTNLGRP_IPV4_ROUTE) |
+			      nl_mgrp(RTNLGRP_IPV6_ROUTE) |
+			      nl_mgrp(RTNLGRP_MPLS_ROUTE)))
+			classes |= 1 << MIRROR_ROUTE;
+		if (groups & nl_mgrp(RTNLGRP_NEIGH))
+			classes |= 1 << MIRROR_NEIGH;
+
+		if (ipmonitor_mirror(&rth, accept_msg, mirror_file, classes,
+				     interval) < 0)
+			exit(2);
+	} else if (lstats) {
+		if (rtnl_listen_counted(&rth, accept_msg, stdout) < 0)
+			exit(2);
+	} else if (rtnl_listen(&rth, accept_msg, stdout) < 0) {
 		exit(2);
+	}
 
 	return 0;
 }
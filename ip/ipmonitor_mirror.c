@@ -0,0 +1,636 @@
+/*
+ * ipmonitor_mirror.c	"ip monitor mirror", keeps a copy of the kernel
+ *			objects current from the event stream.
+ *
+ *		This program is free software; you can redistribute it and/or
+ *		modify it under the terms of the GNU General Public License
+ *		as published by the Free Software Foundation; either version
+ *		2 of the License, or (at your option) any later version.
+ *
+ * The mirror subscribes to events first and dumps afterwards, so every
+ * change after the dump is in the queue. Events only ever set or remove
+ * an object by its identity, which makes applying the queue on top of
+ * the dump converge to the kernel's state. When the kernel drops events
+ * (ENOBUFS) the queue is discarded and the objects are dumped again.
+ *
+ * IPv4 removes the routes through a link going down without any event,
+ * so while routes are mirrored, link events are received as well and
+ * the IPv4 routes are dumped again when a link goes down. Whether a link
+ * was up is taken from the link cache, which is kept current here.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <signal.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <linux/if.h>
+#include <linux/if_addr.h>
+#include <linux/neighbour.h>
+#include <linux/nexthop.h>
+
+#include "utils.h"
+#include "list.h"
+#include "ip_common.h"
+
+#define MIRROR_KEYLEN	128
+
+struct mirror_obj {
+	struct hlist_node	hash;
+	struct list_head	list;
+	unsigned int		hval;
+	int			class;
+	int			klen;
+	unsigned char		*key;
+	struct nlmsghdr		*n;
+};
+
+struct mirror_key {
+	int			class;
+	int			len;
+	/* leading part of data which is hashed, see mirror_replace() */
+	int			hlen;
+	unsigned char		data[MIRROR_KEYLEN];
+};
+
+static struct {
+	unsigned int		classes;
+	struct hlist_head	*hash;
+	unsigned int		hash_size;
+	unsigned int		count;
+	struct list_head	objs[__MIRROR_MAX];
+	const char		*file;
+	bool			print_links;
+} mirror;
+
+static volatile sig_atomic_t snapshot_pending;
+
+static void key_add(struct mirror_key *k, const void *data, int len)
+{
+	if (k->len + len <= MIRROR_KEYLEN)
+		memcpy(k->data + k->len, data, len);
+	k->len += len;
+}
+
+/* Attribute payload with its length, so that absent and empty differ */
+static void key_add_attr(struct mirror_key *k, const struct rtattr *rta)
+{
+	__u8 len = rta ? RTA_PAYLOAD(rta) : 0;
+
+	key_add(k, &len, sizeof(len));
+	if (rta)
+		key_add(k, RTA_DATA(rta), len);
+}
+
+/*
+ * Identity of the object carried by n, the same one the kernel uses to
+ * tell objects apart. Returns the object class or -1 for messages which
+ * are not mirrored.
+ */
+static int mirror_key(struct nlmsghdr *n, struct mirror_key *k)
+{
+	int len = n->nlmsg_len;
+
+	k->len = 0;
+	k->hlen = -1;
+	switch (n->nlmsg_type) {
+	case RTM_NEWLINK:
+	case RTM_DELLINK: {
+		struct ifinfomsg *ifi = NLMSG_DATA(n);
+
+		if (len < NLMSG_LENGTH(sizeof(*ifi)) ||
+		    ifi->ifi_family != AF_UNSPEC)
+			return -1;
+		k->class = MIRROR_LINK;
+		key_add(k, &ifi->ifi_index, sizeof(ifi->ifi_index));
+		break;
+	}
+	case RTM_NEWADDR:
+	case RTM_DELADDR: {
+		struct ifaddrmsg *ifa = NLMSG_DATA(n);
+		struct rtattr *tb[IFA_MAX+1];
+
+		len -= NLMSG_LENGTH(sizeof(*ifa));
+		if (len < 0)
+			return -1;
+		parse_rtattr(tb, IFA_MAX, IFA_RTA(ifa), len);
+
+		k->class = MIRROR_ADDR;
+		key_add(k, &ifa->ifa_family, sizeof(ifa->ifa_family));
+		key_add(k, &ifa->ifa_index, sizeof(ifa->ifa_index));
+		key_add(k, &ifa->ifa_prefixlen, sizeof(ifa->ifa_prefixlen));
+		key_add_attr(k, tb[IFA_LOCAL] ? : tb[IFA_ADDRESS]);
+		break;
+	}
+	case RTM_NEWROUTE:
+	case RTM_DELROUTE: {
+		struct rtmsg *r = NLMSG_DATA(n);
+		struct rtattr *tb[RTA_MAX+1];
+		__u32 table;
+
+		len -= NLMSG_LENGTH(sizeof(*r));
+		if (len < 0 || r->rtm_flags & RTM_F_CLONED ||
+		    r->rtm_family == RTNL_FAMILY_IPMR ||
+		    r->rtm_family == RTNL_FAMILY_IP6MR)
+			return -1;
+		parse_rtattr(tb, RTA_MAX, RTM_RTA(r), len);
+		table = rtm_get_table(r, tb);
+
+		k->class = MIRROR_ROUTE;
+		key_add(k, &r->rtm_family, sizeof(r->rtm_family));
+		key_add(k, &table, sizeof(table));
+		key_add(k, &r->rtm_dst_len, sizeof(r->rtm_dst_len));
+		key_add(k, &r->rtm_src_len, sizeof(r->rtm_src_len));
+		key_add(k, &r->rtm_tos, sizeof(r->rtm_tos));
+		key_add_attr(k, tb[RTA_DST]);
+		key_add_attr(k, tb[RTA_SRC]);
+		key_add_attr(k, tb[RTA_PRIORITY]);
+		/*
+		 * Routes differing only in their nexthop coexist, but are
+		 * hashed alike so that a replace finds all of them.
+		 */
+		k->hlen = k->len;
+		key_add_attr(k, tb[RTA_OIF]);
+		key_add_attr(k, tb[RTA_GATEWAY]);
+		break;
+	}
+	case RTM_NEWNEIGH:
+	case RTM_DELNEIGH: {
+		struct ndmsg *ndm = NLMSG_DATA(n);
+		struct rtattr *tb[NDA_MAX+1];
+
+		len -= NLMSG_LENGTH(sizeof(*ndm));
+		if (len < 0 || ndm->ndm_family == AF_BRIDGE)
+			return -1;
+		parse_rtattr(tb, NDA_MAX, NDA_RTA(ndm), len);
+
+		k->class = MIRROR_NEIGH;
+		key_add(k, &ndm->ndm_family, sizeof(ndm->ndm_family));
+		key_add(k, &ndm->ndm_ifindex, sizeof(ndm->ndm_ifindex));
+		key_add_attr(k, tb[NDA_DST]);
+		break;
+	}
+	case RTM_NEWNEXTHOP:
+	case RTM_DELNEXTHOP: {
+		struct nhmsg *nhm = NLMSG_DATA(n);
+		struct rtattr *tb[NHA_MAX+1];
+
+		len -= NLMSG_LENGTH(sizeof(*nhm));
+		if (len < 0)
+			return -1;
+		parse_rtattr(tb, NHA_MAX, RTM_NHA(nhm), len);
+
+		k->class = MIRROR_NEXTHOP;
+		key_add_attr(k, tb[NHA_ID]);
+		break;
+	}
+	default:
+		return -1;
+	}
+
+	if (k->len > MIRROR_KEYLEN || !(mirror.classes & (1 << k->class)))
+		return -1;
+	if (k->hlen < 0)
+		k->hlen = k->len;
+	return k->class;
+}
+
+static unsigned int mirror_hash(const struct mirror_key *k)
+{
+	unsigned int h = 2166136261U ^ k->class;
+	int i;
+
+	for (i = 0; i < k->hlen; i++) {
+		h ^= k->data[i];
+		h *= 16777619U;
+	}
+	return h;
+}
+
+static void mirror_rehash(unsigned int size)
+{
+	struct hlist_head *hash = calloc(size, sizeof(*hash));
+	struct mirror_obj *obj;
+	int class;
+
+	if (!hash)
+		return;
+
+	for (class = 0; class < __MIRROR_MAX; class++)
+		list_for_each_entry(obj, &mirror.objs[class], list)
+			hlist_add_head(&obj->hash,
+				       &hash[obj->hval & (size - 1)]);
+
+	free(mirror.hash);
+	mirror.hash = hash;
+	mirror.hash_size = size;
+}
+
+static struct mirror_obj *mirror_lookup(const struct mirror_key *k,
+					unsigned int hval)
+{
+	struct hlist_node *pos;
+
+	hlist_for_each(pos, &mirror.hash[hval & (mirror.hash_size - 1)]) {
+		struct mirror_obj *obj =
+			container_of(pos, struct mirror_obj, hash);
+
+		if (obj->hval == hval && obj->class == k->class &&
+		    obj->klen == k->len &&
+		    memcmp(obj->key, k->data, k->len) == 0)
+			return obj;
+	}
+	return NULL;
+}
+
+static void mirror_del(struct mirror_obj *obj)
+{
+	hlist_del(&obj->hash);
+	list_del(&obj->list);
+	free(obj);
+	mirror.count--;
+}
+
+/* A replaced route takes the place of all routes to the same prefix */
+static void mirror_replace(const struct mirror_key *k, unsigned int hval)
+{
+	struct hlist_node *pos, *tmp;
+
+	hlist_for_each_safe(pos, tmp,
+			    &mirror.hash[hval & (mirror.hash_size - 1)]) {
+		struct mirror_obj *obj =
+			container_of(pos, struct mirror_obj, hash);
+
+		if (obj->hval == hval && obj->class == k->class &&
+		    obj->klen >= k->hlen &&
+		    memcmp(obj->key, k->data, k->hlen) == 0)
+			mirror_del(obj);
+	}
+}
+
+static int mirror_set(const struct mirror_key *k, unsigned int hval,
+		      const struct nlmsghdr *n)
+{
+	struct mirror_obj *obj;
+
+	obj = malloc(sizeof(*obj) + NLMSG_ALIGN(k->len) + n->nlmsg_len);
+	if (!obj) {
+		fprintf(stderr, "mirror: out of memory\n");
+		return -1;
+	}
+	obj->hval = hval;
+	obj->class = k->class;
+	obj->klen = k->len;
+	obj->key = (unsigned char *)(obj + 1);
+	obj->n = (struct nlmsghdr *)(obj->key + NLMSG_ALIGN(k->len));
+	memcpy(obj->key, k->data, k->len);
+	memcpy(obj->n, n, n->nlmsg_len);
+
+	hlist_add_head(&obj->hash, &mirror.hash[hval & (mirror.hash_size - 1)]);
+	list_add_tail(&obj->list, &mirror.objs[k->class]);
+	if (++mirror.count > mirror.hash_size)
+		mirror_rehash(mirror.hash_size * 2);
+	return 0;
+}
+
+/* Interface an address, route, neighbour or nexthop is bound to */
+static int mirror_obj_ifindex(const struct mirror_obj *obj)
+{
+	struct nlmsghdr *n = obj->n;
+	int len = n->nlmsg_len;
+
+	switch (obj->class) {
+	case MIRROR_ADDR:
+		return ((struct ifaddrmsg *)NLMSG_DATA(n))->ifa_index;
+	case MIRROR_NEIGH:
+		return ((struct ndmsg *)NLMSG_DATA(n))->ndm_ifindex;
+	case MIRROR_ROUTE: {
+		struct rtmsg *r = NLMSG_DATA(n);
+		struct rtattr *tb[RTA_MAX+1];
+
+		parse_rtattr(tb, RTA_MAX, RTM_RTA(r),
+			     len - NLMSG_LENGTH(sizeof(*r)));
+		return tb[RTA_OIF] ? rta_getattr_u32(tb[RTA_OIF]) : 0;
+	}
+	case MIRROR_NEXTHOP: {
+		struct nhmsg *nhm = NLMSG_DATA(n);
+		struct rtattr *tb[NHA_MAX+1];
+
+		parse_rtattr(tb, NHA_MAX, RTM_NHA(nhm),
+			     len - NLMSG_LENGTH(sizeof(*nhm)));
+		return tb[NHA_OIF] ? rta_getattr_u32(tb[NHA_OIF]) : 0;
+	}
+	}
+	return 0;
+}
+
+/* The kernel does not report everything it removes with a link */
+static void mirror_purge_link(int ifindex)
+{
+	struct mirror_obj *obj, *tmp;
+	int class;
+
+	for (class = 0; class < __MIRROR_MAX; class++) {
+		if (class == MIRROR_LINK)
+			continue;
+		list_for_each_entry_safe(obj, tmp, &mirror.objs[class], list)
+			if (mirror_obj_ifindex(obj) == ifindex)
+				mirror_del(obj);
+	}
+}
+
+static int mirror_dump_msg(struct nlmsghdr *n, void *arg);
+
+/* Replace the mirrored IPv4 routes by a fresh dump of them */
+static int mirror_resync_inet_routes(void)
+{
+	struct rtnl_handle drth = { .fd = -1 };
+	struct mirror_obj *obj, *tmp;
+	int err;
+
+	list_for_each_entry_safe(obj, tmp, &mirror.objs[MIRROR_ROUTE], list)
+		if (((struct rtmsg *)NLMSG_DATA(obj->n))->rtm_family == AF_INET)
+			mirror_del(obj);
+
+	if (rtnl_open(&drth, 0) < 0)
+		return -1;
+	err = rtnl_routedump_req(&drth, AF_INET, NULL);
+	if (err < 0)
+		perror("Cannot send dump request");
+	else if ((err = rtnl_dump_filter(&drth, mirror_dump_msg, NULL)) < 0)
+		fprintf(stderr, "mirror: dump terminated\n");
+	rtnl_close(&drth);
+	return err < 0 ? -1 : 0;
+}
+
+/* Link messages matter to the routes even if links are not mirrored */
+static int mirror_link_event(struct nlmsghdr *n)
+{
+	struct ifinfomsg *ifi = NLMSG_DATA(n);
+	int flags;
+
+	if (n->nlmsg_len < NLMSG_LENGTH(sizeof(*ifi)) ||
+	    ifi->ifi_family != AF_UNSPEC)
+		return 0;
+
+	if (n->nlmsg_type == RTM_DELLINK) {
+		ll_remember_index(n, NULL);
+		mirror_purge_link(ifi->ifi_index);
+		return 0;
+	}
+
+	/* -1 for a link not seen yet, which is taken as up */
+	flags = ll_index_to_flags(ifi->ifi_index);
+	ll_remember_index(n, NULL);
+
+	if (ifi->ifi_flags & IFF_UP || !(flags & IFF_UP) ||
+	    !(mirror.classes & (1 << MIRROR_ROUTE)) ||
+	    (preferred_family != AF_UNSPEC && preferred_family != AF_INET))
+		return 0;
+	return mirror_resync_inet_routes();
+}
+
+static int mirror_apply(struct nlmsghdr *n, bool event)
+{
+	struct mirror_obj *obj;
+	struct mirror_key k;
+	unsigned int hval;
+
+	if (event &&
+	    (n->nlmsg_type == RTM_NEWLINK || n->nlmsg_type == RTM_DELLINK) &&
+	    mirror_link_event(n) < 0)
+		return -1;
+
+	if (mirror_key(n, &k) < 0)
+		return 0;
+
+	hval = mirror_hash(&k);
+	if (n->nlmsg_type == RTM_NEWROUTE && n->nlmsg_flags & NLM_F_REPLACE) {
+		mirror_replace(&k, hval);
+	} else {
+		obj = mirror_lookup(&k, hval);
+		if (obj)
+			mirror_del(obj);
+	}
+
+	switch (n->nlmsg_type) {
+	case RTM_DELLINK:
+		return 0;
+	case RTM_DELADDR:
+	case RTM_DELROUTE:
+	case RTM_DELNEIGH:
+	case RTM_DELNEXTHOP:
+		return 0;
+	}
+	return mirror_set(&k, hval, n);
+}
+
+static void mirror_clear(void)
+{
+	struct mirror_obj *obj, *tmp;
+	int class;
+
+	for (class = 0; class < __MIRROR_MAX; class++)
+		list_for_each_entry_safe(obj, tmp, &mirror.objs[class], list)
+			mirror_del(obj);
+}
+
+/* Write all objects, links first, so that the file replays in order */
+static int mirror_snapshot(void)
+{
+	char tmpname[PATH_MAX];
+	char buf[NLMSG_SPACE(2 * sizeof(__u32))];
+	struct nlmsghdr *n = (struct nlmsghdr *)buf;
+	struct mirror_obj *obj;
+	struct timeval tv;
+	int class, fd;
+	FILE *fp;
+
+	/* a fresh file next to the snapshot, rename() replaces atomically */
+	snprintf(tmpname, sizeof(tmpname), "%s.XXXXXX", mirror.file);
+	fd = mkostemp(tmpname, O_CLOEXEC);
+	if (fd < 0) {
+		perror("mirror: mkostemp");
+		return -1;
+	}
+	if (fchmod(fd, 0644) < 0 || !(fp = fdopen(fd, "w"))) {
+		perror("mirror: fdopen");
+		close(fd);
+		unlink(tmpname);
+		return -1;
+	}
+
+	memset(buf, 0, sizeof(buf));
+	gettimeofday(&tv, NULL);
+	n->nlmsg_type = NLMSG_TSTAMP;
+	n->nlmsg_len = NLMSG_LENGTH(2 * sizeof(__u32));
+	((__u32 *)NLMSG_DATA(n))[0] = tv.tv_sec;
+	((__u32 *)NLMSG_DATA(n))[1] = tv.tv_usec;
+	fwrite(n, 1, NLMSG_ALIGN(n->nlmsg_len), fp);
+
+	for (class = 0; class < __MIRROR_MAX; class++)
+		list_for_each_entry(obj, &mirror.objs[class], list)
+			fwrite(obj->n, 1, NLMSG_ALIGN(obj->n->nlmsg_len), fp);
+
+	if (ferror(fp) | fclose(fp)) {
+		perror("mirror: write");
+		unlink(tmpname);
+		return -1;
+	}
+	if (rename(tmpname, mirror.file) < 0) {
+		perror("mirror: rename");
+		unlink(tmpname);
+		return -1;
+	}
+	return 0;
+}
+
+static int mirror_dump_msg(struct nlmsghdr *n, void *arg)
+{
+	ll_remember_index(n, NULL);
+	return mirror_apply(n, false);
+}
+
+/*
+ * Forget everything queued, it predates the dump which follows, and
+ * dump all mirrored objects from a separate socket.
+ */
+static int mirror_resync(struct rtnl_handle *rth)
+{
+	struct rtnl_handle drth = { .fd = -1 };
+	unsigned int classes = mirror.classes;
+	int family = preferred_family;
+	int class, err = 0;
+
+	while (recv(rth->fd, NULL, 0, MSG_DONTWAIT | MSG_TRUNC) >= 0 ||
+	       errno == ENOBUFS || errno == EINTR)
+		;
+
+	mirror_clear();
+
+	/* the link cache may have missed events too, see mirror_link_event() */
+	if (classes & (1 << MIRROR_ROUTE))
+		classes |= 1 << MIRROR_LINK;
+
+	if (rtnl_open(&drth, 0) < 0)
+		return -1;
+
+	for (class = 0; class < __MIRROR_MAX && !err; class++) {
+		if (!(classes & (1 << class)))
+			continue;
+
+		switch (class) {
+		case MIRROR_LINK:
+			err = rtnl_linkdump_req(&drth, AF_UNSPEC);
+			break;
+		case MIRROR_ADDR:
+			err = rtnl_addrdump_req(&drth, family, NULL);
+			break;
+		case MIRROR_NEXTHOP:
+			err = rtnl_nexthopdump_req(&drth, family, NULL);
+			break;
+		case MIRROR_ROUTE:
+			err = rtnl_routedump_req(&drth, family, NULL);
+			break;
+		case MIRROR_NEIGH:
+			err = rtnl_neighdump_req(&drth, family, NULL);
+			break;
+		}
+		if (err < 0) {
+			perror("Cannot send dump request");
+			break;
+		}
+		err = rtnl_dump_filter(&drth, mirror_dump_msg, NULL);
+		if (err < 0)
+			fprintf(stderr, "mirror: dump terminated\n");
+	}
+
+	rtnl_close(&drth);
+	return err < 0 ? -1 : 0;
+}
+
+static void mirror_signal(int sig)
+{
+	snapshot_pending = 1;
+}
+
+static rtnl_listen_filter_t mirror_print;
+
+static int mirror_accept(struct rtnl_ctrl_data *ctrl,
+			 struct nlmsghdr *n, void *arg)
+{
+	if (mirror_apply(n, true) < 0)
+		return -1;
+	if (snapshot_pending) {
+		snapshot_pending = 0;
+		mirror_snapshot();
+	}
+	if (!mirror.print_links &&
+	    (n->nlmsg_type == RTM_NEWLINK || n->nlmsg_type == RTM_DELLINK))
+		return 0;
+	return mirror_print(ctrl, n, arg);
+}
+
+int ipmonitor_mirror(struct rtnl_handle *rth, rtnl_listen_filter_t print,
+		     const char *file, unsigned int classes,
+		     unsigned int interval)
+{
+	struct sigaction sa = { .sa_handler = mirror_signal };
+	int class, err;
+
+	mirror.file = file;
+	mirror.classes = classes;
+	mirror_print = print;
+	for (class = 0; class < __MIRROR_MAX; class++)
+		INIT_LIST_HEAD(&mirror.objs[class]);
+	mirror_rehash(1024);
+	if (!mirror.hash)
+		return -1;
+
+	mirror.print_links = classes & (1 << MIRROR_LINK);
+	if (classes & (1 << MIRROR_ROUTE) && !mirror.print_links &&
+	    rtnl_add_nl_group(rth, RTNLGRP_LINK) < 0) {
+		fprintf(stderr, "Failed to add link group to list\n");
+		return -1;
+	}
+
+	/* no SA_RESTART, a signal has to get us out of rtnl_listen() */
+	sigemptyset(&sa.sa_mask);
+	sigaction(SIGUSR1, &sa, NULL);
+	if (interval) {
+		struct itimerval it = {
+			.it_interval = { .tv_sec = interval },
+			.it_value = { .tv_sec = interval },
+		};
+
+		sigaction(SIGALRM, &sa, NULL);
+		setitimer(ITIMER_REAL, &it, NULL);
+	}
+
+	if (mirror_resync(rth) < 0 || mirror_snapshot() < 0)
+		return -1;
+
+	rth->flags |= RTNL_HANDLE_F_LISTEN_INTR;
+	for (;;) {
+		err = rtnl_listen(rth, mirror_accept, stdout);
+		if (err == -ENOBUFS) {
+			fprintf(stderr, "mirror: events lost, resyncing\n");
+			if (mirror_resync(rth) < 0)
+				return -1;
+			snapshot_pending = 1;
+		} else if (err != -EINTR) {
+			return err;
+		}
+
+		if (snapshot_pending) {
+			snapshot_pending = 0;
+			mirror_snapshot();
+		}
+	}
+}
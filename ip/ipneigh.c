@@ -445,6 +445,35 @@ static int ipneigh_dump_filter(struct nlmsghdr *nlh, int reqlen)
 	return 0;
 }
 
+/* "ip -r neigh" keeps the entries to be printed and queues their
+ * addresses for resolution, the entries are printed once the dump is done.
+ */
+static int prefetch_neigh_names(struct nlmsghdr *n, void *arg)
+{
+	struct ndmsg *r = NLMSG_DATA(n);
+	int len = n->nlmsg_len - NLMSG_LENGTH(sizeof(*r));
+	struct rtattr *tb[NDA_MAX+1];
+
+	if (n->nlmsg_type != RTM_NEWNEIGH || len < 0)
+		return 0;
+	if (filter.family && filter.family != r->ndm_family)
+		return 0;
+	if (filter.index && filter.index != r->ndm_ifindex)
+		return 0;
+	if (!(filter.state&r->ndm_state) &&
+	    !(r->ndm_flags & NTF_PROXY) &&
+	    !(r->ndm_flags & NTF_EXT_LEARNED) &&
+	    (r->ndm_state || !(filter.state&0x100)) &&
+	    (r->ndm_family != AF_DECnet))
+		return 0;
+
+	parse_rtattr(tb, NDA_MAX, NDA_RTA(r), len);
+	if (tb[NDA_DST])
+		resolve_prefetch(r->ndm_family, RTA_PAYLOAD(tb[NDA_DST]),
+				 RTA_DATA(tb[NDA_DST]));
+	return store_nlmsg(n, arg);
+}
+
 static int do_show_or_flush(int argc, char **argv, int flush)
 {
 	char *filter_dev = NULL;
@@ -590,6 +619,25 @@ static int do_show_or_flush(int argc, char **argv, int flush)
 		exit(1);
 	}
 
+	if (resolve_hosts) {
+		struct nlmsg_chain ninfo = { NULL, NULL };
+		struct nlmsg_list *l;
+
+		if (rtnl_dump_filter(&rth, prefetch_neigh_names, &ninfo) < 0) {
+			fprintf(stderr, "Dump terminated\n");
+			exit(1);
+		}
+		resolve_prefetch_wait();
+
+		new_json_obj(json);
+		for (l = ninfo.head; l; l = l->next)
+			if (print_neigh(&l->h, stdout) < 0)
+				break;
+		delete_json_obj();
+		free_nlmsg_chain(&ninfo);
+		return 0;
+	}
+
 	new_json_obj(json);
 	if (rtnl_dump_filter(&rth, print_neigh, stdout) < 0) {
 		fprintf(stderr, "Dump terminated\n");
@@ -30,9 +30,6 @@ enum {
 	IPNH_FLUSH,
 };
 
-#define RTM_NHA(h)  ((struct rtattr *)(((char *)(h)) + \
-			NLMSG_ALIGN(sizeof(struct nhmsg))))
-
 static void usage(void) __attribute__((noreturn));
 
 static void usage(void)
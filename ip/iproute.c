@@ -1727,6 +1727,56 @@ static int iproute_flush(int family, rtnl_filter_t filter_fn)
 	}
 }
 
+/* "ip -r route" keeps the routes to be printed and queues their
+ * addresses for resolution, the routes are printed once the dump is done.
+ */
+static int prefetch_route_names(struct nlmsghdr *n, void *arg)
+{
+	static const int attrs[] = { RTA_DST, RTA_SRC, RTA_GATEWAY,
+				     RTA_PREFSRC };
+	struct rtmsg *r = NLMSG_DATA(n);
+	int len = n->nlmsg_len - NLMSG_LENGTH(sizeof(*r));
+	struct rtattr *tb[RTA_MAX+1];
+	int i;
+
+	if (n->nlmsg_type != RTM_NEWROUTE || len < 0)
+		return 0;
+
+	parse_rtattr(tb, RTA_MAX, RTM_RTA(r), len);
+	if (!filter_nlmsg(n, tb, af_bit_len(r->rtm_family)))
+		return 0;
+
+	for (i = 0; i < ARRAY_SIZE(attrs); i++)
+		if (tb[attrs[i]])
+			resolve_prefetch(r->rtm_family,
+					 RTA_PAYLOAD(tb[attrs[i]]),
+					 RTA_DATA(tb[attrs[i]]));
+	return store_nlmsg(n, arg);
+}
+
+static int iproute_list_resolved(void)
+{
+	struct nlmsg_chain rinfo = { NULL, NULL };
+	struct nlmsg_list *l;
+
+	if (rtnl_dump_filter(&rth, prefetch_route_names, &rinfo) < 0) {
+		free_nlmsg_chain(&rinfo);
+		fprintf(stderr, "Dump terminated\n");
+		return -2;
+	}
+	resolve_prefetch_wait();
+
+	new_json_obj(json);
+	for (l = rinfo.head; l; l = l->next)
+		if (print_route(&l->h, stdout) < 0)
+			break;
+	delete_json_obj();
+
+	free_nlmsg_chain(&rinfo);
+	fflush(stdout);
+	return 0;
+}
+
 static int iproute_list_flush_or_save(int argc, char **argv, int action)
 {
 	int dump_family = preferred_family;
@@ -1937,6 +1987,9 @@ static int iproute_list_flush_or_save(int argc, char **argv, int action)
 		return -2;
 	}
 
+	if (resolve_hosts && filter_fn == print_route)
+		return iproute_list_resolved();
+
 	new_json_obj(json);
 
 	if (rtnl_dump_filter(&rth, filter_fn, stdout) < 0) {
@@ -2227,8 +2280,6 @@ static int restore_handler(struct rtnl_ctrl_data *ctrl,
 restore:
 	n->nlmsg_flags |= NLM_F_REQUEST | NLM_F_CREATE | NLM_F_ACK;
 
-	ll_init_map(&rth);
-
 	ret = rtnl_talk(&rth, n, NULL);
 	if ((ret < 0) && (errno == EEXIST))
 		ret = 0;
@@ -2262,6 +2313,8 @@ static int iproute_restore(void)
 	if (route_dump_check_magic())
 		return -1;
 
+	ll_init_map(&rth);
+
 	pos = ftell(stdin);
 	if (pos == -1) {
 		perror("Failed to restore: ftell");
@@ -19,6 +19,7 @@
 #include <netinet/ip.h>
 #include <arpa/inet.h>
 #include <string.h>
+#include <time.h>
 #include <linux/if.h>
 #include <linux/fib_rules.h>
 #include <errno.h>
@@ -83,6 +84,10 @@ static struct
 	struct fib_rule_port_range sport;
 	struct fib_rule_port_range dport;
 	__u8 ipproto;
+	int flushed;
+	char *flushb;
+	int flushp;
+	int flushe;
 } filter;
 
 static inline int frh_get_table(struct fib_rule_hdr *frh, struct rtattr **tb)
@@ -510,13 +515,24 @@ static int save_rule(struct nlmsghdr *n, void *arg)
 	return ret == n->nlmsg_len ? 0 : ret;
 }
 
+static int flush_update(void)
+{
+	if (rtnl_send_check(&rth, filter.flushb, filter.flushp) < 0) {
+		perror("Failed to send flush request");
+		return -2;
+	}
+	filter.flushp = 0;
+	return 0;
+}
+
 static int flush_rule(struct nlmsghdr *n, void *arg)
 {
-	struct rtnl_handle rth2;
 	struct fib_rule_hdr *frh = NLMSG_DATA(n);
 	int len = n->nlmsg_len;
 	struct rtattr *tb[FRA_MAX+1];
+	struct nlmsghdr *fn;
 	int host_len = -1;
+	int ret;
 
 	len -= NLMSG_LENGTH(sizeof(*frh));
 	if (len < 0)
@@ -535,22 +551,65 @@ static int flush_rule(struct nlmsghdr *n, void *arg)
 			return 0;
 	}
 
-	if (tb[FRA_PRIORITY]) {
-		n->nlmsg_type = RTM_DELRULE;
-		n->nlmsg_flags = NLM_F_REQUEST;
-
-		if (rtnl_open(&rth2, 0) < 0)
-			return -1;
-
-		if (rtnl_talk(&rth2, n, NULL) < 0)
-			return -2;
+	if (!tb[FRA_PRIORITY])
+		return 0;
 
-		rtnl_close(&rth2);
+	if (NLMSG_ALIGN(filter.flushp) + n->nlmsg_len > filter.flushe) {
+		ret = flush_update();
+		if (ret < 0)
+			return ret;
 	}
+	fn = (struct nlmsghdr *)(filter.flushb + NLMSG_ALIGN(filter.flushp));
+	memcpy(fn, n, n->nlmsg_len);
+	fn->nlmsg_type = RTM_DELRULE;
+	fn->nlmsg_flags = NLM_F_REQUEST;
+	fn->nlmsg_seq = ++rth.seq;
+	filter.flushp = (((char *)fn) + n->nlmsg_len) - filter.flushb;
+	filter.flushed++;
 
 	return 0;
 }
 
+/*
+ * Deleting rules shifts the kernel's dump position, so dump again until
+ * a round finds nothing left to delete.
+ */
+static int iprule_flush(int af)
+{
+	time_t start = time(0);
+	char flushb[16384];
+	int ret;
+
+	filter.flushb = flushb;
+	filter.flushp = 0;
+	filter.flushe = sizeof(flushb);
+
+	for (;;) {
+		if (rtnl_ruledump_req(&rth, af) < 0) {
+			perror("Cannot send dump request");
+			return 1;
+		}
+		filter.flushed = 0;
+		if (rtnl_dump_filter(&rth, flush_rule, NULL) < 0) {
+			fprintf(stderr, "Flush terminated\n");
+			return 1;
+		}
+		if (filter.flushed == 0)
+			return 0;
+
+		ret = flush_update();
+		if (ret < 0)
+			return ret;
+
+		if (time(0) - start > 30) {
+			fprintf(stderr,
+				"*** Flush not completed after %ld seconds, %d rules remain ***\n",
+				(long)(time(0) - start), filter.flushed);
+			return 1;
+		}
+	}
+}
+
 static int iprule_list_flush_or_save(int argc, char **argv, int action)
 {
 	rtnl_filter_t filter_fn;
@@ -570,9 +629,6 @@ static int iprule_list_flush_or_save(int argc, char **argv, int action)
 			return -1;
 		filter_fn = save_rule;
 		break;
-	case IPRULE_FLUSH:
-		filter_fn = flush_rule;
-		break;
 	default:
 		filter_fn = print_rule;
 	}
@@ -710,6 +766,9 @@ static int iprule_list_flush_or_save(int argc, char **argv, int action)
 		argc--; argv++;
 	}
 
+	if (action == IPRULE_FLUSH)
+		return iprule_flush(af);
+
 	if (rtnl_ruledump_req(&rth, af) < 0) {
 		perror("Cannot send dump request");
 		return 1;
@@ -745,29 +804,77 @@ static int rule_dump_check_magic(void)
 	return 0;
 }
 
+/*
+ * Saved rules are sent in windows of up to RESTORE_WINDOW requests per
+ * sendmsg(), with the ACKs for a window collected before the next one.
+ */
+#define RESTORE_WINDOW	64
+
+static struct {
+	char buf[16384];
+	int len;
+	struct iovec iov[RESTORE_WINDOW];
+	int count;
+} restore;
+
+static int restore_flush(void)
+{
+	int ret;
+
+	if (restore.count == 0)
+		return 0;
+
+	/* rules which already exist are fine, any other failure is not */
+	ret = rtnl_talk_iov_ignore(&rth, restore.iov, restore.count, EEXIST);
+
+	restore.len = 0;
+	restore.count = 0;
+	return ret;
+}
+
 static int restore_handler(struct rtnl_ctrl_data *ctrl,
 			   struct nlmsghdr *n, void *arg)
 {
+	struct nlmsghdr *rn;
 	int ret;
 
-	n->nlmsg_flags |= NLM_F_REQUEST | NLM_F_CREATE | NLM_F_ACK;
+	if (n->nlmsg_len > sizeof(restore.buf)) {
+		fprintf(stderr, "Rule message too long: %u\n", n->nlmsg_len);
+		return -1;
+	}
 
-	ll_init_map(&rth);
+	if (restore.count == RESTORE_WINDOW ||
+	    NLMSG_ALIGN(restore.len) + n->nlmsg_len > sizeof(restore.buf)) {
+		ret = restore_flush();
+		if (ret < 0)
+			return ret;
+	}
 
-	ret = rtnl_talk(&rth, n, NULL);
-	if ((ret < 0) && (errno == EEXIST))
-		ret = 0;
+	rn = (struct nlmsghdr *)(restore.buf + NLMSG_ALIGN(restore.len));
+	memcpy(rn, n, n->nlmsg_len);
+	rn->nlmsg_flags |= NLM_F_REQUEST | NLM_F_CREATE | NLM_F_ACK;
 
-	return ret;
-}
+	restore.iov[restore.count].iov_base = rn;
+	restore.iov[restore.count].iov_len = NLMSG_ALIGN(rn->nlmsg_len);
+	restore.count++;
+	restore.len = NLMSG_ALIGN(restore.len) + rn->nlmsg_len;
 
+	return 0;
+}
 
 static int iprule_restore(void)
 {
+	int ret;
+
 	if (rule_dump_check_magic())
 		exit(-1);
 
-	exit(rtnl_from_file(stdin, &restore_handler, NULL));
+	ll_init_map(&rth);
+
+	ret = rtnl_from_file(stdin, &restore_handler, NULL);
+	if (ret == 0)
+		ret = restore_flush();
+	exit(ret);
 }
 
 static int iprule_modify(int cmd, int argc, char **argv)
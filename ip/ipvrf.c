@@ -14,6 +14,7 @@
 #include <sys/stat.h>
 #include <sys/socket.h>
 #include <sys/mount.h>
+#include <sys/vfs.h>
 #include <linux/bpf.h>
 #include <linux/if.h>
 #include <fcntl.h>
@@ -32,6 +33,9 @@
 
 #define CGRP_PROC_FILE  "/cgroup.procs"
 
+/* programs pinned by ifindex, which is all they depend on */
+#define VRF_BPF_PIN_DIR	BPF_DIR_MNT "/vrf"
+
 static struct link_filter vrf_filter;
 
 static void usage(void)
@@ -245,6 +249,7 @@ static char bpf_log_buf[256*1024];
 
 static int prog_load(int idx)
 {
+	int prog_fd;
 	struct bpf_insn prog[] = {
 		BPF_MOV64_REG(BPF_REG_6, BPF_REG_1),
 		BPF_MOV64_IMM(BPF_REG_3, idx),
@@ -256,8 +261,74 @@ static int prog_load(int idx)
 		BPF_EXIT_INSN(),
 	};
 
-	return bpf_program_load(BPF_PROG_TYPE_CGROUP_SOCK, prog, sizeof(prog),
-			        "GPL", bpf_log_buf, sizeof(bpf_log_buf));
+	/* only ask the verifier for a log when there is an error to explain */
+	prog_fd = bpf_program_load(BPF_PROG_TYPE_CGROUP_SOCK, prog,
+				   sizeof(prog), "GPL", NULL, 0);
+	if (prog_fd < 0 && errno != EPERM)
+		prog_fd = bpf_program_load(BPF_PROG_TYPE_CGROUP_SOCK, prog,
+					   sizeof(prog), "GPL", bpf_log_buf,
+					   sizeof(bpf_log_buf));
+	return prog_fd;
+}
+
+/*
+ * Get the program for ifindex from bpffs, or load and pin it there so
+ * that later execs skip the verifier. Without bpffs mounted at the usual
+ * place the program is loaded every time.
+ */
+static int vrf_prog_get(int ifindex)
+{
+	struct bpf_prog_info info = {};
+	__u32 info_len = sizeof(info);
+	char pin[PATH_MAX];
+	struct statfs st_fs;
+	int prog_fd;
+
+	if (statfs(BPF_DIR_MNT, &st_fs) < 0 ||
+	    (unsigned long)st_fs.f_type != BPF_FS_MAGIC)
+		return prog_load(ifindex);
+
+	snprintf(pin, sizeof(pin), "%s/%d", VRF_BPF_PIN_DIR, ifindex);
+	prog_fd = iproute2_bpf_obj_get(pin, BPF_PROG_TYPE_CGROUP_SOCK);
+	if (prog_fd >= 0) {
+		if (!bpf_prog_info_by_fd(prog_fd, &info, &info_len) &&
+		    info.type == BPF_PROG_TYPE_CGROUP_SOCK)
+			return prog_fd;
+
+		close(prog_fd);
+		unlink(pin);
+	}
+
+	prog_fd = prog_load(ifindex);
+	if (prog_fd < 0)
+		return prog_fd;
+
+	/* a failed pin only costs the next exec another load */
+	if (mkdir(VRF_BPF_PIN_DIR, 0700) == 0 || errno == EEXIST)
+		iproute2_bpf_obj_pin(prog_fd, pin);
+
+	return prog_fd;
+}
+
+/* is prog_fd attached to the cgroup itself, rather than inherited */
+static bool vrf_prog_attached(int cg_fd, int prog_fd)
+{
+	struct bpf_prog_info info = {};
+	__u32 info_len = sizeof(info);
+	__u32 prog_ids[64];
+	__u32 prog_cnt = ARRAY_SIZE(prog_ids);
+	__u32 i;
+
+	if (bpf_prog_info_by_fd(prog_fd, &info, &info_len) ||
+	    bpf_prog_query_fd(cg_fd, BPF_CGROUP_INET_SOCK_CREATE,
+			      prog_ids, &prog_cnt))
+		return false;
+
+	for (i = 0; i < prog_cnt; i++) {
+		if (prog_ids[i] == info.id)
+			return true;
+	}
+	return false;
 }
 
 static int vrf_configure_cgroup(const char *path, int ifindex)
@@ -276,7 +347,7 @@ static int vrf_configure_cgroup(const char *path, int ifindex)
 	 * Load bpf program into kernel and attach to cgroup to affect
 	 * socket creates
 	 */
-	prog_fd = prog_load(ifindex);
+	prog_fd = vrf_prog_get(ifindex);
 	if (prog_fd < 0) {
 		fprintf(stderr, "Failed to load BPF prog: '%s'\n%s",
 			strerror(errno), bpf_log_buf);
@@ -288,6 +359,11 @@ static int vrf_configure_cgroup(const char *path, int ifindex)
 		goto out;
 	}
 
+	if (vrf_prog_attached(cg_fd, prog_fd)) {
+		rc = 0;
+		goto out;
+	}
+
 	if (bpf_program_attach(prog_fd, cg_fd, BPF_CGROUP_INET_SOCK_CREATE)) {
 		fprintf(stderr, "Failed to attach prog to cgroup: '%s'\n",
 			strerror(errno));
@@ -18,52 +18,221 @@
 #include <sys/time.h>
 #include <netinet/in.h>
 #include <string.h>
+#include <limits.h>
 
 #include "version.h"
 
 #include "utils.h"
 #include "libnetlink.h"
+#include "rtmon.h"
 
 static int init_phase = 1;
 
-static void write_stamp(FILE *fp)
+/* Log segment being written, rotated to FILE.1 .. FILE.count at size */
+static struct {
+	const char *file;
+	unsigned long long size;
+	unsigned int count;
+	FILE *fp;
+	FILE *idx;
+	unsigned long long len;
+	unsigned long long idx_next;
+} seg = {
+	.count = 4,
+};
+
+static void seg_write(const void *data, size_t len)
+{
+	fwrite(data, 1, len, seg.fp);
+	seg.len += len;
+}
+
+static void write_stamp(struct timeval *tv)
 {
 	char buf[128];
 	struct nlmsghdr *n1 = (void *)buf;
-	struct timeval tv;
 
 	n1->nlmsg_type = NLMSG_TSTAMP;
 	n1->nlmsg_flags = 0;
 	n1->nlmsg_seq = 0;
 	n1->nlmsg_pid = 0;
 	n1->nlmsg_len = NLMSG_LENGTH(4*2);
-	gettimeofday(&tv, NULL);
-	((__u32 *)NLMSG_DATA(n1))[0] = tv.tv_sec;
-	((__u32 *)NLMSG_DATA(n1))[1] = tv.tv_usec;
-	fwrite((void *)n1, 1, NLMSG_ALIGN(n1->nlmsg_len), fp);
+	gettimeofday(tv, NULL);
+	((__u32 *)NLMSG_DATA(n1))[0] = tv->tv_sec;
+	((__u32 *)NLMSG_DATA(n1))[1] = tv->tv_usec;
+	seg_write(n1, NLMSG_ALIGN(n1->nlmsg_len));
+}
+
+static void write_index(const struct timeval *tv, unsigned long long offset)
+{
+	struct rtmon_idx_ent ent = {
+		.sec = tv->tv_sec,
+		.usec = tv->tv_usec,
+		.offset = offset,
+	};
+
+	if (!seg.idx || offset < seg.idx_next)
+		return;
+
+	if (fwrite(&ent, sizeof(ent), 1, seg.idx) != 1 || fflush(seg.idx)) {
+		perror("rtmon: index write");
+		fclose(seg.idx);
+		seg.idx = NULL;
+		return;
+	}
+	seg.idx_next = offset + RTMON_IDX_STEP;
+}
+
+static int dump_msg(struct rtnl_ctrl_data *ctrl,
+		    struct nlmsghdr *n, void *arg);
+
+static int dump_msg2(struct nlmsghdr *n, void *arg)
+{
+	return dump_msg(NULL, n, arg);
+}
+
+/* Name of the current segment (0) or a rotated one, plus suffix */
+static void seg_name(char *buf, size_t len, unsigned int n,
+		     const char *suffix)
+{
+	if (n)
+		snprintf(buf, len, "%s.%u%s", seg.file, n, suffix);
+	else
+		snprintf(buf, len, "%s%s", seg.file, suffix);
+}
+
+/* Start a segment with a time stamp and a dump of all links */
+static int seg_open(struct rtnl_handle *rth)
+{
+	struct rtmon_idx_hdr hdr = { .magic = RTMON_IDX_MAGIC };
+	char idxname[PATH_MAX];
+	struct timeval tv;
+
+	seg.fp = fopen(seg.file, "w");
+	if (seg.fp == NULL) {
+		perror("Cannot fopen");
+		return -1;
+	}
+	seg.len = 0;
+
+	if (rtnl_linkdump_req(rth, AF_UNSPEC) < 0) {
+		perror("Cannot send dump request");
+		return -1;
+	}
+
+	init_phase = 1;
+	write_stamp(&tv);
+	if (rtnl_dump_filter(rth, dump_msg2, NULL) < 0) {
+		fprintf(stderr, "Dump terminated\n");
+		return -1;
+	}
+	init_phase = 0;
+	fflush(seg.fp);
+
+	seg_name(idxname, sizeof(idxname), 0, RTMON_IDX_SUFFIX);
+	seg.idx = fopen(idxname, "w");
+	if (seg.idx == NULL) {
+		perror("rtmon: index fopen");
+		return 0;
+	}
+	hdr.head_len = seg.len;
+	seg.idx_next = seg.len;
+	if (fwrite(&hdr, sizeof(hdr), 1, seg.idx) != 1 || fflush(seg.idx)) {
+		perror("rtmon: index write");
+		fclose(seg.idx);
+		seg.idx = NULL;
+	}
+	return 0;
+}
+
+static void seg_rename(unsigned int from, unsigned int to)
+{
+	char oldname[PATH_MAX], newname[PATH_MAX];
+
+	seg_name(oldname, sizeof(oldname), from, "");
+	seg_name(newname, sizeof(newname), to, "");
+	rename(oldname, newname);
+
+	/* never leave an index behind that describes another segment */
+	seg_name(oldname, sizeof(oldname), from, RTMON_IDX_SUFFIX);
+	seg_name(newname, sizeof(newname), to, RTMON_IDX_SUFFIX);
+	if (rename(oldname, newname) < 0)
+		unlink(newname);
+}
+
+static int seg_rotate(void)
+{
+	struct rtnl_handle rth2;
+	unsigned int i;
+	int ret;
+
+	fclose(seg.fp);
+	if (seg.idx)
+		fclose(seg.idx);
+	seg.idx = NULL;
+
+	if (seg.count) {
+		for (i = seg.count - 1; i > 0; i--)
+			seg_rename(i, i + 1);
+		seg_rename(0, 1);
+	}
+
+	if (rtnl_open(&rth2, 0) < 0)
+		return -1;
+	ret = seg_open(&rth2);
+	rtnl_close(&rth2);
+	return ret;
 }
 
 static int dump_msg(struct rtnl_ctrl_data *ctrl,
 		    struct nlmsghdr *n, void *arg)
 {
-	FILE *fp = (FILE *)arg;
+	unsigned long long offset;
+	struct timeval tv;
+
+	if (!init_phase) {
+		if (seg.size && seg.len >= seg.size && seg_rotate() < 0)
+			return -1;
 
-	if (!init_phase)
-		write_stamp(fp);
-	fwrite((void *)n, 1, NLMSG_ALIGN(n->nlmsg_len), fp);
-	fflush(fp);
+		offset = seg.len;
+		write_stamp(&tv);
+		write_index(&tv, offset);
+	}
+	seg_write(n, NLMSG_ALIGN(n->nlmsg_len));
+	fflush(seg.fp);
 	return 0;
 }
 
-static int dump_msg2(struct nlmsghdr *n, void *arg)
+static int get_seg_size(unsigned long long *size, const char *arg)
 {
-	return dump_msg(NULL, n, arg);
+	char *end;
+
+	*size = strtoull(arg, &end, 0);
+	switch (*end) {
+	case 'k':
+	case 'K':
+		*size <<= 10;
+		end++;
+		break;
+	case 'm':
+	case 'M':
+		*size <<= 20;
+		end++;
+		break;
+	case 'g':
+	case 'G':
+		*size <<= 30;
+		end++;
+		break;
+	}
+	return end == arg || *end ? -1 : 0;
 }
 
 static void usage(void)
 {
 	fprintf(stderr,
-		"Usage: rtmon [ OPTIONS ] file FILE [ all | LISTofOBJECTS ]\n"
+		"Usage: rtmon [ OPTIONS ] file FILE [ size SIZE [ count COUNT ] ]\n"
+		"             [ all | LISTofOBJECTS ]\n"
 		"OPTIONS := { -f[amily] { inet | inet6 | link | help } |\n"
 		"	     -4 | -6 | -0 | -V[ersion] }\n"
 		"LISTofOBJECTS := [ link ] [ address ] [ route ]\n");
@@ -73,7 +242,6 @@ static void usage(void)
 int
 main(int argc, char **argv)
 {
-	FILE *fp;
 	struct rtnl_handle rth;
 	int family = AF_UNSPEC;
 	unsigned int groups = ~0U;
@@ -115,6 +283,24 @@ main(int argc, char **argv)
 			if (argc <= 1)
 				usage();
 			file = argv[1];
+		} else if (strcmp(argv[1], "size") == 0) {
+			argc--;
+			argv++;
+			if (argc <= 1)
+				usage();
+			if (get_seg_size(&seg.size, argv[1])) {
+				fprintf(stderr, "Invalid segment size \"%s\"\n", argv[1]);
+				exit(-1);
+			}
+		} else if (strcmp(argv[1], "count") == 0) {
+			argc--;
+			argv++;
+			if (argc <= 1)
+				usage();
+			if (get_unsigned(&seg.count, argv[1], 0)) {
+				fprintf(stderr, "Invalid segment count \"%s\"\n", argv[1]);
+				exit(-1);
+			}
 		} else if (matches(argv[1], "link") == 0) {
 			llink = 1;
 			groups = 0;
@@ -154,30 +340,14 @@ main(int argc, char **argv)
 			groups |= nl_mgrp(RTNLGRP_IPV6_ROUTE);
 	}
 
-	fp = fopen(file, "w");
-	if (fp == NULL) {
-		perror("Cannot fopen");
-		exit(-1);
-	}
-
 	if (rtnl_open(&rth, groups) < 0)
 		exit(1);
 
-	if (rtnl_linkdump_req(&rth, AF_UNSPEC) < 0) {
-		perror("Cannot send dump request");
-		exit(1);
-	}
-
-	write_stamp(fp);
-
-	if (rtnl_dump_filter(&rth, dump_msg2, fp) < 0) {
-		fprintf(stderr, "Dump terminated\n");
+	seg.file = file;
+	if (seg_open(&rth) < 0)
 		return 1;
-	}
-
-	init_phase = 0;
 
-	if (rtnl_listen(&rth, dump_msg, (void *)fp) < 0)
+	if (rtnl_listen(&rth, dump_msg, NULL) < 0)
 		exit(2);
 
 	exit(0);
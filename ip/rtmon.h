@@ -0,0 +1,32 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef __RTMON_H__
+#define __RTMON_H__ 1
+
+#include <linux/types.h>
+
+/*
+ * Sparse time index kept by rtmon next to each log segment, in
+ * "<segment>.idx". The header is followed by entries in log order, each
+ * giving the offset of an NLMSG_TSTAMP message in the segment and the
+ * time it carries. head_len is the size of the link dump that starts
+ * every segment, a reader that seeks replays it first to learn the
+ * interface names.
+ */
+#define RTMON_IDX_MAGIC		"IPR2RIDX"
+#define RTMON_IDX_SUFFIX	".idx"
+
+/* Log bytes between two index entries */
+#define RTMON_IDX_STEP		(1024 * 1024)
+
+struct rtmon_idx_hdr {
+	char	magic[8];
+	__u64	head_len;
+};
+
+struct rtmon_idx_ent {
+	__u32	sec;
+	__u32	usec;
+	__u64	offset;
+};
+
+#endif /* __RTMON_H__ */
@@ -167,8 +167,8 @@ static int bpf_prog_fd_by_id(uint32_t id)
 	return bpf(BPF_PROG_GET_FD_BY_ID, &attr, sizeof(attr));
 }
 
-static int bpf_prog_info_by_fd(int fd, struct bpf_prog_info *info,
-			       uint32_t *info_len)
+int bpf_prog_info_by_fd(int fd, struct bpf_prog_info *info,
+			uint32_t *info_len)
 {
 	union bpf_attr attr = {};
 	int ret;
@@ -793,7 +793,8 @@ out:
 	return mnt;
 }
 
-static int bpf_obj_get(const char *pathname, enum bpf_prog_type type)
+/* Named apart from libbpf's bpf_obj_get() and bpf_obj_pin() */
+int iproute2_bpf_obj_get(const char *pathname, enum bpf_prog_type type)
 {
 	union bpf_attr attr = {};
 	char tmp[PATH_MAX];
@@ -810,9 +811,19 @@ static int bpf_obj_get(const char *pathname, enum bpf_prog_type type)
 	return bpf(BPF_OBJ_GET, &attr, sizeof(attr));
 }
 
+int iproute2_bpf_obj_pin(int fd, const char *pathname)
+{
+	union bpf_attr attr = {};
+
+	attr.pathname = bpf_ptr_to_u64(pathname);
+	attr.bpf_fd = fd;
+
+	return bpf(BPF_OBJ_PIN, &attr, sizeof(attr));
+}
+
 static int bpf_obj_pinned(const char *pathname, enum bpf_prog_type type)
 {
-	int prog_fd = bpf_obj_get(pathname, type);
+	int prog_fd = iproute2_bpf_obj_get(pathname, type);
 
 	if (prog_fd < 0)
 		fprintf(stderr, "Couldn\'t retrieve pinned program \'%s\': %s\n",
@@ -1037,7 +1048,7 @@ int bpf_graft_map(const char *map_path, uint32_t *key, int argc, char **argv)
 		}
 	}
 
-	map_fd = bpf_obj_get(map_path, cfg.type);
+	map_fd = iproute2_bpf_obj_get(map_path, cfg.type);
 	if (map_fd < 0) {
 		fprintf(stderr, "Couldn\'t retrieve pinned map \'%s\': %s\n",
 			map_path, strerror(errno));
@@ -1084,6 +1095,24 @@ int bpf_prog_detach_fd(int target_fd, enum bpf_attach_type type)
 	return bpf(BPF_PROG_DETACH, &attr, sizeof(attr));
 }
 
+int bpf_prog_query_fd(int target_fd, enum bpf_attach_type type,
+		      __u32 *prog_ids, __u32 *prog_cnt)
+{
+	union bpf_attr attr = {};
+	int ret;
+
+	attr.query.target_fd = target_fd;
+	attr.query.attach_type = type;
+	attr.query.prog_ids = bpf_ptr_to_u64(prog_ids);
+	attr.query.prog_cnt = *prog_cnt;
+
+	ret = bpf(BPF_PROG_QUERY, &attr, sizeof(attr));
+	if (!ret)
+		*prog_cnt = attr.query.prog_cnt;
+
+	return ret;
+}
+
 int bpf_prog_load_dev(enum bpf_prog_type type, const struct bpf_insn *insns,
 		      size_t size_insns, const char *license, __u32 ifindex,
 		      char *log, size_t size_log)
@@ -1276,16 +1305,6 @@ static int bpf_btf_load(void *btf, size_t size_btf,
 	return bpf(BPF_BTF_LOAD, &attr, sizeof(attr));
 }
 
-static int bpf_obj_pin(int fd, const char *pathname)
-{
-	union bpf_attr attr = {};
-
-	attr.pathname = bpf_ptr_to_u64(pathname);
-	attr.bpf_fd = fd;
-
-	return bpf(BPF_OBJ_PIN, &attr, sizeof(attr));
-}
-
 static int bpf_obj_hash(const char *object, uint8_t *out, size_t len)
 {
 	struct sockaddr_alg alg = {
@@ -1425,7 +1444,7 @@ static int bpf_probe_pinned(const char *name, const struct bpf_elf_ctx *ctx,
 		return 0;
 
 	bpf_make_pathname(pathname, sizeof(pathname), name, ctx, pinning);
-	return bpf_obj_get(pathname, ctx->type);
+	return iproute2_bpf_obj_get(pathname, ctx->type);
 }
 
 static int bpf_make_obj_path(const struct bpf_elf_ctx *ctx)
@@ -1493,7 +1512,7 @@ static int bpf_place_pinned(int fd, const char *name,
 		return ret;
 
 	bpf_make_pathname(pathname, sizeof(pathname), name, ctx, pinning);
-	return bpf_obj_pin(fd, pathname);
+	return iproute2_bpf_obj_pin(fd, pathname);
 }
 
 static void bpf_prog_report(int fd, const char *section,
@@ -11,6 +11,7 @@
 
 #include <stdarg.h>
 #include <stdio.h>
+#include <arpa/inet.h>
 
 #include "utils.h"
 #include "json_print.h"
@@ -20,7 +21,7 @@ static json_writer_t *_jw;
 static void __new_json_obj(int json, bool have_array)
 {
 	if (json) {
-		_jw = jsonw_new(stdout);
+		_jw = cbor ? jsonw_new_cbor(stdout) : jsonw_new(stdout);
 		if (!_jw) {
 			perror("json object");
 			exit(1);
@@ -161,6 +162,68 @@ _PRINT_NAME_VALUE_FUNC(uint, unsigned int, u);
 _PRINT_NAME_VALUE_FUNC(string, const char*, s);
 #undef _PRINT_NAME_VALUE_FUNC
 
+/* Parse a colon separated link layer address, as ll_addr_n2a() prints it */
+static int cbor_lladdr(const char *str, unsigned char *buf, int size)
+{
+	unsigned int byte;
+	int len = 0, n;
+
+	while (len < size && sscanf(str, "%2x%n", &byte, &n) == 1 && n == 2) {
+		buf[len++] = byte;
+		str += n;
+		if (!*str)
+			return len;
+		if (*str++ != ':')
+			break;
+	}
+	return -1;
+}
+
+/*
+ * CBOR output carries addresses natively: link layer addresses as byte
+ * strings and IP addresses as RFC 9164 tagged byte strings. Anything
+ * which does not parse, e.g. a resolved host name, stays a text string.
+ */
+static bool cbor_print_addr(enum color_attr color, const char *key,
+			    const char *value)
+{
+	unsigned char buf[32];
+	int len, tag;
+
+	if (!value || !jsonw_is_cbor(_jw))
+		return false;
+
+	switch (color) {
+	case COLOR_MAC:
+		len = cbor_lladdr(value, buf, sizeof(buf));
+		if (len <= 0)
+			return false;
+		tag = 0;
+		break;
+	case COLOR_INET:
+		if (inet_pton(AF_INET, value, buf) != 1)
+			return false;
+		len = 4;
+		tag = 52;
+		break;
+	case COLOR_INET6:
+		if (inet_pton(AF_INET6, value, buf) != 1)
+			return false;
+		len = 16;
+		tag = 54;
+		break;
+	default:
+		return false;
+	}
+
+	if (key)
+		jsonw_name(_jw, key);
+	if (tag)
+		jsonw_tag(_jw, tag);
+	jsonw_bytes(_jw, buf, len);
+	return true;
+}
+
 int print_color_string(enum output_type type,
 		       enum color_attr color,
 		       const char *key,
@@ -170,6 +233,8 @@ int print_color_string(enum output_type type,
 	int ret = 0;
 
 	if (_IS_JSON_CONTEXT(type)) {
+		if (cbor_print_addr(color, key, value))
+			return 0;
 		if (key && !value)
 			jsonw_name(_jw, key);
 		else if (!key && value)
@@ -243,6 +308,8 @@ int print_color_0xhex(enum output_type type,
 	if (_IS_JSON_CONTEXT(type)) {
 		SPRINT_BUF(b1);
 
+		if (jsonw_is_cbor(_jw))
+			return print_color_lluint(type, color, key, fmt, hex);
 		snprintf(b1, sizeof(b1), "%#llx", hex);
 		print_string(PRINT_JSON, key, NULL, b1);
 	} else if (_IS_FP_CONTEXT(type)) {
@@ -263,6 +330,8 @@ int print_color_hex(enum output_type type,
 	if (_IS_JSON_CONTEXT(type)) {
 		SPRINT_BUF(b1);
 
+		if (jsonw_is_cbor(_jw))
+			return print_color_uint(type, color, key, fmt, hex);
 		snprintf(b1, sizeof(b1), "%x", hex);
 		if (key)
 			jsonw_string_field(_jw, key, b1);
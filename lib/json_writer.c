@@ -5,12 +5,18 @@
  * This takes care of the annoying bits of JSON syntax like the commas
  * after elements
  *
+ * The same interface can also emit CBOR (RFC 8949), using indefinite
+ * length maps and arrays so that nothing has to be known up front.
+ *
  * Authors:	Stephen Hemminger <stephen@networkplumber.org>
  */
 
 #include <stdio.h>
 #include <stdbool.h>
 #include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
 #include <assert.h>
 #include <malloc.h>
 #include <inttypes.h>
@@ -18,19 +24,135 @@
 
 #include "json_writer.h"
 
+/*
+ * Output is collected in a private buffer and handed to stdio in large
+ * chunks. The buffer is also drained whenever a top level element is
+ * closed, so callers which interleave their own writes to the same FILE
+ * or flush it per event keep seeing complete elements in order.
+ */
+#define JSONW_BUF_SIZE	65536
+
 struct json_writer {
 	FILE		*out;	/* output file */
 	unsigned	depth;  /* nesting */
 	bool		pretty; /* optional whitepace */
 	char		sep;	/* either nul or comma */
+	bool		cbor;	/* binary output */
+	size_t		len;	/* bytes pending in buf */
+	char		buf[JSONW_BUF_SIZE];
 };
 
+static void jsonw_flush(json_writer_t *self)
+{
+	if (self->len) {
+		fwrite(self->buf, 1, self->len, self->out);
+		self->len = 0;
+	}
+}
+
+/* make room for n bytes, n must not exceed JSONW_BUF_SIZE */
+static char *jsonw_reserve(json_writer_t *self, size_t n)
+{
+	if (self->len + n > JSONW_BUF_SIZE)
+		jsonw_flush(self);
+	return self->buf + self->len;
+}
+
+static void jsonw_putc(json_writer_t *self, char c)
+{
+	*jsonw_reserve(self, 1) = c;
+	self->len++;
+}
+
+static void jsonw_write(json_writer_t *self, const char *str, size_t n)
+{
+	if (n > JSONW_BUF_SIZE) {
+		jsonw_flush(self);
+		fwrite(str, 1, n, self->out);
+		return;
+	}
+	memcpy(jsonw_reserve(self, n), str, n);
+	self->len += n;
+}
+
+/* CBOR major types and simple values */
+#define CBOR_UINT		0
+#define CBOR_NINT		1
+#define CBOR_BYTES		2
+#define CBOR_TEXT		3
+#define CBOR_TAG		6
+#define CBOR_FALSE		0xf4
+#define CBOR_TRUE		0xf5
+#define CBOR_NULL		0xf6
+#define CBOR_DOUBLE		0xfb
+#define CBOR_ARRAY_START	0x9f
+#define CBOR_MAP_START		0xbf
+#define CBOR_BREAK		0xff
+
+/* Output an item head: major type plus the shortest argument encoding */
+static void cbor_head(json_writer_t *self, unsigned int major, uint64_t val)
+{
+	unsigned char *p = (unsigned char *)jsonw_reserve(self, 9);
+	unsigned int info, n;
+
+	if (val < 24) {
+		*p = major << 5 | val;
+		self->len++;
+		return;
+	}
+
+	if (val <= UINT8_MAX) {
+		info = 24;
+		n = 1;
+	} else if (val <= UINT16_MAX) {
+		info = 25;
+		n = 2;
+	} else if (val <= UINT32_MAX) {
+		info = 26;
+		n = 4;
+	} else {
+		info = 27;
+		n = 8;
+	}
+
+	*p++ = major << 5 | info;
+	self->len += 1 + n;
+	while (n--)
+		*p++ = val >> (n * 8);
+}
+
+static void cbor_string(json_writer_t *self, unsigned int major,
+			const void *str, size_t len)
+{
+	cbor_head(self, major, len);
+	jsonw_write(self, str, len);
+}
+
+static void cbor_double(json_writer_t *self, double num)
+{
+	unsigned char *p = (unsigned char *)jsonw_reserve(self, 9);
+	uint64_t val;
+	int n = 8;
+
+	memcpy(&val, &num, sizeof(val));
+	*p++ = CBOR_DOUBLE;
+	while (n--)
+		*p++ = val >> (n * 8);
+	self->len += 9;
+}
+
 /* indentation for pretty print */
 static void jsonw_indent(json_writer_t *self)
 {
-	unsigned i;
-	for (i = 0; i < self->depth; ++i)
-		fputs("    ", self->out);
+	static const char spaces[] = "                                "
+				     "                                ";
+	size_t n = self->depth * 4;
+
+	while (n > sizeof(spaces) - 1) {
+		jsonw_write(self, spaces, sizeof(spaces) - 1);
+		n -= sizeof(spaces) - 1;
+	}
+	jsonw_write(self, spaces, n);
 }
 
 /* end current line and indent if pretty printing */
@@ -39,7 +161,7 @@ static void jsonw_eol(json_writer_t *self)
 	if (!self->pretty)
 		return;
 
-	putc('\n', self->out);
+	jsonw_putc(self, '\n');
 	jsonw_indent(self);
 }
 
@@ -47,7 +169,7 @@ static void jsonw_eol(json_writer_t *self)
 static void jsonw_eor(json_writer_t *self)
 {
 	if (self->sep != '\0')
-		putc(self->sep, self->out);
+		jsonw_putc(self, self->sep);
 	self->sep = ',';
 }
 
@@ -56,37 +178,101 @@ static void jsonw_eor(json_writer_t *self)
 /* Handles C escapes, does not do Unicode */
 static void jsonw_puts(json_writer_t *self, const char *str)
 {
-	putc('"', self->out);
-	for (; *str; ++str)
-		switch (*str) {
+	size_t n;
+
+	if (self->cbor) {
+		cbor_string(self, CBOR_TEXT, str, strlen(str));
+		return;
+	}
+
+	jsonw_putc(self, '"');
+	for (;;) {
+		/* copy the run up to the next character needing an escape */
+		n = strcspn(str, "\t\n\r\f\b\\\"\'");
+		jsonw_write(self, str, n);
+		str += n;
+		if (!*str)
+			break;
+
+		switch (*str++) {
 		case '\t':
-			fputs("\\t", self->out);
+			jsonw_write(self, "\\t", 2);
 			break;
 		case '\n':
-			fputs("\\n", self->out);
+			jsonw_write(self, "\\n", 2);
 			break;
 		case '\r':
-			fputs("\\r", self->out);
+			jsonw_write(self, "\\r", 2);
 			break;
 		case '\f':
-			fputs("\\f", self->out);
+			jsonw_write(self, "\\f", 2);
 			break;
 		case '\b':
-			fputs("\\b", self->out);
+			jsonw_write(self, "\\b", 2);
 			break;
 		case '\\':
-			fputs("\\\\", self->out);
+			jsonw_write(self, "\\\\", 2);
 			break;
 		case '"':
-			fputs("\\\"", self->out);
+			jsonw_write(self, "\\\"", 2);
 			break;
 		case '\'':
-			fputs("\\\'", self->out);
+			jsonw_write(self, "\\\'", 2);
 			break;
-		default:
-			putc(*str, self->out);
 		}
-	putc('"', self->out);
+	}
+	jsonw_putc(self, '"');
+}
+
+/* Output an unsigned number without going through printf */
+static void jsonw_put_u64(json_writer_t *self, uint64_t num, bool neg)
+{
+	char tmp[24], *p = tmp + sizeof(tmp);
+
+	if (self->cbor) {
+		if (neg)
+			cbor_head(self, CBOR_NINT, num - 1);
+		else
+			cbor_head(self, CBOR_UINT, num);
+		return;
+	}
+
+	do {
+		*--p = '0' + num % 10;
+		num /= 10;
+	} while (num);
+	if (neg)
+		*--p = '-';
+
+	jsonw_eor(self);
+	jsonw_write(self, p, tmp + sizeof(tmp) - p);
+}
+
+static void jsonw_put_x64(json_writer_t *self, uint64_t num)
+{
+	static const char digits[] = "0123456789abcdef";
+	char tmp[16], *p = tmp + sizeof(tmp);
+
+	if (self->cbor) {
+		cbor_head(self, CBOR_UINT, num);
+		return;
+	}
+
+	do {
+		*--p = digits[num & 0xf];
+		num >>= 4;
+	} while (num);
+
+	jsonw_eor(self);
+	jsonw_write(self, p, tmp + sizeof(tmp) - p);
+}
+
+static void jsonw_put_s64(json_writer_t *self, int64_t num)
+{
+	if (num < 0)
+		jsonw_put_u64(self, -(uint64_t)num, true);
+	else
+		jsonw_put_u64(self, num, false);
 }
 
 /* Create a new JSON stream */
@@ -98,17 +284,36 @@ json_writer_t *jsonw_new(FILE *f)
 		self->depth = 0;
 		self->pretty = false;
 		self->sep = '\0';
+		self->cbor = false;
+		self->len = 0;
 	}
 	return self;
 }
 
+/* Create a new CBOR stream */
+json_writer_t *jsonw_new_cbor(FILE *f)
+{
+	json_writer_t *self = jsonw_new(f);
+
+	if (self)
+		self->cbor = true;
+	return self;
+}
+
+bool jsonw_is_cbor(const json_writer_t *self)
+{
+	return self->cbor;
+}
+
 /* End output to JSON stream */
 void jsonw_destroy(json_writer_t **self_p)
 {
 	json_writer_t *self = *self_p;
 
 	assert(self->depth == 0);
-	fputs("\n", self->out);
+	if (!self->cbor)
+		jsonw_putc(self, '\n');
+	jsonw_flush(self);
 	fflush(self->out);
 	free(self);
 	*self_p = NULL;
@@ -116,14 +321,33 @@ void jsonw_destroy(json_writer_t **self_p)
 
 void jsonw_pretty(json_writer_t *self, bool on)
 {
-	self->pretty = on;
+	self->pretty = on && !self->cbor;
+}
+
+/* Top level elements separated this way form a JSON lines stream,
+ * or a CBOR sequence which needs no separator at all.
+ */
+void jsonw_new_line(json_writer_t *self)
+{
+	assert(self->depth == 0);
+	if (self->sep == '\0')
+		return;
+	if (!self->cbor)
+		jsonw_putc(self, '\n');
+	self->sep = '\0';
 }
 
 /* Basic blocks */
 static void jsonw_begin(json_writer_t *self, int c)
 {
+	if (self->cbor) {
+		jsonw_putc(self, c == '{' ? CBOR_MAP_START : CBOR_ARRAY_START);
+		++self->depth;
+		return;
+	}
+
 	jsonw_eor(self);
-	putc(c, self->out);
+	jsonw_putc(self, c);
 	++self->depth;
 	self->sep = '\0';
 }
@@ -133,33 +357,106 @@ static void jsonw_end(json_writer_t *self, int c)
 	assert(self->depth > 0);
 
 	--self->depth;
-	if (self->sep != '\0')
-		jsonw_eol(self);
-	putc(c, self->out);
+	if (self->cbor)
+		jsonw_putc(self, CBOR_BREAK);
+	else {
+		if (self->sep != '\0')
+			jsonw_eol(self);
+		jsonw_putc(self, c);
+	}
 	self->sep = ',';
+
+	if (self->depth <= 1)
+		jsonw_flush(self);
 }
 
 
 /* Add a JSON property name */
 void jsonw_name(json_writer_t *self, const char *name)
 {
+	if (self->cbor) {
+		jsonw_puts(self, name);
+		return;
+	}
+
 	jsonw_eor(self);
 	jsonw_eol(self);
 	self->sep = '\0';
 	jsonw_puts(self, name);
-	putc(':', self->out);
+	jsonw_putc(self, ':');
 	if (self->pretty)
-		putc(' ', self->out);
+		jsonw_putc(self, ' ');
+}
+
+/*
+ * jsonw_printf() output is a raw JSON value, in practice a formatted
+ * number. Keep numbers numeric in CBOR and fall back to text.
+ */
+static void cbor_printf_value(json_writer_t *self, const char *str)
+{
+	char *end;
+	long long ll;
+	double d;
+
+	errno = 0;
+	ll = strtoll(str, &end, 10);
+	if (*str && !*end && !errno) {
+		if (ll < 0)
+			jsonw_put_u64(self, -(uint64_t)ll, true);
+		else
+			jsonw_put_u64(self, ll, false);
+		return;
+	}
+
+	d = strtod(str, &end);
+	if (*str && !*end) {
+		cbor_double(self, d);
+		return;
+	}
+
+	cbor_string(self, CBOR_TEXT, str, strlen(str));
 }
 
 __attribute__((format(printf, 2, 3)))
 void jsonw_printf(json_writer_t *self, const char *fmt, ...)
 {
+	size_t avail;
 	va_list ap;
+	int n;
+
+	if (self->cbor) {
+		char *str;
+
+		va_start(ap, fmt);
+		n = vasprintf(&str, fmt, ap);
+		va_end(ap);
+		if (n < 0)
+			return;
+		cbor_printf_value(self, str);
+		free(str);
+		return;
+	}
 
-	va_start(ap, fmt);
 	jsonw_eor(self);
-	vfprintf(self->out, fmt, ap);
+
+	avail = JSONW_BUF_SIZE - self->len;
+	va_start(ap, fmt);
+	n = vsnprintf(self->buf + self->len, avail, fmt, ap);
+	va_end(ap);
+	if (n < 0)
+		return;
+	if ((size_t)n < avail) {
+		self->len += n;
+		return;
+	}
+
+	/* did not fit, retry with an empty buffer or bypass it */
+	jsonw_flush(self);
+	va_start(ap, fmt);
+	if (n < JSONW_BUF_SIZE)
+		self->len = vsnprintf(self->buf, JSONW_BUF_SIZE, fmt, ap);
+	else
+		vfprintf(self->out, fmt, ap);
 	va_end(ap);
 }
 
@@ -178,82 +475,130 @@ void jsonw_start_array(json_writer_t *self)
 {
 	jsonw_begin(self, '[');
 	if (self->pretty)
-		putc(' ', self->out);
+		jsonw_putc(self, ' ');
 }
 
 void jsonw_end_array(json_writer_t *self)
 {
 	if (self->pretty && self->sep)
-		putc(' ', self->out);
+		jsonw_putc(self, ' ');
 	self->sep = '\0';
 	jsonw_end(self, ']');
 }
 
+/* Native binary values, a tag is only emitted in CBOR output */
+void jsonw_tag(json_writer_t *self, uint64_t tag)
+{
+	if (self->cbor)
+		cbor_head(self, CBOR_TAG, tag);
+}
+
+/* Byte string in CBOR, hex digits string in JSON */
+void jsonw_bytes(json_writer_t *self, const void *buf, size_t len)
+{
+	static const char digits[] = "0123456789abcdef";
+	const unsigned char *p = buf;
+
+	if (self->cbor) {
+		cbor_string(self, CBOR_BYTES, buf, len);
+		return;
+	}
+
+	jsonw_eor(self);
+	jsonw_putc(self, '"');
+	while (len--) {
+		jsonw_putc(self, digits[*p >> 4]);
+		jsonw_putc(self, digits[*p++ & 0xf]);
+	}
+	jsonw_putc(self, '"');
+}
+
 /* JSON value types */
 void jsonw_string(json_writer_t *self, const char *value)
 {
-	jsonw_eor(self);
+	if (!self->cbor)
+		jsonw_eor(self);
 	jsonw_puts(self, value);
 }
 
 void jsonw_bool(json_writer_t *self, bool val)
 {
-	jsonw_printf(self, "%s", val ? "true" : "false");
+	if (self->cbor) {
+		jsonw_putc(self, val ? CBOR_TRUE : CBOR_FALSE);
+		return;
+	}
+
+	jsonw_eor(self);
+	if (val)
+		jsonw_write(self, "true", 4);
+	else
+		jsonw_write(self, "false", 5);
 }
 
 void jsonw_null(json_writer_t *self)
 {
-	jsonw_printf(self, "null");
+	if (self->cbor) {
+		jsonw_putc(self, CBOR_NULL);
+		return;
+	}
+
+	jsonw_eor(self);
+	jsonw_write(self, "null", 4);
 }
 
 void jsonw_float(json_writer_t *self, double num)
 {
+	if (self->cbor) {
+		cbor_double(self, num);
+		return;
+	}
+
 	jsonw_printf(self, "%g", num);
 }
 
 void jsonw_hhu(json_writer_t *self, unsigned char num)
 {
-	jsonw_printf(self, "%hhu", num);
+	jsonw_put_u64(self, num, false);
 }
 
 void jsonw_hu(json_writer_t *self, unsigned short num)
 {
-	jsonw_printf(self, "%hu", num);
+	jsonw_put_u64(self, num, false);
 }
 
 void jsonw_uint(json_writer_t *self, unsigned int num)
 {
-	jsonw_printf(self, "%u", num);
+	jsonw_put_u64(self, num, false);
 }
 
 void jsonw_u64(json_writer_t *self, uint64_t num)
 {
-	jsonw_printf(self, "%"PRIu64, num);
+	jsonw_put_u64(self, num, false);
 }
 
 void jsonw_xint(json_writer_t *self, uint64_t num)
 {
-	jsonw_printf(self, "%"PRIx64, num);
+	jsonw_put_x64(self, num);
 }
 
 void jsonw_luint(json_writer_t *self, unsigned long num)
 {
-	jsonw_printf(self, "%lu", num);
+	jsonw_put_u64(self, num, false);
 }
 
 void jsonw_lluint(json_writer_t *self, unsigned long long num)
 {
-	jsonw_printf(self, "%llu", num);
+	jsonw_put_u64(self, num, false);
 }
 
 void jsonw_int(json_writer_t *self, int num)
 {
-	jsonw_printf(self, "%d", num);
+	jsonw_put_s64(self, num);
 }
 
 void jsonw_s64(json_writer_t *self, int64_t num)
 {
-	jsonw_printf(self, "%"PRId64, num);
+	jsonw_put_s64(self, num);
 }
 
 /* Basic name/value objects */
@@ -0,0 +1,666 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * libiproute2.c	In-process API for common rtnetlink objects
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <net/if.h>
+#include <linux/if_arp.h>
+#include <linux/pkt_sched.h>
+
+#include "libnetlink.h"
+#include "utils.h"
+#include "libiproute2.h"
+
+struct ipr2_ctx {
+	struct rtnl_handle	rth;
+	char			errmsg[256];
+};
+
+struct ipr2_dump {
+	struct ipr2_ctx		*ctx;
+	void			*cb;
+	void			*data;
+	int			ifindex;
+};
+
+struct ipr2_ctx *ipr2_open(void)
+{
+	struct ipr2_ctx *ctx = calloc(1, sizeof(*ctx));
+
+	if (!ctx)
+		return NULL;
+
+	if (rtnl_open(&ctx->rth, 0) < 0) {
+		free(ctx);
+		return NULL;
+	}
+	rtnl_set_strict_dump(&ctx->rth);
+	return ctx;
+}
+
+void ipr2_close(struct ipr2_ctx *ctx)
+{
+	if (!ctx)
+		return;
+	rtnl_close(&ctx->rth);
+	free(ctx);
+}
+
+const char *ipr2_errmsg(const struct ipr2_ctx *ctx)
+{
+	return ctx->errmsg;
+}
+
+/* Keep the extended ack message of a failed request */
+static void ipr2_save_errmsg(struct ipr2_ctx *ctx, struct nlmsghdr *h,
+			     int error)
+{
+	struct nlmsgerr *err = NLMSG_DATA(h);
+	struct rtattr *tb[NLMSGERR_ATTR_MAX + 1];
+	unsigned int offset;
+
+	snprintf(ctx->errmsg, sizeof(ctx->errmsg), "%s", strerror(-error));
+	if (!(h->nlmsg_flags & NLM_F_ACK_TLVS))
+		return;
+
+	offset = sizeof(*err);
+	if (!(h->nlmsg_flags & NLM_F_CAPPED))
+		offset += err->msg.nlmsg_len - sizeof(struct nlmsghdr);
+	if (NLMSG_LENGTH(offset) >= h->nlmsg_len)
+		return;
+
+	parse_rtattr(tb, NLMSGERR_ATTR_MAX,
+		     (struct rtattr *)((char *)err + NLMSG_ALIGN(offset)),
+		     h->nlmsg_len - NLMSG_LENGTH(NLMSG_ALIGN(offset)));
+	if (tb[NLMSGERR_ATTR_MSG])
+		snprintf(ctx->errmsg, sizeof(ctx->errmsg), "%s",
+			 rta_getattr_str(tb[NLMSGERR_ATTR_MSG]));
+}
+
+static int ipr2_talk(struct ipr2_ctx *ctx, struct nlmsghdr *n,
+		     struct nlmsghdr **answer)
+{
+	struct nlmsghdr *reply = NULL;
+	int ret;
+
+	ctx->errmsg[0] = '\0';
+	if (!answer)
+		n->nlmsg_flags |= NLM_F_ACK;
+
+	ret = rtnl_talk_suppress_rtnl_errmsg(&ctx->rth, n, &reply);
+	if (ret < 0) {
+		ret = errno ? -errno : -EIO;
+		if (reply && reply->nlmsg_type == NLMSG_ERROR)
+			ipr2_save_errmsg(ctx, reply, ret);
+		free(reply);
+		return ret;
+	}
+
+	if (answer)
+		*answer = reply;
+	else
+		free(reply);
+	return 0;
+}
+
+/* Dump of all objects, those not bound to ifindex are skipped if it is set */
+static int ipr2_dump_run_dev(struct ipr2_ctx *ctx, int ret,
+			     rtnl_filter_t filter, void *cb, void *data,
+			     int ifindex)
+{
+	struct ipr2_dump dump = {
+		.ctx = ctx,
+		.cb = cb,
+		.data = data,
+		.ifindex = ifindex,
+	};
+
+	ctx->errmsg[0] = '\0';
+	if (ret < 0)
+		return errno ? -errno : -EIO;
+
+	ret = rtnl_dump_filter(&ctx->rth, filter, &dump);
+	if (ret < 0)
+		return errno ? -errno : ret;
+	return 0;
+}
+
+static int ipr2_dump_run(struct ipr2_ctx *ctx, int ret, rtnl_filter_t filter,
+			 void *cb, void *data)
+{
+	return ipr2_dump_run_dev(ctx, ret, filter, cb, data, 0);
+}
+
+static void ipr2_addr_set(struct ipr2_addr *addr, int family,
+			  const struct rtattr *rta)
+{
+	int len = RTA_PAYLOAD(rta);
+
+	if (len > sizeof(addr->data))
+		len = sizeof(addr->data);
+	addr->family = family;
+	addr->len = len;
+	memcpy(addr->data, RTA_DATA(rta), len);
+}
+
+int ipr2_parse_addr(const char *str, int family, struct ipr2_addr *addr,
+		    int *prefixlen)
+{
+	inet_prefix pfx;
+	char *arg;
+	int ret;
+
+	arg = strdup(str);
+	if (!arg)
+		return -ENOMEM;
+	ret = get_prefix_1(&pfx, arg, family);
+	free(arg);
+	if (ret || pfx.bytelen > sizeof(addr->data))
+		return -EINVAL;
+
+	memset(addr, 0, sizeof(*addr));
+	addr->family = pfx.family;
+	addr->len = pfx.bytelen;
+	memcpy(addr->data, pfx.data, pfx.bytelen);
+	if (prefixlen)
+		*prefixlen = pfx.bitlen;
+	return 0;
+}
+
+const char *ipr2_addr_ntop(const struct ipr2_addr *addr, char *buf,
+			   int buflen)
+{
+	return rt_addr_n2a_r(addr->family, addr->len, addr->data,
+			     buf, buflen);
+}
+
+/* addattr_l() reports overflows on stderr, the library only returns them */
+static int ipr2_addattr_l(struct nlmsghdr *n, int maxlen, int type,
+			  const void *data, int alen)
+{
+	if (NLMSG_ALIGN(n->nlmsg_len) + RTA_ALIGN(RTA_LENGTH(alen)) > maxlen)
+		return -EMSGSIZE;
+	return addattr_l(n, maxlen, type, data, alen);
+}
+
+static void ipr2_addattr_addr(struct nlmsghdr *n, int maxlen, int type,
+			      const struct ipr2_addr *addr)
+{
+	if (addr->len)
+		addattr_l(n, maxlen, type, addr->data, addr->len);
+}
+
+/* Links */
+static void ipr2_link_parse(struct nlmsghdr *n, struct ipr2_link *link)
+{
+	struct ifinfomsg *ifi = NLMSG_DATA(n);
+	struct rtattr *tb[IFLA_MAX + 1];
+	struct rtattr *linkinfo[IFLA_INFO_MAX + 1];
+
+	parse_rtattr_flags(tb, IFLA_MAX, IFLA_RTA(ifi), IFLA_PAYLOAD(n),
+			   NLA_F_NESTED);
+
+	memset(link, 0, sizeof(*link));
+	link->ifindex = ifi->ifi_index;
+	link->flags = ifi->ifi_flags;
+	link->type = ifi->ifi_type;
+	if (tb[IFLA_IFNAME])
+		link->name = rta_getattr_str(tb[IFLA_IFNAME]);
+	if (tb[IFLA_MTU])
+		link->mtu = rta_getattr_u32(tb[IFLA_MTU]);
+	if (tb[IFLA_OPERSTATE])
+		link->operstate = rta_getattr_u8(tb[IFLA_OPERSTATE]);
+	if (tb[IFLA_MASTER])
+		link->master = rta_getattr_u32(tb[IFLA_MASTER]);
+	if (tb[IFLA_LINK])
+		link->link = rta_getattr_u32(tb[IFLA_LINK]);
+	if (tb[IFLA_ADDRESS]) {
+		link->lladdr = RTA_DATA(tb[IFLA_ADDRESS]);
+		link->lladdr_len = RTA_PAYLOAD(tb[IFLA_ADDRESS]);
+	}
+	if (tb[IFLA_LINKINFO]) {
+		parse_rtattr_nested(linkinfo, IFLA_INFO_MAX, tb[IFLA_LINKINFO]);
+		if (linkinfo[IFLA_INFO_KIND])
+			link->kind = rta_getattr_str(linkinfo[IFLA_INFO_KIND]);
+	}
+}
+
+static int ipr2_link_filter(struct nlmsghdr *n, void *arg)
+{
+	struct ipr2_dump *dump = arg;
+	ipr2_link_cb cb = dump->cb;
+	struct ipr2_link link;
+
+	if (n->nlmsg_type != RTM_NEWLINK ||
+	    n->nlmsg_len < NLMSG_LENGTH(sizeof(struct ifinfomsg)))
+		return 0;
+
+	ipr2_link_parse(n, &link);
+	return cb(&link, dump->data);
+}
+
+int ipr2_link_dump(struct ipr2_ctx *ctx, ipr2_link_cb cb, void *data)
+{
+	return ipr2_dump_run(ctx, rtnl_linkdump_req(&ctx->rth, AF_UNSPEC),
+			     ipr2_link_filter, cb, data);
+}
+
+int ipr2_link_get(struct ipr2_ctx *ctx, const char *name, ipr2_link_cb cb,
+		  void *data)
+{
+	struct {
+		struct nlmsghdr		n;
+		struct ifinfomsg	i;
+		char			buf[RTA_SPACE(sizeof(__u32)) +
+					    RTA_SPACE(ALTIFNAMSIZ)];
+	} req = {
+		.n.nlmsg_len = NLMSG_LENGTH(sizeof(struct ifinfomsg)),
+		.n.nlmsg_type = RTM_GETLINK,
+		.n.nlmsg_flags = NLM_F_REQUEST,
+		.i.ifi_family = AF_UNSPEC,
+	};
+	size_t len = strlen(name);
+	struct nlmsghdr *answer;
+	struct ipr2_link link;
+	int ret;
+
+	if (len >= ALTIFNAMSIZ)
+		return -ENAMETOOLONG;
+
+	addattr32(&req.n, sizeof(req), IFLA_EXT_MASK, RTEXT_FILTER_SKIP_STATS);
+	ret = ipr2_addattr_l(&req.n, sizeof(req),
+			     len < IFNAMSIZ ? IFLA_IFNAME : IFLA_ALT_IFNAME,
+			     name, len + 1);
+	if (ret)
+		return ret;
+
+	ret = ipr2_talk(ctx, &req.n, &answer);
+	if (ret)
+		return ret;
+
+	ipr2_link_parse(answer, &link);
+	ret = cb ? cb(&link, data) : link.ifindex;
+	free(answer);
+	return ret;
+}
+
+int ipr2_link_index(struct ipr2_ctx *ctx, const char *name)
+{
+	return ipr2_link_get(ctx, name, NULL, NULL);
+}
+
+static int ipr2_link_change(struct ipr2_ctx *ctx, int ifindex,
+			    unsigned int flags, unsigned int change,
+			    int type, const void *val, int len)
+{
+	struct {
+		struct nlmsghdr		n;
+		struct ifinfomsg	i;
+		char			buf[64];
+	} req = {
+		.n.nlmsg_len = NLMSG_LENGTH(sizeof(struct ifinfomsg)),
+		.n.nlmsg_type = RTM_NEWLINK,
+		.n.nlmsg_flags = NLM_F_REQUEST,
+		.i.ifi_family = AF_UNSPEC,
+		.i.ifi_index = ifindex,
+		.i.ifi_flags = flags,
+		.i.ifi_change = change,
+	};
+
+	if (val)
+		addattr_l(&req.n, sizeof(req), type, val, len);
+	return ipr2_talk(ctx, &req.n, NULL);
+}
+
+int ipr2_link_set_up(struct ipr2_ctx *ctx, int ifindex, bool up)
+{
+	return ipr2_link_change(ctx, ifindex, up ? IFF_UP : 0, IFF_UP,
+				0, NULL, 0);
+}
+
+int ipr2_link_set_mtu(struct ipr2_ctx *ctx, int ifindex, unsigned int mtu)
+{
+	return ipr2_link_change(ctx, ifindex, 0, 0, IFLA_MTU,
+				&mtu, sizeof(mtu));
+}
+
+/* Addresses */
+static int ipr2_address_filter(struct nlmsghdr *n, void *arg)
+{
+	struct ipr2_dump *dump = arg;
+	ipr2_address_cb cb = dump->cb;
+	struct ifaddrmsg *ifa = NLMSG_DATA(n);
+	struct rtattr *tb[IFA_MAX + 1];
+	struct ipr2_address addr = {};
+
+	if (n->nlmsg_type != RTM_NEWADDR ||
+	    n->nlmsg_len < NLMSG_LENGTH(sizeof(*ifa)))
+		return 0;
+
+	parse_rtattr(tb, IFA_MAX, IFA_RTA(ifa),
+		     n->nlmsg_len - NLMSG_LENGTH(sizeof(*ifa)));
+
+	addr.ifindex = ifa->ifa_index;
+	addr.family = ifa->ifa_family;
+	addr.prefixlen = ifa->ifa_prefixlen;
+	addr.scope = ifa->ifa_scope;
+	addr.flags = tb[IFA_FLAGS] ? rta_getattr_u32(tb[IFA_FLAGS]) :
+				     ifa->ifa_flags;
+	if (tb[IFA_LOCAL])
+		ipr2_addr_set(&addr.local, ifa->ifa_family, tb[IFA_LOCAL]);
+	if (tb[IFA_ADDRESS])
+		ipr2_addr_set(&addr.address, ifa->ifa_family, tb[IFA_ADDRESS]);
+	if (tb[IFA_BROADCAST])
+		ipr2_addr_set(&addr.broadcast, ifa->ifa_family,
+			      tb[IFA_BROADCAST]);
+	if (tb[IFA_LABEL])
+		addr.label = rta_getattr_str(tb[IFA_LABEL]);
+	if (tb[IFA_CACHEINFO]) {
+		struct ifa_cacheinfo *ci = RTA_DATA(tb[IFA_CACHEINFO]);
+
+		addr.valid_lft = ci->ifa_valid;
+		addr.preferred_lft = ci->ifa_prefered;
+	}
+
+	return cb(&addr, dump->data);
+}
+
+int ipr2_address_dump(struct ipr2_ctx *ctx, int family, ipr2_address_cb cb,
+		      void *data)
+{
+	return ipr2_dump_run(ctx, rtnl_addrdump_req(&ctx->rth, family, NULL),
+			     ipr2_address_filter, cb, data);
+}
+
+static void ipr2_op_flags(struct nlmsghdr *n, enum ipr2_op op, int new,
+			  int del)
+{
+	switch (op) {
+	case IPR2_ADD:
+		n->nlmsg_type = new;
+		n->nlmsg_flags |= NLM_F_CREATE | NLM_F_EXCL;
+		break;
+	case IPR2_REPLACE:
+		n->nlmsg_type = new;
+		n->nlmsg_flags |= NLM_F_CREATE | NLM_F_REPLACE;
+		break;
+	case IPR2_DEL:
+		n->nlmsg_type = del;
+		break;
+	}
+}
+
+int ipr2_address_modify(struct ipr2_ctx *ctx, enum ipr2_op op,
+			const struct ipr2_address *addr)
+{
+	const struct ipr2_addr *local = addr->local.len ? &addr->local :
+							  &addr->address;
+	struct {
+		struct nlmsghdr		n;
+		struct ifaddrmsg	ifa;
+		char			buf[256];
+	} req = {
+		.n.nlmsg_len = NLMSG_LENGTH(sizeof(struct ifaddrmsg)),
+		.n.nlmsg_flags = NLM_F_REQUEST,
+		.ifa.ifa_family = addr->family ? : local->family,
+		.ifa.ifa_prefixlen = addr->prefixlen,
+		.ifa.ifa_scope = addr->scope,
+		.ifa.ifa_index = addr->ifindex,
+	};
+
+	if (!local->len)
+		return -EINVAL;
+
+	ipr2_op_flags(&req.n, op, RTM_NEWADDR, RTM_DELADDR);
+	ipr2_addattr_addr(&req.n, sizeof(req), IFA_LOCAL, local);
+	ipr2_addattr_addr(&req.n, sizeof(req), IFA_ADDRESS,
+			  addr->address.len ? &addr->address : local);
+	ipr2_addattr_addr(&req.n, sizeof(req), IFA_BROADCAST,
+			  &addr->broadcast);
+	if (addr->label &&
+	    ipr2_addattr_l(&req.n, sizeof(req), IFA_LABEL, addr->label,
+			   strlen(addr->label) + 1))
+		return -EINVAL;
+	if (addr->flags)
+		addattr32(&req.n, sizeof(req), IFA_FLAGS, addr->flags);
+
+	return ipr2_talk(ctx, &req.n, NULL);
+}
+
+/* Routes */
+static int ipr2_route_filter(struct nlmsghdr *n, void *arg)
+{
+	struct ipr2_dump *dump = arg;
+	ipr2_route_cb cb = dump->cb;
+	struct rtmsg *r = NLMSG_DATA(n);
+	struct rtattr *tb[RTA_MAX + 1];
+	struct ipr2_route route = {};
+
+	if (n->nlmsg_type != RTM_NEWROUTE ||
+	    n->nlmsg_len < NLMSG_LENGTH(sizeof(*r)))
+		return 0;
+
+	parse_rtattr(tb, RTA_MAX, RTM_RTA(r),
+		     n->nlmsg_len - NLMSG_LENGTH(sizeof(*r)));
+
+	route.family = r->rtm_family;
+	route.table = tb[RTA_TABLE] ? rta_getattr_u32(tb[RTA_TABLE]) :
+				      r->rtm_table;
+	route.protocol = r->rtm_protocol;
+	route.scope = r->rtm_scope;
+	route.type = r->rtm_type;
+	route.flags = r->rtm_flags;
+	route.dst_len = r->rtm_dst_len;
+	route.src_len = r->rtm_src_len;
+	if (tb[RTA_DST])
+		ipr2_addr_set(&route.dst, r->rtm_family, tb[RTA_DST]);
+	if (tb[RTA_SRC])
+		ipr2_addr_set(&route.src, r->rtm_family, tb[RTA_SRC]);
+	if (tb[RTA_GATEWAY])
+		ipr2_addr_set(&route.gateway, r->rtm_family, tb[RTA_GATEWAY]);
+	if (tb[RTA_PREFSRC])
+		ipr2_addr_set(&route.prefsrc, r->rtm_family, tb[RTA_PREFSRC]);
+	if (tb[RTA_OIF])
+		route.oif = rta_getattr_u32(tb[RTA_OIF]);
+	if (tb[RTA_IIF])
+		route.iif = rta_getattr_u32(tb[RTA_IIF]);
+	if (tb[RTA_PRIORITY])
+		route.priority = rta_getattr_u32(tb[RTA_PRIORITY]);
+
+	return cb(&route, dump->data);
+}
+
+int ipr2_route_dump(struct ipr2_ctx *ctx, int family, ipr2_route_cb cb,
+		    void *data)
+{
+	return ipr2_dump_run(ctx, rtnl_routedump_req(&ctx->rth, family, NULL),
+			     ipr2_route_filter, cb, data);
+}
+
+int ipr2_route_modify(struct ipr2_ctx *ctx, enum ipr2_op op,
+		      const struct ipr2_route *route)
+{
+	uint32_t table = route->table ? : RT_TABLE_MAIN;
+	struct {
+		struct nlmsghdr		n;
+		struct rtmsg		r;
+		char			buf[512];
+	} req = {
+		.n.nlmsg_len = NLMSG_LENGTH(sizeof(struct rtmsg)),
+		.n.nlmsg_flags = NLM_F_REQUEST,
+		.r.rtm_family = route->family,
+		.r.rtm_dst_len = route->dst_len,
+		.r.rtm_src_len = route->src_len,
+		.r.rtm_protocol = route->protocol ? : RTPROT_BOOT,
+		.r.rtm_scope = route->scope,
+		.r.rtm_type = route->type ? : RTN_UNICAST,
+		.r.rtm_flags = route->flags,
+	};
+
+	if (op == IPR2_DEL) {
+		req.r.rtm_scope = RT_SCOPE_NOWHERE;
+		if (!route->protocol)
+			req.r.rtm_protocol = 0;
+	} else if (!route->scope && !route->gateway.len &&
+		   req.r.rtm_type == RTN_UNICAST) {
+		req.r.rtm_scope = RT_SCOPE_LINK;
+	}
+
+	ipr2_op_flags(&req.n, op, RTM_NEWROUTE, RTM_DELROUTE);
+	if (table < 256) {
+		req.r.rtm_table = table;
+	} else {
+		req.r.rtm_table = RT_TABLE_UNSPEC;
+		addattr32(&req.n, sizeof(req), RTA_TABLE, table);
+	}
+	ipr2_addattr_addr(&req.n, sizeof(req), RTA_DST, &route->dst);
+	ipr2_addattr_addr(&req.n, sizeof(req), RTA_SRC, &route->src);
+	ipr2_addattr_addr(&req.n, sizeof(req), RTA_GATEWAY, &route->gateway);
+	ipr2_addattr_addr(&req.n, sizeof(req), RTA_PREFSRC, &route->prefsrc);
+	if (route->oif)
+		addattr32(&req.n, sizeof(req), RTA_OIF, route->oif);
+	if (route->priority)
+		addattr32(&req.n, sizeof(req), RTA_PRIORITY, route->priority);
+
+	return ipr2_talk(ctx, &req.n, NULL);
+}
+
+/* Neighbours */
+static int ipr2_neigh_filter(struct nlmsghdr *n, void *arg)
+{
+	struct ipr2_dump *dump = arg;
+	ipr2_neigh_cb cb = dump->cb;
+	struct ndmsg *ndm = NLMSG_DATA(n);
+	struct rtattr *tb[NDA_MAX + 1];
+	struct ipr2_neigh neigh = {};
+
+	if (n->nlmsg_type != RTM_NEWNEIGH ||
+	    n->nlmsg_len < NLMSG_LENGTH(sizeof(*ndm)))
+		return 0;
+
+	parse_rtattr(tb, NDA_MAX, NDA_RTA(ndm),
+		     n->nlmsg_len - NLMSG_LENGTH(sizeof(*ndm)));
+
+	neigh.ifindex = ndm->ndm_ifindex;
+	neigh.family = ndm->ndm_family;
+	neigh.state = ndm->ndm_state;
+	neigh.flags = ndm->ndm_flags;
+	if (tb[NDA_DST])
+		ipr2_addr_set(&neigh.dst, ndm->ndm_family, tb[NDA_DST]);
+	if (tb[NDA_LLADDR]) {
+		neigh.lladdr = RTA_DATA(tb[NDA_LLADDR]);
+		neigh.lladdr_len = RTA_PAYLOAD(tb[NDA_LLADDR]);
+	}
+
+	return cb(&neigh, dump->data);
+}
+
+int ipr2_neigh_dump(struct ipr2_ctx *ctx, int family, ipr2_neigh_cb cb,
+		    void *data)
+{
+	return ipr2_dump_run(ctx, rtnl_neighdump_req(&ctx->rth, family, NULL),
+			     ipr2_neigh_filter, cb, data);
+}
+
+int ipr2_neigh_modify(struct ipr2_ctx *ctx, enum ipr2_op op,
+		      const struct ipr2_neigh *neigh)
+{
+	struct {
+		struct nlmsghdr		n;
+		struct ndmsg		ndm;
+		char			buf[256];
+	} req = {
+		.n.nlmsg_len = NLMSG_LENGTH(sizeof(struct ndmsg)),
+		.n.nlmsg_flags = NLM_F_REQUEST,
+		.ndm.ndm_family = neigh->family ? : neigh->dst.family,
+		.ndm.ndm_ifindex = neigh->ifindex,
+		.ndm.ndm_state = neigh->state ? : NUD_PERMANENT,
+		.ndm.ndm_flags = neigh->flags,
+	};
+
+	if (!neigh->dst.len || !neigh->ifindex)
+		return -EINVAL;
+
+	ipr2_op_flags(&req.n, op, RTM_NEWNEIGH, RTM_DELNEIGH);
+	ipr2_addattr_addr(&req.n, sizeof(req), NDA_DST, &neigh->dst);
+	if (neigh->lladdr_len &&
+	    ipr2_addattr_l(&req.n, sizeof(req), NDA_LLADDR, neigh->lladdr,
+			   neigh->lladdr_len))
+		return -EINVAL;
+
+	return ipr2_talk(ctx, &req.n, NULL);
+}
+
+/* Queueing disciplines */
+static int ipr2_qdisc_filter(struct nlmsghdr *n, void *arg)
+{
+	struct ipr2_dump *dump = arg;
+	ipr2_qdisc_cb cb = dump->cb;
+	struct tcmsg *t = NLMSG_DATA(n);
+	struct rtattr *tb[TCA_MAX + 1];
+	struct ipr2_qdisc qdisc = {};
+
+	if (n->nlmsg_type != RTM_NEWQDISC ||
+	    n->nlmsg_len < NLMSG_LENGTH(sizeof(*t)))
+		return 0;
+	/* the kernel dumps the qdiscs of all links regardless */
+	if (dump->ifindex && t->tcm_ifindex != dump->ifindex)
+		return 0;
+
+	parse_rtattr(tb, TCA_MAX, TCA_RTA(t),
+		     n->nlmsg_len - NLMSG_LENGTH(sizeof(*t)));
+	if (!tb[TCA_KIND])
+		return 0;
+
+	qdisc.ifindex = t->tcm_ifindex;
+	qdisc.handle = t->tcm_handle;
+	qdisc.parent = t->tcm_parent;
+	qdisc.kind = rta_getattr_str(tb[TCA_KIND]);
+
+	return cb(&qdisc, dump->data);
+}
+
+int ipr2_qdisc_dump(struct ipr2_ctx *ctx, int ifindex, ipr2_qdisc_cb cb,
+		    void *data)
+{
+	struct tcmsg t = {
+		.tcm_family = AF_UNSPEC,
+		.tcm_ifindex = ifindex,
+	};
+
+	return ipr2_dump_run_dev(ctx,
+				 rtnl_dump_request(&ctx->rth, RTM_GETQDISC,
+						   &t, sizeof(t)),
+				 ipr2_qdisc_filter, cb, data, ifindex);
+}
+
+int ipr2_qdisc_del(struct ipr2_ctx *ctx, const struct ipr2_qdisc *qdisc)
+{
+	struct {
+		struct nlmsghdr		n;
+		struct tcmsg		t;
+		char			buf[64];
+	} req = {
+		.n.nlmsg_len = NLMSG_LENGTH(sizeof(struct tcmsg)),
+		.n.nlmsg_flags = NLM_F_REQUEST,
+		.n.nlmsg_type = RTM_DELQDISC,
+		.t.tcm_family = AF_UNSPEC,
+		.t.tcm_ifindex = qdisc->ifindex,
+		.t.tcm_handle = qdisc->handle,
+		.t.tcm_parent = qdisc->parent,
+	};
+
+	if (!qdisc->ifindex || !qdisc->parent)
+		return -EINVAL;
+
+	if (qdisc->kind &&
+	    ipr2_addattr_l(&req.n, sizeof(req), TCA_KIND, qdisc->kind,
+			   strlen(qdisc->kind) + 1))
+		return -EINVAL;
+
+	return ipr2_talk(ctx, &req.n, NULL);
+}
@@ -12,6 +12,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdarg.h>
 #include <stdbool.h>
 #include <unistd.h>
 #include <fcntl.h>
@@ -20,8 +21,14 @@
 #include <netinet/in.h>
 #include <string.h>
 #include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <poll.h>
 #include <time.h>
+#include <sys/time.h>
 #include <sys/uio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <linux/fib_rules.h>
 #include <linux/if_addrlabel.h>
 #include <linux/if_bridge.h>
@@ -43,6 +50,220 @@
 #endif
 
 int rcvbuf = 1024 * 1024;
+/* set by -rcvbuf, the size then goes past rmem_max */
+int rcvbuf_force;
+
+/*
+ * Accounting of netlink traffic per handle, enabled by setting the
+ * IPROUTE2_NL_STATS environment variable. A summary of every handle is
+ * printed to stderr on exit, which shows whether a command spends its
+ * time waiting for the kernel or parsing and printing the replies.
+ * Closed handles are added up by protocol and groups and freed.
+ */
+struct rtnl_stats {
+	struct rtnl_stats	*next;
+	struct rtnl_stats	**pprev;
+	int			proto;
+	__u32			groups;
+	__u32			portid;
+	/* number of closed handles added up, 0 for an open one */
+	unsigned int		handles;
+	double			opened;
+	double			life;
+	unsigned long		sent;
+	unsigned long		sent_bytes;
+	unsigned long		dumps;
+	unsigned long		recvmsgs;
+	unsigned long		msgs;
+	unsigned long		bytes;
+	unsigned long		allocs;
+	unsigned long		truncated;
+	unsigned long		enobufs;
+	size_t			max_buf;
+	double			send_time;
+	double			recv_time;
+	double			filter_time;
+};
+
+/* handles may be opened and closed from several threads */
+static pthread_mutex_t rtnl_stats_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct rtnl_stats *rtnl_stats_list;
+static struct rtnl_stats *rtnl_stats_closed;
+static struct rtnl_stats **rtnl_stats_closed_tail = &rtnl_stats_closed;
+
+static double rtnl_stats_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static const char *rtnl_stats_proto(int proto)
+{
+	switch (proto) {
+	case NETLINK_ROUTE:
+		return "rtnl";
+	case NETLINK_SOCK_DIAG:
+		return "sock_diag";
+	case NETLINK_XFRM:
+		return "xfrm";
+	case NETLINK_GENERIC:
+		return "genl";
+	}
+	return "netlink";
+}
+
+static void rtnl_stats_print_one(const struct rtnl_stats *st, double now)
+{
+	double life = st->handles ? st->life : now - st->opened;
+	double other = life - st->send_time - st->recv_time - st->filter_time;
+
+	if (st->handles)
+		fprintf(stderr,
+			"netlink stats: %u closed %s sockets groups 0x%x open %.6fs\n",
+			st->handles, rtnl_stats_proto(st->proto), st->groups,
+			life);
+	else
+		fprintf(stderr,
+			"netlink stats: %s socket portid %u groups 0x%x open %.6fs\n",
+			rtnl_stats_proto(st->proto), st->portid, st->groups,
+			life);
+	fprintf(stderr,
+		"  send:     %lu msgs %lu bytes %lu dumps %.6fs\n",
+		st->sent, st->sent_bytes, st->dumps, st->send_time);
+	fprintf(stderr,
+		"  recv:     %lu msgs %lu bytes %lu recvmsg %.6fs\n",
+		st->msgs, st->bytes, st->recvmsgs, st->recv_time);
+	fprintf(stderr,
+		"  buffers:  %lu allocated max %zu bytes %lu truncated %lu enobufs\n",
+		st->allocs, st->max_buf, st->truncated, st->enobufs);
+	fprintf(stderr,
+		"  callback: %.6fs other %.6fs\n",
+		st->filter_time, other > 0 ? other : 0);
+}
+
+static void rtnl_stats_print(void)
+{
+	double now = rtnl_stats_now();
+	struct rtnl_stats *st;
+
+	pthread_mutex_lock(&rtnl_stats_lock);
+	for (st = rtnl_stats_closed; st; st = st->next)
+		rtnl_stats_print_one(st, now);
+	for (st = rtnl_stats_list; st; st = st->next)
+		rtnl_stats_print_one(st, now);
+	pthread_mutex_unlock(&rtnl_stats_lock);
+}
+
+static void rtnl_stats_open(struct rtnl_handle *rth, unsigned int groups)
+{
+	static int enabled = -1;
+	struct rtnl_stats *st = NULL;
+
+	pthread_mutex_lock(&rtnl_stats_lock);
+	if (enabled < 0) {
+		const char *env = getenv("IPROUTE2_NL_STATS");
+
+		enabled = env && *env && strcmp(env, "0");
+		if (enabled)
+			atexit(rtnl_stats_print);
+	}
+	if (enabled)
+		st = calloc(1, sizeof(*st));
+	if (st) {
+		st->proto = rth->proto;
+		st->groups = groups;
+		st->portid = rth->local.nl_pid;
+		st->opened = rtnl_stats_now();
+
+		st->next = rtnl_stats_list;
+		if (st->next)
+			st->next->pprev = &st->next;
+		st->pprev = &rtnl_stats_list;
+		rtnl_stats_list = st;
+	}
+	pthread_mutex_unlock(&rtnl_stats_lock);
+	rth->stats = st;
+}
+
+/* Add a closed handle to the summary of its protocol and groups */
+static void rtnl_stats_close(struct rtnl_stats *st)
+{
+	struct rtnl_stats *sum;
+
+	pthread_mutex_lock(&rtnl_stats_lock);
+	*st->pprev = st->next;
+	if (st->next)
+		st->next->pprev = st->pprev;
+
+	for (sum = rtnl_stats_closed; sum; sum = sum->next)
+		if (sum->proto == st->proto && sum->groups == st->groups)
+			break;
+	if (!sum) {
+		sum = calloc(1, sizeof(*sum));
+		if (!sum)
+			goto out;
+		sum->proto = st->proto;
+		sum->groups = st->groups;
+		*rtnl_stats_closed_tail = sum;
+		rtnl_stats_closed_tail = &sum->next;
+	}
+
+	sum->handles++;
+	sum->life += rtnl_stats_now() - st->opened;
+	sum->sent += st->sent;
+	sum->sent_bytes += st->sent_bytes;
+	sum->dumps += st->dumps;
+	sum->recvmsgs += st->recvmsgs;
+	sum->msgs += st->msgs;
+	sum->bytes += st->bytes;
+	sum->allocs += st->allocs;
+	sum->truncated += st->truncated;
+	sum->enobufs += st->enobufs;
+	if (st->max_buf > sum->max_buf)
+		sum->max_buf = st->max_buf;
+	sum->send_time += st->send_time;
+	sum->recv_time += st->recv_time;
+	sum->filter_time += st->filter_time;
+out:
+	pthread_mutex_unlock(&rtnl_stats_lock);
+	free(st);
+}
+
+static void rtnl_stats_sent(struct rtnl_handle *rth, double start, int len)
+{
+	struct rtnl_stats *st = rth->stats;
+
+	st->send_time += rtnl_stats_now() - start;
+	if (len > 0) {
+		st->sent++;
+		st->sent_bytes += len;
+	}
+}
+
+static void rtnl_stats_received(struct rtnl_handle *rth, double start,
+				const void *buf, int len)
+{
+	struct rtnl_stats *st = rth->stats;
+	const struct nlmsghdr *h = buf;
+
+	/* peeking at the size of the next message only costs time */
+	st->recv_time += rtnl_stats_now() - start;
+	if (!buf)
+		return;
+
+	st->recvmsgs++;
+	if (len < 0) {
+		if (errno == ENOBUFS)
+			st->enobufs++;
+		return;
+	}
+
+	st->bytes += len;
+	for (; NLMSG_OK(h, len); h = NLMSG_NEXT(h, len))
+		st->msgs++;
+}
 
 #ifdef HAVE_LIBMNL
 #include <libmnl/libmnl.h>
@@ -189,6 +410,10 @@ void rtnl_close(struct rtnl_handle *rth)
 		close(rth->fd);
 		rth->fd = -1;
 	}
+	if (rth->stats) {
+		rtnl_stats_close(rth->stats);
+		rth->stats = NULL;
+	}
 }
 
 int rtnl_open_byproto(struct rtnl_handle *rth, unsigned int subscriptions,
@@ -213,7 +438,11 @@ int rtnl_open_byproto(struct rtnl_handle *rth, unsigned int subscriptions,
 		return -1;
 	}
 
-	if (setsockopt(rth->fd, SOL_SOCKET, SO_RCVBUF,
+	/* SO_RCVBUFFORCE goes past rmem_max, but needs CAP_NET_ADMIN */
+	if ((!rcvbuf_force ||
+	     setsockopt(rth->fd, SOL_SOCKET, SO_RCVBUFFORCE,
+			&rcvbuf, sizeof(rcvbuf)) < 0) &&
+	    setsockopt(rth->fd, SOL_SOCKET, SO_RCVBUF,
 		       &rcvbuf, sizeof(rcvbuf)) < 0) {
 		perror("SO_RCVBUF");
 		return -1;
@@ -248,6 +477,7 @@ int rtnl_open_byproto(struct rtnl_handle *rth, unsigned int subscriptions,
 		return -1;
 	}
 	rth->seq = time(NULL);
+	rtnl_stats_open(rth, subscriptions);
 	return 0;
 }
 
@@ -279,7 +509,7 @@ int rtnl_nexthopdump_req(struct rtnl_handle *rth, int family,
 			return err;
 	}
 
-	return send(rth->fd, &req, sizeof(req), 0);
+	return rtnl_send(rth, &req, sizeof(req));
 }
 
 int rtnl_nexthop_bucket_dump_req(struct rtnl_handle *rth, int family,
@@ -305,7 +535,7 @@ int rtnl_nexthop_bucket_dump_req(struct rtnl_handle *rth, int family,
 			return err;
 	}
 
-	return send(rth->fd, &req, sizeof(req), 0);
+	return rtnl_send(rth, &req, sizeof(req));
 }
 
 int rtnl_addrdump_req(struct rtnl_handle *rth, int family,
@@ -331,7 +561,7 @@ int rtnl_addrdump_req(struct rtnl_handle *rth, int family,
 			return err;
 	}
 
-	return send(rth->fd, &req, sizeof(req), 0);
+	return rtnl_send(rth, &req, sizeof(req));
 }
 
 int rtnl_addrlbldump_req(struct rtnl_handle *rth, int family)
@@ -347,7 +577,7 @@ int rtnl_addrlbldump_req(struct rtnl_handle *rth, int family)
 		.ifal.ifal_family = family,
 	};
 
-	return send(rth->fd, &req, sizeof(req), 0);
+	return rtnl_send(rth, &req, sizeof(req));
 }
 
 int rtnl_routedump_req(struct rtnl_handle *rth, int family,
@@ -373,7 +603,7 @@ int rtnl_routedump_req(struct rtnl_handle *rth, int family,
 			return err;
 	}
 
-	return send(rth->fd, &req, sizeof(req), 0);
+	return rtnl_send(rth, &req, sizeof(req));
 }
 
 int rtnl_ruledump_req(struct rtnl_handle *rth, int family)
@@ -389,7 +619,7 @@ int rtnl_ruledump_req(struct rtnl_handle *rth, int family)
 		.frh.family = family
 	};
 
-	return send(rth->fd, &req, sizeof(req), 0);
+	return rtnl_send(rth, &req, sizeof(req));
 }
 
 int rtnl_neighdump_req(struct rtnl_handle *rth, int family,
@@ -415,7 +645,7 @@ int rtnl_neighdump_req(struct rtnl_handle *rth, int family,
 			return err;
 	}
 
-	return send(rth->fd, &req, sizeof(req), 0);
+	return rtnl_send(rth, &req, sizeof(req));
 }
 
 int rtnl_neightbldump_req(struct rtnl_handle *rth, int family)
@@ -431,7 +661,7 @@ int rtnl_neightbldump_req(struct rtnl_handle *rth, int family)
 		.ndtmsg.ndtm_family = family,
 	};
 
-	return send(rth->fd, &req, sizeof(req), 0);
+	return rtnl_send(rth, &req, sizeof(req));
 }
 
 int rtnl_mdbdump_req(struct rtnl_handle *rth, int family)
@@ -447,7 +677,7 @@ int rtnl_mdbdump_req(struct rtnl_handle *rth, int family)
 		.bpm.family = family,
 	};
 
-	return send(rth->fd, &req, sizeof(req), 0);
+	return rtnl_send(rth, &req, sizeof(req));
 }
 
 int rtnl_brvlandump_req(struct rtnl_handle *rth, int family, __u32 dump_flags)
@@ -466,7 +696,7 @@ int rtnl_brvlandump_req(struct rtnl_handle *rth, int family, __u32 dump_flags)
 
 	addattr32(&req.nlh, sizeof(req), BRIDGE_VLANDB_DUMP_FLAGS, dump_flags);
 
-	return send(rth->fd, &req, sizeof(req), 0);
+	return rtnl_send(rth, &req, sizeof(req));
 }
 
 int rtnl_netconfdump_req(struct rtnl_handle *rth, int family)
@@ -483,7 +713,7 @@ int rtnl_netconfdump_req(struct rtnl_handle *rth, int family)
 		.ncm.ncm_family = family,
 	};
 
-	return send(rth->fd, &req, sizeof(req), 0);
+	return rtnl_send(rth, &req, sizeof(req));
 }
 
 int rtnl_nsiddump_req_filter_fn(struct rtnl_handle *rth, int family,
@@ -509,7 +739,7 @@ int rtnl_nsiddump_req_filter_fn(struct rtnl_handle *rth, int family,
 	if (err)
 		return err;
 
-	return send(rth->fd, &req, req.nlh.nlmsg_len, 0);
+	return rtnl_send(rth, &req, req.nlh.nlmsg_len);
 }
 
 static int __rtnl_linkdump_req(struct rtnl_handle *rth, int family)
@@ -525,7 +755,7 @@ static int __rtnl_linkdump_req(struct rtnl_handle *rth, int family)
 		.ifm.ifi_family = family,
 	};
 
-	return send(rth->fd, &req, sizeof(req), 0);
+	return rtnl_send(rth, &req, sizeof(req));
 }
 
 int rtnl_linkdump_req(struct rtnl_handle *rth, int family)
@@ -557,7 +787,7 @@ int rtnl_linkdump_req_filter(struct rtnl_handle *rth, int family,
 			.ext_filter_mask = filt_mask,
 		};
 
-		return send(rth->fd, &req, sizeof(req), 0);
+		return rtnl_send(rth, &req, sizeof(req));
 	}
 
 	return __rtnl_linkdump_req(rth, family);
@@ -587,7 +817,7 @@ int rtnl_linkdump_req_filter_fn(struct rtnl_handle *rth, int family,
 		if (err)
 			return err;
 
-		return send(rth->fd, &req, req.nlh.nlmsg_len, 0);
+		return rtnl_send(rth, &req, req.nlh.nlmsg_len);
 	}
 
 	return __rtnl_linkdump_req(rth, family);
@@ -613,7 +843,7 @@ int rtnl_fdb_linkdump_req_filter_fn(struct rtnl_handle *rth,
 	if (err)
 		return err;
 
-	return send(rth->fd, &req, sizeof(req), 0);
+	return rtnl_send(rth, &req, sizeof(req));
 }
 
 int rtnl_statsdump_req_filter(struct rtnl_handle *rth, int fam, __u32 filt_mask)
@@ -632,12 +862,35 @@ int rtnl_statsdump_req_filter(struct rtnl_handle *rth, int fam, __u32 filt_mask)
 	req.ifsm.family = fam;
 	req.ifsm.filter_mask = filt_mask;
 
-	return send(rth->fd, &req, sizeof(req), 0);
+	return rtnl_send(rth, &req, sizeof(req));
 }
 
 int rtnl_send(struct rtnl_handle *rth, const void *buf, int len)
 {
-	return send(rth->fd, buf, len, 0);
+	double start;
+	int status;
+
+	if (!rth->stats)
+		return send(rth->fd, buf, len, 0);
+
+	start = rtnl_stats_now();
+	status = send(rth->fd, buf, len, 0);
+	rtnl_stats_sent(rth, start, status);
+	return status;
+}
+
+static int rtnl_sendmsg(struct rtnl_handle *rth, const struct msghdr *msg)
+{
+	double start;
+	int status;
+
+	if (!rth->stats)
+		return sendmsg(rth->fd, msg, 0);
+
+	start = rtnl_stats_now();
+	status = sendmsg(rth->fd, msg, 0);
+	rtnl_stats_sent(rth, start, status);
+	return status;
 }
 
 int rtnl_send_check(struct rtnl_handle *rth, const void *buf, int len)
@@ -646,7 +899,7 @@ int rtnl_send_check(struct rtnl_handle *rth, const void *buf, int len)
 	int status;
 	char resp[1024];
 
-	status = send(rth->fd, buf, len, 0);
+	status = rtnl_send(rth, buf, len);
 	if (status < 0)
 		return status;
 
@@ -694,7 +947,7 @@ int rtnl_dump_request(struct rtnl_handle *rth, int type, void *req, int len)
 		.msg_iovlen = 2,
 	};
 
-	return sendmsg(rth->fd, &msg, 0);
+	return rtnl_sendmsg(rth, &msg);
 }
 
 int rtnl_dump_request_n(struct rtnl_handle *rth, struct nlmsghdr *n)
@@ -715,7 +968,7 @@ int rtnl_dump_request_n(struct rtnl_handle *rth, struct nlmsghdr *n)
 	n->nlmsg_pid = 0;
 	n->nlmsg_seq = rth->dump = ++rth->seq;
 
-	return sendmsg(rth->fd, &msg, 0);
+	return rtnl_sendmsg(rth, &msg);
 }
 
 static int rtnl_dump_done(struct nlmsghdr *h)
@@ -773,12 +1026,19 @@ static void rtnl_dump_error(const struct rtnl_handle *rth,
 	}
 }
 
-static int __rtnl_recvmsg(int fd, struct msghdr *msg, int flags)
+static int __rtnl_recvmsg(struct rtnl_handle *rth, struct msghdr *msg,
+			  int flags)
 {
+	double start = 0;
 	int len;
 
 	do {
-		len = recvmsg(fd, msg, flags);
+		if (rth->stats)
+			start = rtnl_stats_now();
+		len = recvmsg(rth->fd, msg, flags);
+		if (rth->stats)
+			rtnl_stats_received(rth, start, flags & MSG_PEEK ?
+					    NULL : msg->msg_iov->iov_base, len);
 	} while (len < 0 && (errno == EINTR || errno == EAGAIN));
 
 	if (len < 0) {
@@ -795,7 +1055,8 @@ static int __rtnl_recvmsg(int fd, struct msghdr *msg, int flags)
 	return len;
 }
 
-static int rtnl_recvmsg(int fd, struct msghdr *msg, char **answer)
+static int rtnl_recvmsg(struct rtnl_handle *rth, struct msghdr *msg,
+			char **answer)
 {
 	struct iovec *iov = msg->msg_iov;
 	char *buf;
@@ -804,7 +1065,7 @@ static int rtnl_recvmsg(int fd, struct msghdr *msg, char **answer)
 	iov->iov_base = NULL;
 	iov->iov_len = 0;
 
-	len = __rtnl_recvmsg(fd, msg, MSG_PEEK | MSG_TRUNC);
+	len = __rtnl_recvmsg(rth, msg, MSG_PEEK | MSG_TRUNC);
 	if (len < 0)
 		return len;
 
@@ -816,10 +1077,16 @@ static int rtnl_recvmsg(int fd, struct msghdr *msg, char **answer)
 		return -ENOMEM;
 	}
 
+	if (rth->stats) {
+		rth->stats->allocs++;
+		if (len > rth->stats->max_buf)
+			rth->stats->max_buf = len;
+	}
+
 	iov->iov_base = buf;
 	iov->iov_len = len;
 
-	len = __rtnl_recvmsg(fd, msg, 0);
+	len = __rtnl_recvmsg(rth, msg, 0);
 	if (len < 0) {
 		free(buf);
 		return len;
@@ -847,13 +1114,16 @@ static int rtnl_dump_filter_l(struct rtnl_handle *rth,
 	char *buf;
 	int dump_intr = 0;
 
+	if (rth->stats)
+		rth->stats->dumps++;
+
 	while (1) {
 		int status;
 		const struct rtnl_dump_filter_arg *a;
 		int found_done = 0;
 		int msglen = 0;
 
-		status = rtnl_recvmsg(rth->fd, &msg, &buf);
+		status = rtnl_recvmsg(rth, &msg, &buf);
 		if (status < 0)
 			return status;
 
@@ -896,7 +1166,14 @@ static int rtnl_dump_filter_l(struct rtnl_handle *rth,
 				}
 
 				if (!rth->dump_fp) {
+					double start = 0;
+
+					if (rth->stats)
+						start = rtnl_stats_now();
 					err = a->filter(h, a->arg1);
+					if (rth->stats)
+						rth->stats->filter_time +=
+							rtnl_stats_now() - start;
 					if (err < 0) {
 						free(buf);
 						return err;
@@ -909,6 +1186,9 @@ skip_it:
 		}
 		free(buf);
 
+		if (msg.msg_flags & MSG_TRUNC && rth->stats)
+			rth->stats->truncated++;
+
 		if (found_done) {
 			if (dump_intr)
 				fprintf(stderr,
@@ -952,7 +1232,8 @@ static void rtnl_talk_error(struct nlmsghdr *h, struct nlmsgerr *err,
 
 static int __rtnl_talk_iov(struct rtnl_handle *rtnl, struct iovec *iov,
 			   size_t iovlen, struct nlmsghdr **answer,
-			   bool show_rtnl_err, nl_ext_ack_fn_t errfn)
+			   bool show_rtnl_err, nl_ext_ack_fn_t errfn,
+			   int ignore_errno)
 {
 	struct sockaddr_nl nladdr = { .nl_family = AF_NETLINK };
 	struct iovec riov;
@@ -965,6 +1246,7 @@ static int __rtnl_talk_iov(struct rtnl_handle *rtnl, struct iovec *iov,
 	unsigned int seq = 0;
 	struct nlmsghdr *h;
 	int i, status;
+	int first_err = 0, first_errno = 0;
 	char *buf;
 
 	for (i = 0; i < iovlen; i++) {
@@ -974,7 +1256,7 @@ static int __rtnl_talk_iov(struct rtnl_handle *rtnl, struct iovec *iov,
 			h->nlmsg_flags |= NLM_F_ACK;
 	}
 
-	status = sendmsg(rtnl->fd, &msg, 0);
+	status = rtnl_sendmsg(rtnl, &msg);
 	if (status < 0) {
 		perror("Cannot talk to rtnetlink");
 		return -1;
@@ -986,7 +1268,7 @@ static int __rtnl_talk_iov(struct rtnl_handle *rtnl, struct iovec *iov,
 	i = 0;
 	while (1) {
 next:
-		status = rtnl_recvmsg(rtnl->fd, &msg, &buf);
+		status = rtnl_recvmsg(rtnl, &msg, &buf);
 		++i;
 
 		if (status < 0)
@@ -1042,6 +1324,12 @@ next:
 					if (rtnl->proto != NETLINK_SOCK_DIAG &&
 					    show_rtnl_err)
 						rtnl_talk_error(h, err, errfn);
+
+					/* report the first failed request */
+					if (!first_err && -error != ignore_errno) {
+						first_err = i;
+						first_errno = -error;
+					}
 				}
 
 				if (answer)
@@ -1051,7 +1339,11 @@ next:
 
 				if (i < iovlen)
 					goto next;
-				return error ? -i : 0;
+				if (first_err) {
+					errno = first_errno;
+					return -first_err;
+				}
+				return 0;
 			}
 
 			if (answer) {
@@ -1087,7 +1379,7 @@ static int __rtnl_talk(struct rtnl_handle *rtnl, struct nlmsghdr *n,
 		.iov_len = n->nlmsg_len
 	};
 
-	return __rtnl_talk_iov(rtnl, &iov, 1, answer, show_rtnl_err, errfn);
+	return __rtnl_talk_iov(rtnl, &iov, 1, answer, show_rtnl_err, errfn, 0);
 }
 
 int rtnl_talk(struct rtnl_handle *rtnl, struct nlmsghdr *n,
@@ -1099,7 +1391,19 @@ int rtnl_talk(struct rtnl_handle *rtnl, struct nlmsghdr *n,
 int rtnl_talk_iov(struct rtnl_handle *rtnl, struct iovec *iovec, size_t iovlen,
 		  struct nlmsghdr **answer)
 {
-	return __rtnl_talk_iov(rtnl, iovec, iovlen, answer, true, NULL);
+	return __rtnl_talk_iov(rtnl, iovec, iovlen, answer, true, NULL, 0);
+}
+
+/*
+ * Like rtnl_talk_iov() without answers, but requests failing with
+ * ignore_errno do not count as failed, so the first other failure of
+ * the window is the one returned.
+ */
+int rtnl_talk_iov_ignore(struct rtnl_handle *rtnl, struct iovec *iovec,
+			 size_t iovlen, int ignore_errno)
+{
+	return __rtnl_talk_iov(rtnl, iovec, iovlen, NULL, true, NULL,
+			       ignore_errno);
 }
 
 int rtnl_talk_suppress_rtnl_errmsg(struct rtnl_handle *rtnl, struct nlmsghdr *n,
@@ -1121,134 +1425,504 @@ int rtnl_listen_all_nsid(struct rtnl_handle *rth)
 	return 0;
 }
 
+/*
+ * Multicast ingestion. rtnl_listen() takes up to RTNL_LISTEN_BATCH
+ * datagrams per recvmmsg() into slots which grow to the largest message
+ * seen, so a burst of events costs one system call and a big message
+ * is lost at most once. Overruns and truncations are reported with the
+ * time they were noticed.
+ */
+#define RTNL_LISTEN_BATCH	32
+#define RTNL_LISTEN_BUFSZ	32768
+#define RTNL_LISTEN_GROUPS	64
+
+struct rtnl_listen_counters {
+	/* by multicast group, 0 is unicast and the last one the rest */
+	unsigned long	events[RTNL_LISTEN_GROUPS + 1];
+	unsigned long	batches;
+	unsigned long	datagrams;
+	unsigned long	overruns;
+	unsigned long	truncated;
+	unsigned long	since_overrun;
+	/* SIGINT and SIGTERM are only let through while waiting */
+	sigset_t	waitmask;
+};
+
+static size_t rtnl_listen_bufsz = RTNL_LISTEN_BUFSZ;
+static volatile sig_atomic_t rtnl_listen_stop;
+
+static const char * const rtnl_group_names[] = {
+	[RTNLGRP_NONE]		= "unicast",
+	[RTNLGRP_LINK]		= "link",
+	[RTNLGRP_NOTIFY]	= "notify",
+	[RTNLGRP_NEIGH]		= "neigh",
+	[RTNLGRP_TC]		= "tc",
+	[RTNLGRP_IPV4_IFADDR]	= "ipv4-ifaddr",
+	[RTNLGRP_IPV4_MROUTE]	= "ipv4-mroute",
+	[RTNLGRP_IPV4_ROUTE]	= "ipv4-route",
+	[RTNLGRP_IPV4_RULE]	= "ipv4-rule",
+	[RTNLGRP_IPV6_IFADDR]	= "ipv6-ifaddr",
+	[RTNLGRP_IPV6_MROUTE]	= "ipv6-mroute",
+	[RTNLGRP_IPV6_ROUTE]	= "ipv6-route",
+	[RTNLGRP_IPV6_IFINFO]	= "ipv6-ifinfo",
+	[RTNLGRP_IPV6_PREFIX]	= "ipv6-prefix",
+	[RTNLGRP_IPV6_RULE]	= "ipv6-rule",
+	[RTNLGRP_ND_USEROPT]	= "nd-useropt",
+	[RTNLGRP_DCB]		= "dcb",
+	[RTNLGRP_IPV4_NETCONF]	= "ipv4-netconf",
+	[RTNLGRP_IPV6_NETCONF]	= "ipv6-netconf",
+	[RTNLGRP_MDB]		= "mdb",
+	[RTNLGRP_MPLS_ROUTE]	= "mpls-route",
+	[RTNLGRP_NSID]		= "nsid",
+	[RTNLGRP_MPLS_NETCONF]	= "mpls-netconf",
+	[RTNLGRP_IPV4_MROUTE_R]	= "ipv4-mroute-r",
+	[RTNLGRP_IPV6_MROUTE_R]	= "ipv6-mroute-r",
+	[RTNLGRP_NEXTHOP]	= "nexthop",
+	[RTNLGRP_BRVLAN]	= "brvlan",
+};
+
+static void __attribute__((format(printf, 2, 3)))
+rtnl_listen_report(struct rtnl_handle *rtnl, const char *fmt, ...)
+{
+	struct rtnl_listen_counters *c = rtnl->counters;
+	char tbuf[32];
+	struct timeval tv;
+	struct tm tm;
+	va_list ap;
+
+	gettimeofday(&tv, NULL);
+	localtime_r(&tv.tv_sec, &tm);
+	strftime(tbuf, sizeof(tbuf), "%Y-%m-%dT%H:%M:%S", &tm);
+
+	fprintf(stderr, "%s.%06ld netlink ", tbuf, (long)tv.tv_usec);
+	va_start(ap, fmt);
+	vfprintf(stderr, fmt, ap);
+	va_end(ap);
+	if (c)
+		fprintf(stderr, ", %lu events since the last loss",
+			c->since_overrun);
+	fputc('\n', stderr);
+	fflush(stderr);
+}
+
+static void rtnl_stats_received_batch(struct rtnl_handle *rth, double start,
+				      const struct mmsghdr *mmsg, int n)
+{
+	struct rtnl_stats *st = rth->stats;
+	int i;
+
+	rtnl_stats_received(rth, start, NULL, 0);
+	st->recvmsgs++;
+	if (n < 0) {
+		if (errno == ENOBUFS)
+			st->enobufs++;
+		return;
+	}
+
+	for (i = 0; i < n; i++) {
+		const struct msghdr *msg = &mmsg[i].msg_hdr;
+		const struct nlmsghdr *h = msg->msg_iov->iov_base;
+		int len = MIN(mmsg[i].msg_len, msg->msg_iov->iov_len);
+
+		if (msg->msg_flags & MSG_TRUNC)
+			st->truncated++;
+		st->bytes += len;
+		for (; NLMSG_OK(h, len); h = NLMSG_NEXT(h, len))
+			st->msgs++;
+	}
+}
+
 int rtnl_listen(struct rtnl_handle *rtnl,
 		rtnl_listen_filter_t handler,
 		void *jarg)
 {
-	int status;
-	struct nlmsghdr *h;
-	struct sockaddr_nl nladdr = { .nl_family = AF_NETLINK };
-	struct iovec iov;
-	struct msghdr msg = {
-		.msg_name = &nladdr,
-		.msg_namelen = sizeof(nladdr),
-		.msg_iov = &iov,
-		.msg_iovlen = 1,
-	};
-	char   buf[16384];
-	char   cmsgbuf[BUFSIZ];
-
-	if (rtnl->flags & RTNL_HANDLE_F_LISTEN_ALL_NSID) {
-		msg.msg_control = &cmsgbuf;
-		msg.msg_controllen = sizeof(cmsgbuf);
-	}
+	struct sockaddr_nl nladdr[RTNL_LISTEN_BATCH];
+	struct iovec iov[RTNL_LISTEN_BATCH];
+	struct mmsghdr mmsg[RTNL_LISTEN_BATCH];
+	char   cmsgbuf[RTNL_LISTEN_BATCH][CMSG_SPACE(sizeof(int)) +
+			CMSG_SPACE(sizeof(struct nl_pktinfo))] __aligned(8);
+	struct rtnl_listen_counters *c = rtnl->counters;
+	size_t bufsz = 0;
+	char   *buf = NULL;
+	double start = 0;
+	int    err = -1;
+	int    lost = 0;
+	int    i, n;
 
-	iov.iov_base = buf;
 	while (1) {
-		struct rtnl_ctrl_data ctrl;
-		struct cmsghdr *cmsg;
+		if (bufsz < rtnl_listen_bufsz) {
+			free(buf);
+			bufsz = rtnl_listen_bufsz;
+			buf = malloc(RTNL_LISTEN_BATCH * bufsz);
+			if (!buf) {
+				perror("Cannot allocate netlink receive buffer");
+				return -1;
+			}
+			if (rtnl->stats) {
+				rtnl->stats->allocs++;
+				if (bufsz > rtnl->stats->max_buf)
+					rtnl->stats->max_buf = bufsz;
+			}
+		}
 
-		iov.iov_len = sizeof(buf);
-		status = recvmsg(rtnl->fd, &msg, 0);
+		for (i = 0; i < RTNL_LISTEN_BATCH; i++) {
+			iov[i].iov_base = buf + i * bufsz;
+			iov[i].iov_len = bufsz;
+			mmsg[i].msg_hdr = (struct msghdr) {
+				.msg_name = &nladdr[i],
+				.msg_namelen = sizeof(nladdr[i]),
+				.msg_iov = &iov[i],
+				.msg_iovlen = 1,
+				.msg_control = cmsgbuf[i],
+				.msg_controllen = sizeof(cmsgbuf[i]),
+			};
+		}
 
-		if (status < 0) {
-			if (errno == EINTR || errno == EAGAIN)
+		if (c) {
+			struct pollfd pfd = { .fd = rtnl->fd, .events = POLLIN };
+
+			if (rtnl_listen_stop) {
+				err = -EINTR;
+				break;
+			}
+			if (ppoll(&pfd, 1, NULL, &c->waitmask) < 0) {
+				err = -errno;
+				break;
+			}
+		}
+
+		if (rtnl->stats)
+			start = rtnl_stats_now();
+		/* block for the first datagram only, MSG_TRUNC returns real lengths */
+		n = recvmmsg(rtnl->fd, mmsg, RTNL_LISTEN_BATCH,
+			     MSG_WAITFORONE | MSG_TRUNC, NULL);
+		if (rtnl->stats)
+			rtnl_stats_received_batch(rtnl, start, mmsg, n);
+
+		if (n < 0) {
+			if (errno == ENOBUFS) {
+				if (c) {
+					c->overruns++;
+					rtnl_listen_report(rtnl,
+						"overrun %lu: receive queue full, events lost",
+						c->overruns);
+					c->since_overrun = 0;
+				} else {
+					rtnl_listen_report(rtnl,
+						"overrun: receive queue full, events lost");
+				}
+			}
+			if ((errno == EINTR || errno == ENOBUFS) &&
+			    rtnl->flags & RTNL_HANDLE_F_LISTEN_INTR) {
+				err = -errno;
+				break;
+			}
+			if (errno == EINTR || errno == EAGAIN ||
+			    errno == ENOBUFS)
 				continue;
 			fprintf(stderr, "netlink receive error %s (%d)\n",
 				strerror(errno), errno);
-			if (errno == ENOBUFS)
-				continue;
-			return -1;
-		}
-		if (status == 0) {
-			fprintf(stderr, "EOF on netlink\n");
-			return -1;
-		}
-		if (msg.msg_namelen != sizeof(nladdr)) {
-			fprintf(stderr,
-				"Sender address length == %d\n",
-				msg.msg_namelen);
-			exit(1);
+			break;
 		}
+		if (c)
+			c->batches++;
+
+		for (i = 0; i < n; i++) {
+			struct msghdr *msg = &mmsg[i].msg_hdr;
+			int status = MIN(mmsg[i].msg_len, bufsz);
+			struct rtnl_ctrl_data ctrl = { .nsid = -1 };
+			__u32 group = 0;
+			struct cmsghdr *cmsg;
+			struct nlmsghdr *h;
+
+			if (mmsg[i].msg_len == 0) {
+				fprintf(stderr, "EOF on netlink\n");
+				goto out;
+			}
+			if (msg->msg_namelen != sizeof(nladdr[i])) {
+				fprintf(stderr,
+					"Sender address length == %d\n",
+					msg->msg_namelen);
+				exit(1);
+			}
 
-		if (rtnl->flags & RTNL_HANDLE_F_LISTEN_ALL_NSID) {
-			memset(&ctrl, 0, sizeof(ctrl));
-			ctrl.nsid = -1;
-			for (cmsg = CMSG_FIRSTHDR(&msg); cmsg;
-			     cmsg = CMSG_NXTHDR(&msg, cmsg))
-				if (cmsg->cmsg_level == SOL_NETLINK &&
-				    cmsg->cmsg_type == NETLINK_LISTEN_ALL_NSID &&
-				    cmsg->cmsg_len == CMSG_LEN(sizeof(int))) {
-					int *data = (int *)CMSG_DATA(cmsg);
-
-					ctrl.nsid = *data;
+			for (cmsg = CMSG_FIRSTHDR(msg); cmsg;
+			     cmsg = CMSG_NXTHDR(msg, cmsg)) {
+				if (cmsg->cmsg_level != SOL_NETLINK)
+					continue;
+				if (cmsg->cmsg_type == NETLINK_LISTEN_ALL_NSID &&
+				    cmsg->cmsg_len == CMSG_LEN(sizeof(int)))
+					ctrl.nsid = *(int *)CMSG_DATA(cmsg);
+				else if (cmsg->cmsg_type == NETLINK_PKTINFO &&
+					 cmsg->cmsg_len ==
+					 CMSG_LEN(sizeof(struct nl_pktinfo)))
+					group = ((struct nl_pktinfo *)
+						 CMSG_DATA(cmsg))->group;
+			}
+
+			if (msg->msg_flags & MSG_TRUNC) {
+				/* grow the slots before the next batch */
+				while (rtnl_listen_bufsz < mmsg[i].msg_len)
+					rtnl_listen_bufsz <<= 1;
+				rtnl_listen_report(rtnl,
+					"message of %u bytes truncated, event lost",
+					mmsg[i].msg_len);
+				if (c) {
+					c->truncated++;
+					c->since_overrun = 0;
 				}
-		}
+				/* deliver the rest of the batch before resyncing */
+				if (rtnl->flags & RTNL_HANDLE_F_LISTEN_INTR)
+					lost = -ENOBUFS;
+				continue;
+			}
 
-		for (h = (struct nlmsghdr *)buf; status >= sizeof(*h); ) {
-			int err;
-			int len = h->nlmsg_len;
-			int l = len - sizeof(*h);
+			if (c) {
+				c->datagrams++;
+				c->since_overrun++;
+				c->events[MIN(group, RTNL_LISTEN_GROUPS)]++;
+			}
 
-			if (l < 0 || len > status) {
-				if (msg.msg_flags & MSG_TRUNC) {
-					fprintf(stderr, "Truncated message\n");
-					return -1;
+			for (h = (struct nlmsghdr *)iov[i].iov_base;
+			     status >= sizeof(*h); ) {
+				int len = h->nlmsg_len;
+				int l = len - sizeof(*h);
+
+				if (l < 0 || len > status) {
+					fprintf(stderr,
+						"!!!malformed message: len=%d\n",
+						len);
+					exit(1);
 				}
-				fprintf(stderr,
-					"!!!malformed message: len=%d\n",
-					len);
+
+				if (rtnl->stats)
+					start = rtnl_stats_now();
+				err = handler(&ctrl, h, jarg);
+				if (rtnl->stats)
+					rtnl->stats->filter_time +=
+						rtnl_stats_now() - start;
+				if (err < 0)
+					goto out;
+
+				status -= NLMSG_ALIGN(len);
+				h = (struct nlmsghdr *)((char *)h + NLMSG_ALIGN(len));
+			}
+			if (status) {
+				fprintf(stderr, "!!!Remnant of size %d\n", status);
 				exit(1);
 			}
+		}
+		if (lost) {
+			err = lost;
+			break;
+		}
+	}
+out:
+	free(buf);
+	return err;
+}
 
-			err = handler(&ctrl, h, jarg);
-			if (err < 0)
-				return err;
+static void rtnl_listen_signal(int sig)
+{
+	rtnl_listen_stop = 1;
+}
 
-			status -= NLMSG_ALIGN(len);
-			h = (struct nlmsghdr *)((char *)h + NLMSG_ALIGN(len));
-		}
-		if (msg.msg_flags & MSG_TRUNC) {
-			fprintf(stderr, "Message truncated\n");
+static void rtnl_listen_print_counters(struct rtnl_handle *rtnl)
+{
+	struct rtnl_listen_counters *c = rtnl->counters;
+	socklen_t optlen = sizeof(int);
+	int size = 0, group;
+
+	getsockopt(rtnl->fd, SOL_SOCKET, SO_RCVBUF, &size, &optlen);
+
+	fprintf(stderr,
+		"netlink listener: %lu datagrams in %lu batches, %lu overruns, %lu truncated, rcvbuf %d\n",
+		c->datagrams, c->batches, c->overruns, c->truncated, size);
+	for (group = 0; group <= RTNL_LISTEN_GROUPS; group++) {
+		if (!c->events[group])
 			continue;
+		if (group == RTNL_LISTEN_GROUPS)
+			fprintf(stderr, "  %-16s", "other");
+		else if (group < ARRAY_SIZE(rtnl_group_names) &&
+			 rtnl_group_names[group])
+			fprintf(stderr, "  %-16s", rtnl_group_names[group]);
+		else
+			fprintf(stderr, "  group %-10d", group);
+		fprintf(stderr, " %lu\n", c->events[group]);
+	}
+}
+
+/*
+ * rtnl_listen() counting datagrams per multicast group until SIGINT or
+ * SIGTERM, then print the counters to stderr.
+ */
+int rtnl_listen_counted(struct rtnl_handle *rtnl,
+			rtnl_listen_filter_t handler,
+			void *jarg)
+{
+	struct sigaction sa = { .sa_handler = rtnl_listen_signal };
+	struct rtnl_listen_counters counters = {};
+	int flags = rtnl->flags;
+	sigset_t block, mask;
+	int one = 1;
+	int err;
+
+	if (setsockopt(rtnl->fd, SOL_NETLINK, NETLINK_PKTINFO,
+		       &one, sizeof(one)) < 0) {
+		perror("NETLINK_PKTINFO");
+		return -1;
+	}
+
+	/*
+	 * No SA_RESTART, a signal has to get us out of rtnl_listen(). The
+	 * signals stay blocked outside of ppoll() there, so one arriving
+	 * just before the wait is not left pending until the next event.
+	 */
+	sigemptyset(&sa.sa_mask);
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+	sigemptyset(&block);
+	sigaddset(&block, SIGINT);
+	sigaddset(&block, SIGTERM);
+	sigprocmask(SIG_BLOCK, &block, &mask);
+	counters.waitmask = mask;
+	sigdelset(&counters.waitmask, SIGINT);
+	sigdelset(&counters.waitmask, SIGTERM);
+
+	rtnl->counters = &counters;
+	rtnl->flags |= RTNL_HANDLE_F_LISTEN_INTR;
+	do {
+		err = rtnl_listen(rtnl, handler, jarg);
+	} while ((err == -EINTR || err == -ENOBUFS) && !rtnl_listen_stop);
+
+	sigprocmask(SIG_SETMASK, &mask, NULL);
+	rtnl_listen_print_counters(rtnl);
+	rtnl->flags = flags;
+	rtnl->counters = NULL;
+	return rtnl_listen_stop ? 0 : err;
+}
+
+/*
+ * Replay a regular file from its current position through a private
+ * mapping, leaving the position after the last message handled. Returns
+ * 1 if the file can't be mapped and has to be read instead.
+ */
+static int rtnl_from_map(FILE *rtnl, rtnl_listen_filter_t handler,
+			 void *jarg)
+{
+	long pagesz = sysconf(_SC_PAGESIZE);
+	off_t start, base, pos;
+	struct nlmsghdr *h;
+	struct stat st;
+	size_t maplen;
+	char *map;
+	int err = 0;
+
+	if (fstat(fileno(rtnl), &st) < 0 || !S_ISREG(st.st_mode))
+		return 1;
+
+	start = ftello(rtnl);
+	if (start < 0 || start >= st.st_size)
+		return 1;
+
+	base = start & ~((off_t)pagesz - 1);
+	maplen = st.st_size - base;
+	map = mmap(NULL, maplen, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+		   fileno(rtnl), base);
+	if (map == MAP_FAILED)
+		return 1;
+	madvise(map, maplen, MADV_SEQUENTIAL);
+
+	for (pos = start; pos < st.st_size; pos += NLMSG_ALIGN(h->nlmsg_len)) {
+		off_t left = st.st_size - pos;
+
+		h = (struct nlmsghdr *)(map + (pos - base));
+		if (left < sizeof(*h) || h->nlmsg_len > left) {
+			fprintf(stderr, "rtnl-from_file: truncated message\n");
+			err = -1;
+			break;
 		}
-		if (status) {
-			fprintf(stderr, "!!!Remnant of size %d\n", status);
-			exit(1);
+		if (h->nlmsg_len < sizeof(*h)) {
+			fprintf(stderr, "!!!malformed message: len=%u @%lld\n",
+				h->nlmsg_len, (long long)pos);
+			err = -1;
+			break;
+		}
+
+		err = handler(NULL, h, jarg);
+		if (err < 0) {
+			pos += NLMSG_ALIGN(h->nlmsg_len);
+			break;
 		}
+		err = 0;
 	}
+
+	munmap(map, maplen);
+	if (fseeko(rtnl, pos, SEEK_SET) < 0) {
+		perror("rtnl_from_file: fseek");
+		return -1;
+	}
+	return err;
 }
 
 int rtnl_from_file(FILE *rtnl, rtnl_listen_filter_t handler,
 		   void *jarg)
 {
-	size_t status;
-	char buf[16384];
-	struct nlmsghdr *h = (struct nlmsghdr *)buf;
+	size_t status, size = 16384;
+	struct nlmsghdr *h;
+	char *buf;
+	int err;
+
+	err = rtnl_from_map(rtnl, handler, jarg);
+	if (err <= 0)
+		return err;
+
+	buf = malloc(size);
+	if (!buf)
+		return -1;
+	h = (struct nlmsghdr *)buf;
 
 	while (1) {
-		int err, len;
+		int len;
 		int l;
 
-		status = fread(&buf, 1, sizeof(*h), rtnl);
+		status = fread(buf, 1, sizeof(*h), rtnl);
 
-		if (status == 0 && feof(rtnl))
-			return 0;
+		if (status == 0 && feof(rtnl)) {
+			err = 0;
+			break;
+		}
 		if (status != sizeof(*h)) {
 			if (ferror(rtnl))
 				perror("rtnl_from_file: fread");
 			if (feof(rtnl))
 				fprintf(stderr, "rtnl-from_file: truncated message\n");
-			return -1;
+			err = -1;
+			break;
 		}
 
 		len = h->nlmsg_len;
 		l = len - sizeof(*h);
 
-		if (l < 0 || len > sizeof(buf)) {
+		if (l < 0) {
 			fprintf(stderr, "!!!malformed message: len=%d @%lu\n",
 				len, ftell(rtnl));
-			return -1;
+			err = -1;
+			break;
+		}
+
+		if (NLMSG_ALIGN(len) > size) {
+			char *nbuf = realloc(buf, NLMSG_ALIGN(len));
+
+			if (!nbuf) {
+				fprintf(stderr, "!!!message too long: len=%d @%lu\n",
+					len, ftell(rtnl));
+				err = -1;
+				break;
+			}
+			buf = nbuf;
+			size = NLMSG_ALIGN(len);
+			h = (struct nlmsghdr *)buf;
 		}
 
 		status = fread(NLMSG_DATA(h), 1, NLMSG_ALIGN(l), rtnl);
@@ -1258,13 +1932,17 @@ int rtnl_from_file(FILE *rtnl, rtnl_listen_filter_t handler,
 				perror("rtnl_from_file: fread");
 			if (feof(rtnl))
 				fprintf(stderr, "rtnl-from_file: truncated message\n");
-			return -1;
+			err = -1;
+			break;
 		}
 
 		err = handler(NULL, h, jarg);
 		if (err < 0)
-			return err;
+			break;
 	}
+
+	free(buf);
+	return err;
 }
 
 int addattr(struct nlmsghdr *n, int maxlen, int type)
@@ -17,6 +17,7 @@
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <string.h>
+#include <errno.h>
 #include <net/if.h>
 
 #include "libnetlink.h"
@@ -389,10 +390,10 @@ void ll_drop_by_index(unsigned index)
 	free(im);
 }
 
+static int initialized;
+
 void ll_init_map(struct rtnl_handle *rth)
 {
-	static int initialized;
-
 	if (initialized)
 		return;
 
@@ -408,3 +409,81 @@ void ll_init_map(struct rtnl_handle *rth)
 
 	initialized = 1;
 }
+
+static void ll_flush_map(void)
+{
+	struct hlist_node *n, *tmp;
+	unsigned int i;
+
+	for (i = 0; i < IDXMAP_SIZE; i++) {
+		hlist_for_each_safe(n, tmp, &idx_head[i])
+			ll_entries_destroy(container_of(n, struct ll_cache,
+							idx_hash));
+	}
+	initialized = 0;
+}
+
+/*
+ * A long lived process (batch or server mode) subscribes to link
+ * notifications with ll_watch_map() and calls ll_sync_map() before
+ * using the cache, so that new, renamed and removed links are applied
+ * to it and ll_init_map() never has to dump the links again.
+ */
+static struct rtnl_handle ll_watch_rth = { .fd = -1 };
+
+int ll_watch_map(void)
+{
+	if (ll_watch_rth.fd >= 0)
+		return 0;
+	if (rtnl_open(&ll_watch_rth, RTMGRP_LINK) < 0) {
+		ll_watch_rth.fd = -1;
+		return -1;
+	}
+	return 0;
+}
+
+void ll_sync_map(void)
+{
+	static size_t buflen;
+	static char *buf;
+	struct nlmsghdr *h;
+	ssize_t len;
+	char *nbuf;
+
+	if (ll_watch_rth.fd < 0)
+		return;
+
+	for (;;) {
+		/* links with many VFs don't fit any fixed size buffer */
+		len = recv(ll_watch_rth.fd, NULL, 0,
+			   MSG_DONTWAIT | MSG_PEEK | MSG_TRUNC);
+		if (len > 0 && len > buflen) {
+			nbuf = realloc(buf, len);
+			if (nbuf) {
+				buf = nbuf;
+				buflen = len;
+			}
+		}
+		if (len >= 0)
+			len = recv(ll_watch_rth.fd, buf, buflen,
+				   MSG_DONTWAIT | MSG_TRUNC);
+		if (len < 0) {
+			if (errno == EINTR)
+				continue;
+			/* Notifications were lost, start over */
+			if (errno == ENOBUFS) {
+				ll_flush_map();
+				continue;
+			}
+			return;
+		}
+		if (len > buflen) {
+			ll_flush_map();
+			continue;
+		}
+
+		for (h = (struct nlmsghdr *)buf; NLMSG_OK(h, len);
+		     h = NLMSG_NEXT(h, len))
+			ll_remember_index(h, NULL);
+	}
+}
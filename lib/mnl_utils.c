@@ -92,6 +92,13 @@ static mnl_cb_t mnlu_cb_array[NLMSG_MIN_TYPE] = {
 	[NLMSG_OVERRUN]	= mnlu_cb_noop,
 };
 
+int mnlu_cb_run(const void *buf, size_t len, unsigned int seq,
+		unsigned int portid, mnl_cb_t cb, void *data)
+{
+	return mnl_cb_run2(buf, len, seq, portid, cb, data, mnlu_cb_array,
+			   ARRAY_SIZE(mnlu_cb_array));
+}
+
 int mnlu_socket_recv_run(struct mnl_socket *nl, unsigned int seq, void *buf, size_t buf_size,
 			 mnl_cb_t cb, void *data)
 {
@@ -102,9 +109,7 @@ int mnlu_socket_recv_run(struct mnl_socket *nl, unsigned int seq, void *buf, siz
 		err = mnl_socket_recvfrom(nl, buf, buf_size);
 		if (err <= 0)
 			break;
-		err = mnl_cb_run2(buf, err, seq, portid,
-				  cb, data, mnlu_cb_array,
-				  ARRAY_SIZE(mnlu_cb_array));
+		err = mnlu_cb_run(buf, err, seq, portid, cb, data);
 	} while (err > 0);
 
 	return err;
@@ -0,0 +1,61 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Thread pool for the addresses queued by resolve_prefetch(). Kept apart
+ * from utils.c so that only tools calling resolve_prefetch_wait() need
+ * to link with -lpthread.
+ */
+#include <pthread.h>
+#include <stdbool.h>
+
+#include "utils.h"
+
+#ifdef RESOLVE_HOSTNAMES
+/*
+ * A dump with many distinct peers does not wait for each resolver round
+ * trip in turn, the lookups run in a bounded number of threads.
+ */
+#define RESOLVE_WORKERS 16
+
+static unsigned int resolve_queue_next;
+static pthread_mutex_t resolve_queue_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void *resolve_worker(void *arg)
+{
+	unsigned int i;
+
+	do {
+		pthread_mutex_lock(&resolve_queue_lock);
+		i = resolve_queue_next++;
+		pthread_mutex_unlock(&resolve_queue_lock);
+	} while (resolve_queue_run(i));
+	return NULL;
+}
+
+void resolve_prefetch_wait(void)
+{
+	pthread_t workers[RESOLVE_WORKERS];
+	unsigned int i, nr_workers, pending;
+
+	pending = resolve_queue_pending();
+	if (!pending)
+		return;
+
+	nr_workers = pending < RESOLVE_WORKERS ? pending : RESOLVE_WORKERS;
+	resolve_queue_next = 0;
+	for (i = 0; i < nr_workers; i++)
+		if (pthread_create(&workers[i], NULL, resolve_worker, NULL))
+			break;
+	nr_workers = i;
+
+	/* Also works as the fallback if no thread could be started */
+	resolve_worker(NULL);
+	for (i = 0; i < nr_workers; i++)
+		pthread_join(workers[i], NULL);
+
+	resolve_queue_done();
+}
+#else
+void resolve_prefetch_wait(void)
+{
+}
+#endif
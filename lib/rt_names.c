@@ -18,6 +18,9 @@
 #include <sys/socket.h>
 #include <dirent.h>
 #include <limits.h>
+#include <stdbool.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
 
 #include <asm/types.h>
 #include <linux/rtnetlink.h>
@@ -29,12 +32,84 @@
 
 int numeric;
 
-struct rtnl_hash_entry {
-	struct rtnl_hash_entry	*next;
-	const char		*name;
-	unsigned int		id;
+/*
+ * Every names file (plus its optional ".d" directory of *.conf files) is
+ * compiled into one flat image holding the entries, an id hash and a name
+ * hash. When IPROUTE2_NAMES_CACHE names a directory the image is also
+ * written there and later mapped back in directly, as long as none of the
+ * source files changed. A database is only read once a name is needed
+ * which is not one of the built in defaults.
+ */
+#define NAMES_DB_MAGIC		"IPR2NDB1"
+
+struct names_db_hdr {
+	char	magic[8];
+	__u32	size;
+	__u32	nsrc;
+	__u32	nent;
+	__u32	nbuckets;
+	__u32	src_off;
+	__u32	ent_off;
+	__u32	id_hash_off;
+	__u32	name_hash_off;
+};
+
+/* Source file state at compile time, size is -1 for a missing file */
+struct names_db_src {
+	__u32	path;
+	__u32	pad;
+	__s64	mtime_sec;
+	__s64	mtime_nsec;
+	__s64	size;
+	__u64	ino;
+};
+
+/* Chains hold entry index + 1 and only point to earlier entries */
+struct names_db_ent {
+	__u32	id;
+	__u32	name;
+	__u32	id_next;
+	__u32	name_next;
+};
+
+struct names_db {
+	const char		*file;
+	const char		*dir;
+	unsigned int		max_id;
+	const char * const	*dflt;
+	unsigned int		dflt_len;
+	int			loaded;
+	char			*img;
+	size_t			img_len;
+	bool			mapped;
+};
+
+struct names_db_builder {
+	struct names_db_ent	*ent;
+	unsigned int		nent;
+	unsigned int		ent_max;
+	struct names_db_src	*src;
+	unsigned int		nsrc;
+	unsigned int		src_max;
+	char			*str;
+	size_t			str_len;
+	size_t			str_max;
 };
 
+#define NAMES_DB_HDR(db)	((const struct names_db_hdr *)(db)->img)
+#define NAMES_DB_PTR(db, off)	((void *)((db)->img + (off)))
+
+static __u32 names_db_hash(const char *name)
+{
+	__u32 hash = 2166136261u;
+
+	while (*name) {
+		hash ^= (unsigned char)*name++;
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
 static int fread_id_name(FILE *fp, int *id, char *namebuf)
 {
 	char buf[NAME_MAX_LEN];
@@ -60,66 +135,415 @@ static int fread_id_name(FILE *fp, int *id, char *namebuf)
 	return 0;
 }
 
-static void
-rtnl_hash_initialize(const char *file, struct rtnl_hash_entry **hash, int size)
+static void *names_db_grow(void *arr, unsigned int *max, size_t size)
+{
+	unsigned int n = *max ? *max * 2 : 64;
+
+	arr = realloc(arr, n * size);
+	if (!arr) {
+		fprintf(stderr, "Cannot allocate names database\n");
+		exit(1);
+	}
+	*max = n;
+	return arr;
+}
+
+static __u32 names_db_add_str(struct names_db_builder *b, const char *s)
+{
+	size_t len = strlen(s) + 1;
+	__u32 off = b->str_len;
+
+	if (b->str_len + len > b->str_max) {
+		b->str_max = (b->str_len + len) * 2;
+		b->str = realloc(b->str, b->str_max);
+		if (!b->str) {
+			fprintf(stderr, "Cannot allocate names database\n");
+			exit(1);
+		}
+	}
+	memcpy(b->str + off, s, len);
+	b->str_len += len;
+	return off;
+}
+
+static void names_db_add_src(struct names_db_builder *b, const char *path,
+			     const struct stat *st)
+{
+	struct names_db_src *src;
+
+	if (b->nsrc == b->src_max)
+		b->src = names_db_grow(b->src, &b->src_max, sizeof(*src));
+
+	src = &b->src[b->nsrc++];
+	memset(src, 0, sizeof(*src));
+	src->path = names_db_add_str(b, path);
+	src->size = -1;
+	if (st) {
+		src->mtime_sec = st->st_mtim.tv_sec;
+		src->mtime_nsec = st->st_mtim.tv_nsec;
+		src->size = st->st_size;
+		src->ino = st->st_ino;
+	}
+}
+
+static void names_db_add(struct names_db_builder *b, unsigned int id,
+			 const char *name)
+{
+	struct names_db_ent *ent;
+
+	if (b->nent == b->ent_max)
+		b->ent = names_db_grow(b->ent, &b->ent_max, sizeof(*ent));
+
+	ent = &b->ent[b->nent++];
+	ent->id = id;
+	ent->name = names_db_add_str(b, name);
+}
+
+static void names_db_parse(struct names_db *db, struct names_db_builder *b,
+			   const char *file)
 {
-	struct rtnl_hash_entry *entry;
+	char namebuf[NAME_MAX_LEN] = {0};
+	struct stat st;
 	FILE *fp;
 	int id;
-	char namebuf[NAME_MAX_LEN] = {0};
 	int ret;
 
 	fp = fopen(file, "r");
-	if (!fp)
+	if (!fp || fstat(fileno(fp), &st)) {
+		names_db_add_src(b, file, NULL);
+		if (fp)
+			fclose(fp);
 		return;
+	}
+	names_db_add_src(b, file, &st);
 
 	while ((ret = fread_id_name(fp, &id, &namebuf[0]))) {
 		if (ret == -1) {
 			fprintf(stderr, "Database %s is corrupted at %s\n",
 					file, namebuf);
-			fclose(fp);
-			return;
+			break;
 		}
 
-		if (id < 0)
+		if (id < 0 || (db->max_id && id > db->max_id))
 			continue;
 
-		entry = malloc(sizeof(*entry));
-		entry->id   = id;
-		entry->name = strdup(namebuf);
-		entry->next = hash[id & (size - 1)];
-		hash[id & (size - 1)] = entry;
+		names_db_add(b, id, namebuf);
 	}
 	fclose(fp);
 }
 
-static void rtnl_tab_initialize(const char *file, char **tab, int size)
+static void names_db_parse_dir(struct names_db *db, struct names_db_builder *b)
 {
-	FILE *fp;
-	int id;
-	char namebuf[NAME_MAX_LEN] = {0};
-	int ret;
+	char dir[PATH_MAX];
+	struct dirent *de;
+	struct stat st;
+	DIR *d;
 
-	fp = fopen(file, "r");
-	if (!fp)
+	snprintf(dir, sizeof(dir), CONFDIR "/%s", db->dir);
+	d = opendir(dir);
+	if (!d || fstat(dirfd(d), &st)) {
+		names_db_add_src(b, dir, NULL);
+		if (d)
+			closedir(d);
 		return;
+	}
+	/* the directory mtime catches files being added or removed */
+	names_db_add_src(b, dir, &st);
 
-	while ((ret = fread_id_name(fp, &id, &namebuf[0]))) {
-		if (ret == -1) {
-			fprintf(stderr, "Database %s is corrupted at %s\n",
-					file, namebuf);
-			fclose(fp);
-			return;
-		}
-		if (id < 0 || id > size)
+	while ((de = readdir(d)) != NULL) {
+		char path[PATH_MAX];
+		size_t len;
+
+		if (*de->d_name == '.')
+			continue;
+
+		/* only consider filenames ending in '.conf' */
+		len = strlen(de->d_name);
+		if (len <= 5)
+			continue;
+		if (strcmp(de->d_name + len - 5, ".conf"))
 			continue;
 
-		tab[id] = strdup(namebuf);
+		snprintf(path, sizeof(path), CONFDIR "/%s/%s",
+			 db->dir, de->d_name);
+		names_db_parse(db, b, path);
 	}
-	fclose(fp);
+	closedir(d);
 }
 
-static char *rtnl_rtprot_tab[256] = {
+/* Lay out the image and link the hash chains, later entries win */
+static void names_db_compile(struct names_db *db, struct names_db_builder *b)
+{
+	struct names_db_hdr *hdr;
+	struct names_db_ent *ent;
+	__u32 *id_hash, *name_hash;
+	unsigned int nbuckets = 16;
+	size_t len;
+	__u32 str_off;
+	unsigned int i;
+
+	while (nbuckets < b->nent)
+		nbuckets <<= 1;
+
+	len = sizeof(*hdr);
+	len += b->nsrc * sizeof(struct names_db_src);
+	len += b->nent * sizeof(struct names_db_ent);
+	len += 2 * nbuckets * sizeof(__u32);
+	str_off = len;
+	len += b->str_len;
+
+	hdr = calloc(1, len);
+	if (!hdr) {
+		fprintf(stderr, "Cannot allocate names database\n");
+		exit(1);
+	}
+
+	memcpy(hdr->magic, NAMES_DB_MAGIC, sizeof(hdr->magic));
+	hdr->size = len;
+	hdr->nsrc = b->nsrc;
+	hdr->nent = b->nent;
+	hdr->nbuckets = nbuckets;
+	hdr->src_off = sizeof(*hdr);
+	hdr->ent_off = hdr->src_off + b->nsrc * sizeof(struct names_db_src);
+	hdr->id_hash_off = hdr->ent_off + b->nent * sizeof(struct names_db_ent);
+	hdr->name_hash_off = hdr->id_hash_off + nbuckets * sizeof(__u32);
+
+	memcpy((char *)hdr + hdr->src_off, b->src,
+	       b->nsrc * sizeof(struct names_db_src));
+	memcpy((char *)hdr + str_off, b->str, b->str_len);
+
+	ent = (struct names_db_ent *)((char *)hdr + hdr->ent_off);
+	id_hash = (__u32 *)((char *)hdr + hdr->id_hash_off);
+	name_hash = (__u32 *)((char *)hdr + hdr->name_hash_off);
+
+	for (i = 0; i < hdr->nsrc; i++) {
+		struct names_db_src *src;
+
+		src = (struct names_db_src *)((char *)hdr + hdr->src_off) + i;
+		src->path += str_off;
+	}
+
+	for (i = 0; i < b->nent; i++) {
+		const char *name = b->str + b->ent[i].name;
+		unsigned int hid = b->ent[i].id & (nbuckets - 1);
+		unsigned int hname = names_db_hash(name) & (nbuckets - 1);
+
+		ent[i].id = b->ent[i].id;
+		ent[i].name = b->ent[i].name + str_off;
+		ent[i].id_next = id_hash[hid];
+		ent[i].name_next = name_hash[hname];
+		id_hash[hid] = i + 1;
+		name_hash[hname] = i + 1;
+	}
+
+	free(b->ent);
+	free(b->src);
+	free(b->str);
+
+	db->img = (char *)hdr;
+	db->img_len = len;
+	db->mapped = false;
+}
+
+static bool names_db_cache_path(const struct names_db *db, char *buf,
+				size_t len)
+{
+	const char *dir = getenv("IPROUTE2_NAMES_CACHE");
+
+	if (!dir || !*dir)
+		return false;
+	snprintf(buf, len, "%s/%s.db", dir, db->file ? : db->dir);
+	return true;
+}
+
+/* Only trust a cached image that is well formed and still up to date */
+static bool names_db_valid(const char *img, size_t len)
+{
+	const struct names_db_hdr *hdr = (const void *)img;
+	const struct names_db_src *src;
+	const struct names_db_ent *ent;
+	const __u32 *hash;
+	unsigned int i;
+
+	if (len < sizeof(*hdr) || img[len - 1] ||
+	    memcmp(hdr->magic, NAMES_DB_MAGIC, sizeof(hdr->magic)) ||
+	    hdr->size != len ||
+	    hdr->nbuckets == 0 || (hdr->nbuckets & (hdr->nbuckets - 1)) ||
+	    hdr->src_off != sizeof(*hdr) ||
+	    hdr->ent_off != hdr->src_off + (size_t)hdr->nsrc * sizeof(*src) ||
+	    hdr->id_hash_off != hdr->ent_off + (size_t)hdr->nent * sizeof(*ent) ||
+	    hdr->name_hash_off != hdr->id_hash_off +
+				  (size_t)hdr->nbuckets * sizeof(__u32) ||
+	    hdr->name_hash_off + (size_t)hdr->nbuckets * sizeof(__u32) > len)
+		return false;
+
+	ent = (const void *)(img + hdr->ent_off);
+	for (i = 0; i < hdr->nent; i++) {
+		if (ent[i].name >= len || ent[i].id_next > i ||
+		    ent[i].name_next > i)
+			return false;
+	}
+
+	hash = (const void *)(img + hdr->id_hash_off);
+	for (i = 0; i < 2 * hdr->nbuckets; i++) {
+		if (hash[i] > hdr->nent)
+			return false;
+	}
+
+	src = (const void *)(img + hdr->src_off);
+	for (i = 0; i < hdr->nsrc; i++) {
+		struct stat st;
+
+		if (src[i].path >= len)
+			return false;
+		if (stat(img + src[i].path, &st)) {
+			if (src[i].size != -1)
+				return false;
+			continue;
+		}
+		if (src[i].size != st.st_size ||
+		    src[i].ino != st.st_ino ||
+		    src[i].mtime_sec != st.st_mtim.tv_sec ||
+		    src[i].mtime_nsec != st.st_mtim.tv_nsec)
+			return false;
+	}
+	return true;
+}
+
+static bool names_db_cache_load(struct names_db *db, const char *path)
+{
+	struct stat st;
+	void *img;
+	int fd;
+
+	fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return false;
+	if (fstat(fd, &st) || st.st_size < sizeof(struct names_db_hdr)) {
+		close(fd);
+		return false;
+	}
+
+	img = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (img == MAP_FAILED)
+		return false;
+
+	if (!names_db_valid(img, st.st_size)) {
+		munmap(img, st.st_size);
+		return false;
+	}
+
+	db->img = img;
+	db->img_len = st.st_size;
+	db->mapped = true;
+	return true;
+}
+
+static void names_db_cache_save(const struct names_db *db, const char *path)
+{
+	char tmp[PATH_MAX + 16];
+	bool ok;
+	int fd;
+
+	/* a fresh file in the cache directory, rename() replaces atomically */
+	snprintf(tmp, sizeof(tmp), "%s.XXXXXX", path);
+	fd = mkostemp(tmp, O_CLOEXEC);
+	if (fd < 0)
+		return;
+
+	ok = fchmod(fd, 0644) == 0 &&
+	     write(fd, db->img, db->img_len) == db->img_len;
+	if (close(fd) || !ok || rename(tmp, path))
+		unlink(tmp);
+}
+
+static void names_db_load(struct names_db *db)
+{
+	struct names_db_builder b = {};
+	char cache[PATH_MAX];
+	bool use_cache;
+	unsigned int i;
+
+	db->loaded = 1;
+
+	use_cache = names_db_cache_path(db, cache, sizeof(cache));
+	if (use_cache && names_db_cache_load(db, cache))
+		return;
+
+	for (i = 0; i < db->dflt_len; i++) {
+		if (db->dflt[i])
+			names_db_add(&b, i, db->dflt[i]);
+	}
+	if (db->file) {
+		char path[PATH_MAX];
+
+		snprintf(path, sizeof(path), CONFDIR "/%s", db->file);
+		names_db_parse(db, &b, path);
+	}
+	if (db->dir)
+		names_db_parse_dir(db, &b);
+
+	names_db_compile(db, &b);
+
+	if (use_cache)
+		names_db_cache_save(db, cache);
+}
+
+static const char *names_db_n2a(struct names_db *db, __u32 id)
+{
+	const struct names_db_ent *ent;
+	__u32 idx;
+
+	/* the built in names do not need the files */
+	if (!db->loaded && id < db->dflt_len && db->dflt[id])
+		return db->dflt[id];
+
+	if (!db->loaded)
+		names_db_load(db);
+
+	ent = NAMES_DB_PTR(db, NAMES_DB_HDR(db)->ent_off);
+	idx = ((__u32 *)NAMES_DB_PTR(db, NAMES_DB_HDR(db)->id_hash_off))
+		[id & (NAMES_DB_HDR(db)->nbuckets - 1)];
+	for (; idx; idx = ent[idx - 1].id_next) {
+		if (ent[idx - 1].id == id)
+			return NAMES_DB_PTR(db, ent[idx - 1].name);
+	}
+	return NULL;
+}
+
+static int names_db_a2n(struct names_db *db, __u32 *id, const char *arg)
+{
+	const struct names_db_ent *ent;
+	__u32 idx;
+
+	if (!db->loaded)
+		names_db_load(db);
+
+	ent = NAMES_DB_PTR(db, NAMES_DB_HDR(db)->ent_off);
+	idx = ((__u32 *)NAMES_DB_PTR(db, NAMES_DB_HDR(db)->name_hash_off))
+		[names_db_hash(arg) & (NAMES_DB_HDR(db)->nbuckets - 1)];
+	for (; idx; idx = ent[idx - 1].name_next) {
+		if (strcmp(NAMES_DB_PTR(db, ent[idx - 1].name), arg) == 0) {
+			*id = ent[idx - 1].id;
+			return 0;
+		}
+	}
+	return -1;
+}
+
+/* Only a complete number skips the database, "6to4" may be a name */
+static bool names_is_number(const char *arg)
+{
+	char *end;
+
+	if (*arg < '0' || *arg > '9')
+		return false;
+	strtoul(arg, &end, 0);
+	return *end == '\0';
+}
+
+static const char * const rtnl_rtprot_dflt[256] = {
 	[RTPROT_UNSPEC]	    = "unspec",
 	[RTPROT_REDIRECT]   = "redirect",
 	[RTPROT_KERNEL]	    = "kernel",
@@ -144,83 +568,36 @@ static char *rtnl_rtprot_tab[256] = {
 	[RTPROT_EIGRP]	    = "eigrp",
 };
 
-
-static int rtnl_rtprot_init;
-
-static void rtnl_rtprot_initialize(void)
-{
-	struct dirent *de;
-	DIR *d;
-
-	rtnl_rtprot_init = 1;
-	rtnl_tab_initialize(CONFDIR "/rt_protos",
-			    rtnl_rtprot_tab, 256);
-
-	d = opendir(CONFDIR "/rt_protos.d");
-	if (!d)
-		return;
-
-	while ((de = readdir(d)) != NULL) {
-		char path[PATH_MAX];
-		size_t len;
-
-		if (*de->d_name == '.')
-			continue;
-
-		/* only consider filenames ending in '.conf' */
-		len = strlen(de->d_name);
-		if (len <= 5)
-			continue;
-		if (strcmp(de->d_name + len - 5, ".conf"))
-			continue;
-
-		snprintf(path, sizeof(path), CONFDIR "/rt_protos.d/%s",
-			 de->d_name);
-		rtnl_tab_initialize(path, rtnl_rtprot_tab, 256);
-	}
-	closedir(d);
-}
+static struct names_db rtnl_rtprot_db = {
+	.file = "rt_protos",
+	.dir = "rt_protos.d",
+	.max_id = 255,
+	.dflt = rtnl_rtprot_dflt,
+	.dflt_len = ARRAY_SIZE(rtnl_rtprot_dflt),
+};
 
 const char *rtnl_rtprot_n2a(int id, char *buf, int len)
 {
+	const char *name;
+
 	if (id < 0 || id >= 256 || numeric) {
 		snprintf(buf, len, "%u", id);
 		return buf;
 	}
-	if (!rtnl_rtprot_tab[id]) {
-		if (!rtnl_rtprot_init)
-			rtnl_rtprot_initialize();
-	}
-	if (rtnl_rtprot_tab[id])
-		return rtnl_rtprot_tab[id];
+	name = names_db_n2a(&rtnl_rtprot_db, id);
+	if (name)
+		return name;
 	snprintf(buf, len, "%u", id);
 	return buf;
 }
 
 int rtnl_rtprot_a2n(__u32 *id, const char *arg)
 {
-	static char *cache;
-	static unsigned long res;
+	unsigned long res;
 	char *end;
-	int i;
 
-	if (cache && strcmp(cache, arg) == 0) {
-		*id = res;
+	if (!names_is_number(arg) && names_db_a2n(&rtnl_rtprot_db, id, arg) == 0)
 		return 0;
-	}
-
-	if (!rtnl_rtprot_init)
-		rtnl_rtprot_initialize();
-
-	for (i = 0; i < 256; i++) {
-		if (rtnl_rtprot_tab[i] &&
-		    strcmp(rtnl_rtprot_tab[i], arg) == 0) {
-			cache = rtnl_rtprot_tab[i];
-			res = i;
-			*id = res;
-			return 0;
-		}
-	}
 
 	res = strtoul(arg, &end, 0);
 	if (!end || end == arg || *end || res > 255)
@@ -230,7 +607,7 @@ int rtnl_rtprot_a2n(__u32 *id, const char *arg)
 }
 
 
-static char *rtnl_rtscope_tab[256] = {
+static const char * const rtnl_rtscope_dflt[256] = {
 	[RT_SCOPE_UNIVERSE]	= "global",
 	[RT_SCOPE_NOWHERE]	= "nowhere",
 	[RT_SCOPE_HOST]		= "host",
@@ -238,29 +615,25 @@ static char *rtnl_rtscope_tab[256] = {
 	[RT_SCOPE_SITE]		= "site",
 };
 
-static int rtnl_rtscope_init;
-
-static void rtnl_rtscope_initialize(void)
-{
-	rtnl_rtscope_init = 1;
-	rtnl_tab_initialize(CONFDIR "/rt_scopes",
-			    rtnl_rtscope_tab, 256);
-}
+static struct names_db rtnl_rtscope_db = {
+	.file = "rt_scopes",
+	.max_id = 255,
+	.dflt = rtnl_rtscope_dflt,
+	.dflt_len = ARRAY_SIZE(rtnl_rtscope_dflt),
+};
 
 const char *rtnl_rtscope_n2a(int id, char *buf, int len)
 {
+	const char *name;
+
 	if (id < 0 || id >= 256 || numeric) {
 		snprintf(buf, len, "%d", id);
 		return buf;
 	}
 
-	if (!rtnl_rtscope_tab[id]) {
-		if (!rtnl_rtscope_init)
-			rtnl_rtscope_initialize();
-	}
-
-	if (rtnl_rtscope_tab[id])
-		return rtnl_rtscope_tab[id];
+	name = names_db_n2a(&rtnl_rtscope_db, id);
+	if (name)
+		return name;
 
 	snprintf(buf, len, "%d", id);
 	return buf;
@@ -268,28 +641,11 @@ const char *rtnl_rtscope_n2a(int id, char *buf, int len)
 
 int rtnl_rtscope_a2n(__u32 *id, const char *arg)
 {
-	static const char *cache;
-	static unsigned long res;
+	unsigned long res;
 	char *end;
-	int i;
 
-	if (cache && strcmp(cache, arg) == 0) {
-		*id = res;
+	if (!names_is_number(arg) && names_db_a2n(&rtnl_rtscope_db, id, arg) == 0)
 		return 0;
-	}
-
-	if (!rtnl_rtscope_init)
-		rtnl_rtscope_initialize();
-
-	for (i = 0; i < 256; i++) {
-		if (rtnl_rtscope_tab[i] &&
-		    strcmp(rtnl_rtscope_tab[i], arg) == 0) {
-			cache = rtnl_rtscope_tab[i];
-			res = i;
-			*id = res;
-			return 0;
-		}
-	}
 
 	res = strtoul(arg, &end, 0);
 	if (!end || end == arg || *end || res > 255)
@@ -299,31 +655,28 @@ int rtnl_rtscope_a2n(__u32 *id, const char *arg)
 }
 
 
-static char *rtnl_rtrealm_tab[256] = {
+static const char * const rtnl_rtrealm_dflt[] = {
 	"unknown",
 };
 
-static int rtnl_rtrealm_init;
-
-static void rtnl_rtrealm_initialize(void)
-{
-	rtnl_rtrealm_init = 1;
-	rtnl_tab_initialize(CONFDIR "/rt_realms",
-			    rtnl_rtrealm_tab, 256);
-}
+static struct names_db rtnl_rtrealm_db = {
+	.file = "rt_realms",
+	.max_id = 255,
+	.dflt = rtnl_rtrealm_dflt,
+	.dflt_len = ARRAY_SIZE(rtnl_rtrealm_dflt),
+};
 
 const char *rtnl_rtrealm_n2a(int id, char *buf, int len)
 {
+	const char *name;
+
 	if (id < 0 || id >= 256 || numeric) {
 		snprintf(buf, len, "%d", id);
 		return buf;
 	}
-	if (!rtnl_rtrealm_tab[id]) {
-		if (!rtnl_rtrealm_init)
-			rtnl_rtrealm_initialize();
-	}
-	if (rtnl_rtrealm_tab[id])
-		return rtnl_rtrealm_tab[id];
+	name = names_db_n2a(&rtnl_rtrealm_db, id);
+	if (name)
+		return name;
 	snprintf(buf, len, "%d", id);
 	return buf;
 }
@@ -331,28 +684,11 @@ const char *rtnl_rtrealm_n2a(int id, char *buf, int len)
 
 int rtnl_rtrealm_a2n(__u32 *id, const char *arg)
 {
-	static char *cache;
-	static unsigned long res;
+	unsigned long res;
 	char *end;
-	int i;
 
-	if (cache && strcmp(cache, arg) == 0) {
-		*id = res;
+	if (!names_is_number(arg) && names_db_a2n(&rtnl_rtrealm_db, id, arg) == 0)
 		return 0;
-	}
-
-	if (!rtnl_rtrealm_init)
-		rtnl_rtrealm_initialize();
-
-	for (i = 0; i < 256; i++) {
-		if (rtnl_rtrealm_tab[i] &&
-		    strcmp(rtnl_rtrealm_tab[i], arg) == 0) {
-			cache = rtnl_rtrealm_tab[i];
-			res = i;
-			*id = res;
-			return 0;
-		}
-	}
 
 	res = strtoul(arg, &end, 0);
 	if (!end || end == arg || *end || res > 255)
@@ -362,99 +698,39 @@ int rtnl_rtrealm_a2n(__u32 *id, const char *arg)
 }
 
 
-static struct rtnl_hash_entry dflt_table_entry  = { .name = "default" };
-static struct rtnl_hash_entry main_table_entry  = { .name = "main" };
-static struct rtnl_hash_entry local_table_entry = { .name = "local" };
-
-static struct rtnl_hash_entry *rtnl_rttable_hash[256] = {
-	[RT_TABLE_DEFAULT] = &dflt_table_entry,
-	[RT_TABLE_MAIN]    = &main_table_entry,
-	[RT_TABLE_LOCAL]   = &local_table_entry,
+static const char * const rtnl_rttable_dflt[256] = {
+	[RT_TABLE_DEFAULT] = "default",
+	[RT_TABLE_MAIN]    = "main",
+	[RT_TABLE_LOCAL]   = "local",
 };
 
-static int rtnl_rttable_init;
-
-static void rtnl_rttable_initialize(void)
-{
-	struct dirent *de;
-	DIR *d;
-	int i;
-
-	rtnl_rttable_init = 1;
-	for (i = 0; i < 256; i++) {
-		if (rtnl_rttable_hash[i])
-			rtnl_rttable_hash[i]->id = i;
-	}
-	rtnl_hash_initialize(CONFDIR "/rt_tables",
-			     rtnl_rttable_hash, 256);
-
-	d = opendir(CONFDIR "/rt_tables.d");
-	if (!d)
-		return;
-
-	while ((de = readdir(d)) != NULL) {
-		char path[PATH_MAX];
-		size_t len;
-
-		if (*de->d_name == '.')
-			continue;
-
-		/* only consider filenames ending in '.conf' */
-		len = strlen(de->d_name);
-		if (len <= 5)
-			continue;
-		if (strcmp(de->d_name + len - 5, ".conf"))
-			continue;
-
-		snprintf(path, sizeof(path),
-			 CONFDIR "/rt_tables.d/%s", de->d_name);
-		rtnl_hash_initialize(path, rtnl_rttable_hash, 256);
-	}
-	closedir(d);
-}
+static struct names_db rtnl_rttable_db = {
+	.file = "rt_tables",
+	.dir = "rt_tables.d",
+	.dflt = rtnl_rttable_dflt,
+	.dflt_len = ARRAY_SIZE(rtnl_rttable_dflt),
+};
 
 const char *rtnl_rttable_n2a(__u32 id, char *buf, int len)
 {
-	struct rtnl_hash_entry *entry;
+	const char *name;
 
-	if (!rtnl_rttable_init)
-		rtnl_rttable_initialize();
-	entry = rtnl_rttable_hash[id & 255];
-	while (entry && entry->id != id)
-		entry = entry->next;
-	if (!numeric && entry)
-		return entry->name;
+	if (!numeric) {
+		name = names_db_n2a(&rtnl_rttable_db, id);
+		if (name)
+			return name;
+	}
 	snprintf(buf, len, "%u", id);
 	return buf;
 }
 
 int rtnl_rttable_a2n(__u32 *id, const char *arg)
 {
-	static const char *cache;
-	static unsigned long res;
-	struct rtnl_hash_entry *entry;
-	char *end;
 	unsigned long i;
+	char *end;
 
-	if (cache && strcmp(cache, arg) == 0) {
-		*id = res;
+	if (!names_is_number(arg) && names_db_a2n(&rtnl_rttable_db, id, arg) == 0)
 		return 0;
-	}
-
-	if (!rtnl_rttable_init)
-		rtnl_rttable_initialize();
-
-	for (i = 0; i < 256; i++) {
-		entry = rtnl_rttable_hash[i];
-		while (entry && strcmp(entry->name, arg))
-			entry = entry->next;
-		if (entry) {
-			cache = entry->name;
-			res = entry->id;
-			*id = res;
-			return 0;
-		}
-	}
 
 	i = strtoul(arg, &end, 0);
 	if (!end || end == arg || *end || i > RT_TABLE_MAX)
@@ -464,18 +740,16 @@ int rtnl_rttable_a2n(__u32 *id, const char *arg)
 }
 
 
-static char *rtnl_rtdsfield_tab[256] = {
+static const char * const rtnl_rtdsfield_dflt[] = {
 	"0",
 };
 
-static int rtnl_rtdsfield_init;
-
-static void rtnl_rtdsfield_initialize(void)
-{
-	rtnl_rtdsfield_init = 1;
-	rtnl_tab_initialize(CONFDIR "/rt_dsfield",
-			    rtnl_rtdsfield_tab, 256);
-}
+static struct names_db rtnl_rtdsfield_db = {
+	.file = "rt_dsfield",
+	.max_id = 255,
+	.dflt = rtnl_rtdsfield_dflt,
+	.dflt_len = ARRAY_SIZE(rtnl_rtdsfield_dflt),
+};
 
 const char *rtnl_dsfield_n2a(int id, char *buf, int len)
 {
@@ -498,38 +772,18 @@ const char *rtnl_dsfield_get_name(int id)
 {
 	if (id < 0 || id >= 256)
 		return NULL;
-	if (!rtnl_rtdsfield_tab[id]) {
-		if (!rtnl_rtdsfield_init)
-			rtnl_rtdsfield_initialize();
-	}
-	return rtnl_rtdsfield_tab[id];
+	return names_db_n2a(&rtnl_rtdsfield_db, id);
 }
 
 
 int rtnl_dsfield_a2n(__u32 *id, const char *arg)
 {
-	static char *cache;
-	static unsigned long res;
+	unsigned long res;
 	char *end;
-	int i;
 
-	if (cache && strcmp(cache, arg) == 0) {
-		*id = res;
+	/* names such as "EF" are valid hex numbers, so look them up first */
+	if (names_db_a2n(&rtnl_rtdsfield_db, id, arg) == 0)
 		return 0;
-	}
-
-	if (!rtnl_rtdsfield_init)
-		rtnl_rtdsfield_initialize();
-
-	for (i = 0; i < 256; i++) {
-		if (rtnl_rtdsfield_tab[i] &&
-		    strcmp(rtnl_rtdsfield_tab[i], arg) == 0) {
-			cache = rtnl_rtdsfield_tab[i];
-			res = i;
-			*id = res;
-			return 0;
-		}
-	}
 
 	res = strtoul(arg, &end, 16);
 	if (!end || end == arg || *end || res > 255)
@@ -539,51 +793,27 @@ int rtnl_dsfield_a2n(__u32 *id, const char *arg)
 }
 
 
-static struct rtnl_hash_entry dflt_group_entry = {
-	.id = 0, .name = "default"
+static const char * const rtnl_group_dflt[] = {
+	[0] = "default",
 };
 
-static struct rtnl_hash_entry *rtnl_group_hash[256] = {
-	[0] = &dflt_group_entry,
+static struct names_db rtnl_group_db = {
+	.file = "group",
+	.dflt = rtnl_group_dflt,
+	.dflt_len = ARRAY_SIZE(rtnl_group_dflt),
 };
 
-static int rtnl_group_init;
-
-static void rtnl_group_initialize(void)
-{
-	rtnl_group_init = 1;
-	rtnl_hash_initialize(CONFDIR "/group",
-			     rtnl_group_hash, 256);
-}
-
 int rtnl_group_a2n(int *id, const char *arg)
 {
-	static const char *cache;
-	static unsigned long res;
-	struct rtnl_hash_entry *entry;
+	__u32 res;
 	char *end;
 	int i;
 
-	if (cache && strcmp(cache, arg) == 0) {
+	if (!names_is_number(arg) && names_db_a2n(&rtnl_group_db, &res, arg) == 0) {
 		*id = res;
 		return 0;
 	}
 
-	if (!rtnl_group_init)
-		rtnl_group_initialize();
-
-	for (i = 0; i < 256; i++) {
-		entry = rtnl_group_hash[i];
-		while (entry && strcmp(entry->name, arg))
-			entry = entry->next;
-		if (entry) {
-			cache = entry->name;
-			res = entry->id;
-			*id = res;
-			return 0;
-		}
-	}
-
 	i = strtol(arg, &end, 0);
 	if (!end || end == arg || *end || i < 0)
 		return -1;
@@ -593,27 +823,19 @@ int rtnl_group_a2n(int *id, const char *arg)
 
 const char *rtnl_group_n2a(int id, char *buf, int len)
 {
-	struct rtnl_hash_entry *entry;
-	int i;
-
-	if (!rtnl_group_init)
-		rtnl_group_initialize();
-
-	for (i = 0; !numeric && i < 256; i++) {
-		entry = rtnl_group_hash[i];
+	const char *name;
 
-		while (entry) {
-			if (entry->id == id)
-				return entry->name;
-			entry = entry->next;
-		}
+	if (!numeric && id >= 0) {
+		name = names_db_n2a(&rtnl_group_db, id);
+		if (name)
+			return name;
 	}
 
 	snprintf(buf, len, "%d", id);
 	return buf;
 }
 
-static char *nl_proto_tab[256] = {
+static const char * const nl_proto_dflt[256] = {
 	[NETLINK_ROUTE]          = "rtnl",
 	[NETLINK_UNUSED]         = "unused",
 	[NETLINK_USERSOCK]       = "usersock",
@@ -637,27 +859,25 @@ static char *nl_proto_tab[256] = {
 	[NETLINK_CRYPTO]         = "crypto",
 };
 
-static int nl_proto_init;
-
-static void nl_proto_initialize(void)
-{
-	nl_proto_init = 1;
-	rtnl_tab_initialize(CONFDIR "/nl_protos",
-			    nl_proto_tab, 256);
-}
+static struct names_db nl_proto_db = {
+	.file = "nl_protos",
+	.max_id = 255,
+	.dflt = nl_proto_dflt,
+	.dflt_len = ARRAY_SIZE(nl_proto_dflt),
+};
 
 const char *nl_proto_n2a(int id, char *buf, int len)
 {
+	const char *name;
+
 	if (id < 0 || id >= 256 || numeric) {
 		snprintf(buf, len, "%d", id);
 		return buf;
 	}
 
-	if (!nl_proto_init)
-		nl_proto_initialize();
-
-	if (nl_proto_tab[id])
-		return nl_proto_tab[id];
+	name = names_db_n2a(&nl_proto_db, id);
+	if (name)
+		return name;
 
 	snprintf(buf, len, "%u", id);
 	return buf;
@@ -665,28 +885,11 @@ const char *nl_proto_n2a(int id, char *buf, int len)
 
 int nl_proto_a2n(__u32 *id, const char *arg)
 {
-	static char *cache;
-	static unsigned long res;
+	unsigned long res;
 	char *end;
-	int i;
 
-	if (cache && strcmp(cache, arg) == 0) {
-		*id = res;
+	if (!names_is_number(arg) && names_db_a2n(&nl_proto_db, id, arg) == 0)
 		return 0;
-	}
-
-	if (!nl_proto_init)
-		nl_proto_initialize();
-
-	for (i = 0; i < 256; i++) {
-		if (nl_proto_tab[i] &&
-		    strcmp(nl_proto_tab[i], arg) == 0) {
-			cache = nl_proto_tab[i];
-			res = i;
-			*id = res;
-			return 0;
-		}
-	}
 
 	res = strtoul(arg, &end, 0);
 	if (!end || end == arg || *end || res > 255)
@@ -696,46 +899,16 @@ int nl_proto_a2n(__u32 *id, const char *arg)
 }
 
 #define PROTODOWN_REASON_NUM_BITS 32
-static char *protodown_reason_tab[PROTODOWN_REASON_NUM_BITS] = {
-};
-
-static int protodown_reason_init;
-
-static void protodown_reason_initialize(void)
-{
-	struct dirent *de;
-	DIR *d;
-
-	protodown_reason_init = 1;
-
-	d = opendir(CONFDIR "/protodown_reasons.d");
-	if (!d)
-		return;
 
-	while ((de = readdir(d)) != NULL) {
-		char path[PATH_MAX];
-		size_t len;
-
-		if (*de->d_name == '.')
-			continue;
-
-		/* only consider filenames ending in '.conf' */
-		len = strlen(de->d_name);
-		if (len <= 5)
-			continue;
-		if (strcmp(de->d_name + len - 5, ".conf"))
-			continue;
-
-		snprintf(path, sizeof(path), CONFDIR "/protodown_reasons.d/%s",
-			 de->d_name);
-		rtnl_tab_initialize(path, protodown_reason_tab,
-				    PROTODOWN_REASON_NUM_BITS);
-	}
-	closedir(d);
-}
+static struct names_db protodown_reason_db = {
+	.dir = "protodown_reasons.d",
+	.max_id = PROTODOWN_REASON_NUM_BITS - 1,
+};
 
 int protodown_reason_n2a(int id, char *buf, int len)
 {
+	const char *name;
+
 	if (id < 0 || id >= PROTODOWN_REASON_NUM_BITS)
 		return -1;
 
@@ -744,11 +917,9 @@ int protodown_reason_n2a(int id, char *buf, int len)
 		return 0;
 	}
 
-	if (!protodown_reason_init)
-		protodown_reason_initialize();
-
-	if (protodown_reason_tab[id])
-		snprintf(buf, len, "%s", protodown_reason_tab[id]);
+	name = names_db_n2a(&protodown_reason_db, id);
+	if (name)
+		snprintf(buf, len, "%s", name);
 	else
 		snprintf(buf, len, "%d", id);
 
@@ -757,28 +928,12 @@ int protodown_reason_n2a(int id, char *buf, int len)
 
 int protodown_reason_a2n(__u32 *id, const char *arg)
 {
-	static char *cache;
-	static unsigned long res;
+	unsigned long res;
 	char *end;
-	int i;
 
-	if (cache && strcmp(cache, arg) == 0) {
-		*id = res;
+	if (!names_is_number(arg) &&
+	    names_db_a2n(&protodown_reason_db, id, arg) == 0)
 		return 0;
-	}
-
-	if (!protodown_reason_init)
-		protodown_reason_initialize();
-
-	for (i = 0; i < PROTODOWN_REASON_NUM_BITS; i++) {
-		if (protodown_reason_tab[i] &&
-		    strcmp(protodown_reason_tab[i], arg) == 0) {
-			cache = protodown_reason_tab[i];
-			res = i;
-			*id = res;
-			return 0;
-		}
-	}
 
 	res = strtoul(arg, &end, 0);
 	if (!end || end == arg || *end || res >= PROTODOWN_REASON_NUM_BITS)
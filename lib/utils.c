@@ -31,6 +31,12 @@
 #include <time.h>
 #include <sys/time.h>
 #include <errno.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
 #ifdef HAVE_LIBCAP
 #include <sys/capability.h>
 #endif
@@ -43,6 +49,7 @@
 int resolve_hosts;
 int timestamp_short;
 int pretty;
+int cbor;
 const char *_SL_ = "\n";
 
 static int af_byte_len(int af);
@@ -894,6 +901,97 @@ bool matches(const char *prefix, const char *string)
 	return !!*prefix;
 }
 
+/*
+ * Every prefix of every keyword in a command table is hashed to the first
+ * keyword it abbreviates, so that keyword_lookup() returns the same entry
+ * as walking the table with matches() but with a single probe.
+ */
+static __u32 keyword_hash(const char *word, size_t len)
+{
+	__u32 hash = 2166136261u;
+
+	while (len--) {
+		hash ^= (unsigned char)*word++;
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+static const char *keyword_at(const struct keyword_index *ki, unsigned int i)
+{
+	return *(const char * const *)((const char *)ki->table + i * ki->stride);
+}
+
+static int keyword_index_build(struct keyword_index *ki)
+{
+	unsigned int i, nslots = 0, size = 16;
+	size_t len;
+
+	for (i = 0; keyword_at(ki, i); i++)
+		nslots += strlen(keyword_at(ki, i));
+	while (size < 2 * nslots)
+		size <<= 1;
+
+	ki->slots = calloc(size, sizeof(*ki->slots));
+	if (!ki->slots)
+		return -1;
+	ki->mask = size - 1;
+
+	for (i = 0; keyword_at(ki, i); i++) {
+		const char *word = keyword_at(ki, i);
+
+		for (len = 1; len <= strlen(word); len++) {
+			struct keyword_slot *slot;
+			__u32 h = keyword_hash(word, len);
+
+			for (;; h++) {
+				slot = &ki->slots[h & ki->mask];
+				if (!slot->word ||
+				    (slot->len == len &&
+				     !memcmp(slot->word, word, len)))
+					break;
+			}
+			/* an earlier keyword already owns this prefix */
+			if (slot->word)
+				continue;
+
+			slot->word = word;
+			slot->len = len;
+			slot->idx = i;
+		}
+	}
+	return 0;
+}
+
+int keyword_lookup(struct keyword_index *ki, const char *word)
+{
+	size_t len = strlen(word);
+	__u32 h;
+
+	if (!ki->slots && keyword_index_build(ki)) {
+		/* fall back to walking the table */
+		unsigned int i;
+
+		for (i = 0; keyword_at(ki, i); i++) {
+			if (matches(word, keyword_at(ki, i)) == 0)
+				return i;
+		}
+		return -1;
+	}
+
+	if (!len)
+		return -1;
+
+	for (h = keyword_hash(word, len); ; h++) {
+		const struct keyword_slot *slot = &ki->slots[h & ki->mask];
+
+		if (!slot->word)
+			return -1;
+		if (slot->len == len && !memcmp(slot->word, word, len))
+			return slot->idx;
+	}
+}
+
 int inet_addr_match(const inet_prefix *a, const inet_prefix *b, int bits)
 {
 	const __u32 *a1 = a->data;
@@ -1060,54 +1158,312 @@ struct namerec {
 	struct namerec *next;
 	const char *name;
 	inet_prefix addr;
+	time_t expires;
+	bool pending;
 };
 
 #define NHASH 257
 static struct namerec *nht[NHASH];
 
-static const char *resolve_address(const void *addr, int len, int af)
-{
-	struct namerec *n;
-	struct hostent *h_ent;
-	unsigned int hash;
-	static int notfirst;
+/*
+ * Addresses registered with resolve_prefetch() are queued here and looked
+ * up together by the thread pool of resolve_prefetch_wait(), see
+ * resolve_pool.c.
+ */
+static struct namerec **resolve_queue;
+static unsigned int resolve_queue_len;
+static unsigned int resolve_queue_size;
 
+/*
+ * Optional persistent cache, enabled by pointing IPROUTE2_RESOLVE_CACHE
+ * to a file. Entries, negative ones included, are valid for
+ * IPROUTE2_RESOLVE_CACHE_TTL seconds.
+ */
+#define RESOLVE_CACHE_TTL 3600
+
+static const char *resolve_cache_file;
+static time_t resolve_cache_ttl = RESOLVE_CACHE_TTL;
+static bool resolve_cache_dirty;
+
+static void resolve_normalize(const void **addr, int *len, int *af)
+{
+	const __u32 *a = *addr;
 
-	if (af == AF_INET6 && ((__u32 *)addr)[0] == 0 &&
-	    ((__u32 *)addr)[1] == 0 && ((__u32 *)addr)[2] == htonl(0xffff)) {
-		af = AF_INET;
-		addr += 12;
-		len = 4;
+	if (*af == AF_INET6 && a[0] == 0 && a[1] == 0 &&
+	    a[2] == htonl(0xffff)) {
+		*af = AF_INET;
+		*addr = a + 3;
+		*len = 4;
 	}
+}
+
+static unsigned int namerec_hash(const void *addr, int len)
+{
+	__u32 key;
 
-	hash = *(__u32 *)(addr + len - 4) % NHASH;
+	memcpy(&key, addr + len - 4, sizeof(key));
+	return key % NHASH;
+}
 
-	for (n = nht[hash]; n; n = n->next) {
+static struct namerec *namerec_lookup(const void *addr, int len, int af)
+{
+	struct namerec *n;
+
+	for (n = nht[namerec_hash(addr, len)]; n; n = n->next) {
 		if (n->addr.family == af &&
 		    n->addr.bytelen == len &&
 		    memcmp(n->addr.data, addr, len) == 0)
-			return n->name;
+			return n;
 	}
-	n = malloc(sizeof(*n));
+	return NULL;
+}
+
+static struct namerec *namerec_add(const void *addr, int len, int af)
+{
+	unsigned int hash = namerec_hash(addr, len);
+	struct namerec *n;
+
+	n = calloc(1, sizeof(*n));
 	if (n == NULL)
 		return NULL;
 	n->addr.family = af;
 	n->addr.bytelen = len;
-	n->name = NULL;
 	memcpy(n->addr.data, addr, len);
 	n->next = nht[hash];
 	nht[hash] = n;
+	return n;
+}
+
+static void resolve_cache_save(void)
+{
+	char tmp[PATH_MAX], buf[INET6_ADDRSTRLEN];
+	time_t now = time(NULL);
+	struct namerec *n;
+	FILE *fp;
+	int fd, i;
+
+	if (!resolve_cache_dirty)
+		return;
+
+	/* a fresh file next to the cache, so rename() replaces it atomically */
+	if (snprintf(tmp, sizeof(tmp), "%s.XXXXXX",
+		     resolve_cache_file) >= sizeof(tmp))
+		return;
+	fd = mkstemp(tmp);
+	if (fd < 0)
+		return;
+	fp = fdopen(fd, "w");
+	if (!fp) {
+		close(fd);
+		unlink(tmp);
+		return;
+	}
+
+	for (i = 0; i < NHASH; i++) {
+		for (n = nht[i]; n; n = n->next) {
+			if (n->pending || n->expires <= now ||
+			    !inet_ntop(n->addr.family, n->addr.data,
+				       buf, sizeof(buf)))
+				continue;
+			fprintf(fp, "%lld %s %s\n", (long long)n->expires,
+				buf, n->name ? : "-");
+		}
+	}
+
+	if (fclose(fp) || rename(tmp, resolve_cache_file))
+		unlink(tmp);
+}
+
+static void resolve_cache_load(void)
+{
+	char line[1280], addr[INET6_ADDRSTRLEN], name[1024];
+	__u8 data[sizeof(struct in6_addr)];
+	time_t now = time(NULL);
+	struct namerec *n;
+	long long expires;
+	int af, len;
+	FILE *fp;
+
+	fp = fopen(resolve_cache_file, "r");
+	if (!fp)
+		return;
+
+	while (fgets(line, sizeof(line), fp)) {
+		if (sscanf(line, "%lld %45s %1023s", &expires, addr, name) != 3 ||
+		    expires <= now)
+			continue;
+
+		if (inet_pton(AF_INET, addr, data) == 1) {
+			af = AF_INET;
+			len = 4;
+		} else if (inet_pton(AF_INET6, addr, data) == 1) {
+			af = AF_INET6;
+			len = 16;
+		} else {
+			continue;
+		}
+
+		if (namerec_lookup(data, len, af))
+			continue;
+		n = namerec_add(data, len, af);
+		if (!n)
+			break;
+		n->expires = expires;
+		if (strcmp(name, "-"))
+			n->name = strdup(name);
+	}
+	fclose(fp);
+}
+
+static void resolve_cache_init(void)
+{
+	static bool initialized;
+	const char *ttl;
+
+	if (initialized)
+		return;
+	initialized = true;
+
+	resolve_cache_file = getenv("IPROUTE2_RESOLVE_CACHE");
+	if (!resolve_cache_file || !*resolve_cache_file) {
+		resolve_cache_file = NULL;
+		return;
+	}
+
+	ttl = getenv("IPROUTE2_RESOLVE_CACHE_TTL");
+	if (ttl)
+		resolve_cache_ttl = strtoul(ttl, NULL, 0);
+
+	resolve_cache_load();
+	atexit(resolve_cache_save);
+}
+
+/* Thread safe lookup, returns an allocated name or NULL */
+static char *resolve_name(const void *addr, int len, int af)
+{
+	struct hostent h_buf, *h_ent = NULL;
+	size_t buflen = 1024;
+	char *buf = NULL, *tmp;
+	char *name = NULL;
+	int ret, h_err;
+
+	do {
+		tmp = realloc(buf, buflen);
+		if (!tmp)
+			break;
+		buf = tmp;
+		ret = gethostbyaddr_r(addr, len, af, &h_buf, buf, buflen,
+				      &h_ent, &h_err);
+		buflen *= 2;
+	} while (ret == ERANGE);
+
+	if (h_ent != NULL)
+		name = strdup(h_ent->h_name);
+	free(buf);
+	return name;
+}
+
+static void namerec_resolve(struct namerec *n)
+{
+	n->name = resolve_name(n->addr.data, n->addr.bytelen, n->addr.family);
+	n->expires = time(NULL) + resolve_cache_ttl;
+	n->pending = false;
+	resolve_cache_dirty = resolve_cache_file != NULL;
+}
+
+/* Resolves queue entry i, returns false past the end of the queue */
+bool resolve_queue_run(unsigned int i)
+{
+	struct namerec *n;
+
+	if (i >= resolve_queue_len)
+		return false;
+	n = resolve_queue[i];
+	n->name = resolve_name(n->addr.data, n->addr.bytelen, n->addr.family);
+	return true;
+}
+
+unsigned int resolve_queue_pending(void)
+{
+	return resolve_queue_len;
+}
+
+void resolve_queue_done(void)
+{
+	time_t expires = time(NULL) + resolve_cache_ttl;
+	unsigned int i;
+
+	for (i = 0; i < resolve_queue_len; i++) {
+		resolve_queue[i]->expires = expires;
+		resolve_queue[i]->pending = false;
+	}
+	resolve_cache_dirty = resolve_cache_file != NULL;
+	resolve_queue_len = 0;
+}
+
+void resolve_prefetch(int af, int len, const void *addr)
+{
+	struct namerec **queue, *n;
+	unsigned int size;
+
+	if (!resolve_hosts)
+		return;
+
+	len = len <= 0 ? af_byte_len(af) : len;
+	if (af != AF_INET && af != AF_INET6)
+		return;
+	if (len != af_byte_len(af))
+		return;
+
+	resolve_cache_init();
+	resolve_normalize(&addr, &len, &af);
+	if (namerec_lookup(addr, len, af))
+		return;
+
+	if (resolve_queue_len == resolve_queue_size) {
+		size = resolve_queue_size ? resolve_queue_size * 2 : 128;
+		queue = realloc(resolve_queue, size * sizeof(*queue));
+		if (!queue)
+			return;
+		resolve_queue = queue;
+		resolve_queue_size = size;
+	}
+
+	n = namerec_add(addr, len, af);
+	if (!n)
+		return;
+	n->pending = true;
+	resolve_queue[resolve_queue_len++] = n;
+}
+
+static const char *resolve_address(const void *addr, int len, int af)
+{
+	struct namerec *n;
+	static int notfirst;
+
+	resolve_cache_init();
+	resolve_normalize(&addr, &len, &af);
+
+	n = namerec_lookup(addr, len, af);
+	if (n && !n->pending)
+		return n->name;
+	if (n == NULL) {
+		n = namerec_add(addr, len, af);
+		if (n == NULL)
+			return NULL;
+	}
 	if (++notfirst == 1)
 		sethostent(1);
 	fflush(stdout);
 
-	h_ent = gethostbyaddr(addr, len, af);
-	if (h_ent != NULL)
-		n->name = strdup(h_ent->h_name);
-
 	/* Even if we fail, "negative" entry is remembered. */
+	namerec_resolve(n);
 	return n->name;
 }
+#else
+void resolve_prefetch(int af, int len, const void *addr)
+{
+}
 #endif
 
 const char *format_host_r(int af, int len, const void *addr,
@@ -1358,16 +1714,121 @@ ssize_t getcmdline(char **linep, size_t *lenp, FILE *in)
 	return cc;
 }
 
+#define CMDLINE_READER_BUFSIZE	65536
+
+static int cmdline_fill(struct cmdline_reader *r)
+{
+	ssize_t n;
+
+	if (r->start) {
+		memmove(r->buf, r->buf + r->start, r->end - r->start);
+		r->end -= r->start;
+		r->start = 0;
+	}
+
+	/* one byte is kept for the terminating NUL of the last line */
+	if (r->end + 1 >= r->size) {
+		size_t size = r->size ? r->size * 2 : CMDLINE_READER_BUFSIZE;
+		char *buf = realloc(r->buf, size);
+
+		if (!buf) {
+			fprintf(stderr, "Out of memory\n");
+			return -1;
+		}
+		r->buf = buf;
+		r->size = size;
+	}
+
+	do {
+		n = read(r->fd, r->buf + r->end, r->size - r->end - 1);
+	} while (n < 0 && errno == EINTR);
+
+	if (n <= 0)
+		r->eof = true;
+	else
+		r->end += n;
+	return n;
+}
+
+void cmdline_reader_init(struct cmdline_reader *r, int fd)
+{
+	memset(r, 0, sizeof(*r));
+	r->fd = fd;
+}
+
+void cmdline_reader_free(struct cmdline_reader *r)
+{
+	free(r->buf);
+	r->buf = NULL;
+	r->size = r->start = r->end = 0;
+}
+
+/*
+ * Same as getcmdline() but reads in large chunks and strips comments and
+ * joins continuation lines in place, so that no memory is allocated per
+ * line. The returned line is valid until the next call.
+ */
+char *cmdline_read(struct cmdline_reader *r)
+{
+	size_t w = 0, p = 0;
+	bool cont = false;
+
+	for (;;) {
+		char *base = r->buf + r->start;
+		size_t avail = r->end - r->start;
+		char *nl = r->buf ? memchr(base + p, '\n', avail - p) : NULL;
+		char *hash;
+		size_t eol, len;
+
+		if (!nl && !r->eof) {
+			if (cmdline_fill(r) < 0 && !r->eof)
+				return NULL;
+			continue;
+		}
+
+		if (!nl && p == avail) {
+			if (cont)
+				fprintf(stderr, "Missing continuation line\n");
+			return NULL;
+		}
+
+		++cmdlineno;
+		eol = nl ? nl - base : avail;
+		len = eol - p;
+
+		hash = memchr(base + p, '#', len);
+		if (hash)
+			len = hash - (base + p);
+
+		cont = !hash && nl && len && base[p + len - 1] == '\\';
+		if (cont)
+			len--;
+
+		if (w != p)
+			memmove(base + w, base + p, len);
+		w += len;
+		p = nl ? eol + 1 : eol;
+
+		if (!cont) {
+			base[w] = '\0';
+			r->start += p;
+			return base;
+		}
+	}
+}
+
 /* split command line into argument vector */
+#define IS_ARG_SPACE(c)	((c) == ' ' || (c) == '\t' || (c) == '\r' || (c) == '\n')
+
 int makeargs(char *line, char *argv[], int maxargs)
 {
-	static const char ws[] = " \t\r\n";
 	char *cp = line;
 	int argc = 0;
 
 	while (*cp) {
 		/* skip leading whitespace */
-		cp += strspn(cp, ws);
+		while (IS_ARG_SPACE(*cp))
+			cp++;
 
 		if (*cp == '\0')
 			break;
@@ -1392,7 +1853,8 @@ int makeargs(char *line, char *argv[], int maxargs)
 			argv[argc++] = cp;
 
 			/* find end of word */
-			cp += strcspn(cp, ws);
+			while (*cp && !IS_ARG_SPACE(*cp))
+				cp++;
 			if (*cp == '\0')
 				break;
 		}
@@ -1413,6 +1875,13 @@ void print_nlmsg_timestamp(FILE *fp, const struct nlmsghdr *n)
 
 	tstr = asctime(localtime(&secs));
 	tstr[strlen(tstr)-1] = 0;
+	if (is_json_context()) {
+		open_json_object(NULL);
+		print_string(PRINT_JSON, "timestamp", NULL, tstr);
+		print_uint(PRINT_JSON, "usecs", NULL, usecs);
+		close_json_object();
+		return;
+	}
 	fprintf(fp, "Timestamp: %s %lu us\n", tstr, usecs);
 }
 
@@ -1699,8 +2168,8 @@ char *sprint_time64(__s64 time, char *buf)
 int do_batch(const char *name, bool force,
 	     int (*cmd)(int argc, char *argv[], void *data), void *data)
 {
-	char *line = NULL;
-	size_t len = 0;
+	struct cmdline_reader reader;
+	char *line;
 	int ret = EXIT_SUCCESS;
 
 	if (name && strcmp(name, "-") != 0) {
@@ -1712,8 +2181,12 @@ int do_batch(const char *name, bool force,
 		}
 	}
 
+	/* keep the link cache current instead of dumping links per line */
+	ll_watch_map();
+
+	cmdline_reader_init(&reader, fileno(stdin));
 	cmdlineno = 0;
-	while (getcmdline(&line, &len, stdin) != -1) {
+	while ((line = cmdline_read(&reader)) != NULL) {
 		char *largv[100];
 		int largc;
 
@@ -1721,6 +2194,7 @@ int do_batch(const char *name, bool force,
 		if (!largc)
 			continue;	/* blank line */
 
+		ll_sync_map();
 		if (cmd(largc, largv, data)) {
 			fprintf(stderr, "Command failed %s:%d\n",
 				name, cmdlineno);
@@ -1730,12 +2204,259 @@ int do_batch(const char *name, bool force,
 		}
 	}
 
-	if (line)
-		free(line);
+	cmdline_reader_free(&reader);
+	return ret;
+}
+
+/*
+ * Server mode: batch command lines are read from clients of a unix
+ * socket and run by a worker process which keeps its netlink sockets
+ * and caches between commands. Each non blank line gets one reply:
+ *
+ *	"<status> <stdout length> <stderr length>\n" <stdout> <stderr>
+ *
+ * where status is what the process would have exited with. A command
+ * which terminates the process still gets its reply, then the client
+ * is disconnected and a fresh worker takes over.
+ */
+#define SERVER_RESPAWN	75
+
+/* A worker killed by a signal is replaced, unless that keeps happening */
+#define SERVER_CRASH_BURST	5
+#define SERVER_CRASH_INTERVAL	10
+
+static volatile sig_atomic_t server_stop;
+static int server_conn = -1;
+static int server_out = -1;
+static int server_err = -1;
+static bool server_in_cmd;
+
+static int server_send(const void *buf, size_t len)
+{
+	ssize_t n;
+
+	while (len) {
+		n = send(server_conn, buf, len, MSG_NOSIGNAL);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		buf += n;
+		len -= n;
+	}
+	return 0;
+}
+
+static int server_send_fd(int fd, off_t len)
+{
+	char buf[16384];
+	off_t off = 0;
+	ssize_t n;
+
+	while (off < len) {
+		n = pread(fd, buf, sizeof(buf), off);
+		if (n <= 0)
+			return -1;
+		if (server_send(buf, n))
+			return -1;
+		off += n;
+	}
+	return 0;
+}
+
+static int server_reply(int status)
+{
+	off_t out_len, err_len;
+	char hdr[64];
+	int ret;
+
+	fflush(stdout);
+	fflush(stderr);
+	out_len = lseek(server_out, 0, SEEK_CUR);
+	err_len = lseek(server_err, 0, SEEK_CUR);
 
+	snprintf(hdr, sizeof(hdr), "%d %lld %lld\n", status & 0xff,
+		 (long long)out_len, (long long)err_len);
+	ret = server_send(hdr, strlen(hdr));
+	if (!ret)
+		ret = server_send_fd(server_out, out_len);
+	if (!ret)
+		ret = server_send_fd(server_err, err_len);
+
+	if (ftruncate(server_out, 0) || ftruncate(server_err, 0))
+		ret = -1;
+	lseek(server_out, 0, SEEK_SET);
+	lseek(server_err, 0, SEEK_SET);
 	return ret;
 }
 
+static void server_on_exit(int status, void *arg)
+{
+	if (!server_in_cmd)
+		return;
+	server_in_cmd = false;
+	server_reply(status);
+	_exit(SERVER_RESPAWN);
+}
+
+static int server_worker(int sock, int (*init)(void *data),
+			 int (*cmd)(int argc, char *argv[], void *data),
+			 void *data)
+{
+	struct cmdline_reader reader;
+	char *line;
+
+	prctl(PR_SET_PDEATHSIG, SIGTERM);
+
+	server_out = memfd_create("stdout", MFD_CLOEXEC);
+	server_err = memfd_create("stderr", MFD_CLOEXEC);
+	if (server_out < 0 || server_err < 0) {
+		perror("memfd_create");
+		return EXIT_FAILURE;
+	}
+
+	if (init && init(data))
+		return EXIT_FAILURE;
+	ll_watch_map();
+
+	fflush(stdout);
+	fflush(stderr);
+	if (dup2(server_out, STDOUT_FILENO) < 0 ||
+	    dup2(server_err, STDERR_FILENO) < 0)
+		return EXIT_FAILURE;
+	on_exit(server_on_exit, NULL);
+
+	for (;;) {
+		server_conn = accept4(sock, NULL, NULL, SOCK_CLOEXEC);
+		if (server_conn < 0) {
+			if (errno == EINTR || errno == ECONNABORTED)
+				continue;
+			return EXIT_FAILURE;
+		}
+
+		cmdline_reader_init(&reader, server_conn);
+		cmdlineno = 0;
+		while ((line = cmdline_read(&reader)) != NULL) {
+			char *largv[100];
+			int largc, ret;
+
+			largc = makeargs(line, largv, 100);
+			if (!largc)
+				continue;	/* blank line */
+
+			ll_sync_map();
+			server_in_cmd = true;
+			ret = cmd(largc, largv, data);
+			server_in_cmd = false;
+			if (server_reply(ret))
+				break;
+		}
+
+		cmdline_reader_free(&reader);
+		close(server_conn);
+		server_conn = -1;
+	}
+}
+
+static void server_sighandler(int signum)
+{
+	server_stop = 1;
+}
+
+int do_server(const char *path, int (*init)(void *data),
+	      int (*cmd)(int argc, char *argv[], void *data), void *data)
+{
+	struct sockaddr_un addr = { .sun_family = AF_UNIX };
+	struct sigaction act = { .sa_handler = server_sighandler };
+	time_t crash_start = 0, now;
+	unsigned int crashes = 0;
+	int sock, status;
+	struct stat st;
+	pid_t pid;
+
+	if (strlen(path) >= sizeof(addr.sun_path)) {
+		fprintf(stderr, "Socket path \"%s\" is too long\n", path);
+		return EXIT_FAILURE;
+	}
+	strcpy(addr.sun_path, path);
+
+	sock = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (sock < 0) {
+		perror("socket");
+		return EXIT_FAILURE;
+	}
+
+	/* only a stale socket of an earlier server may be replaced */
+	if (lstat(path, &st) == 0) {
+		if (!S_ISSOCK(st.st_mode)) {
+			fprintf(stderr, "\"%s\" exists and is not a socket\n",
+				path);
+			close(sock);
+			return EXIT_FAILURE;
+		}
+		unlink(path);
+	}
+	if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+	    listen(sock, 16) < 0) {
+		fprintf(stderr, "Cannot listen on \"%s\": %s\n",
+			path, strerror(errno));
+		close(sock);
+		return EXIT_FAILURE;
+	}
+
+	/* no SA_RESTART, waitpid() has to notice the signal */
+	sigaction(SIGTERM, &act, NULL);
+	sigaction(SIGINT, &act, NULL);
+
+	while (!server_stop) {
+		fflush(stdout);
+		fflush(stderr);
+		pid = fork();
+		if (pid < 0) {
+			perror("fork");
+			break;
+		}
+		if (pid == 0) {
+			signal(SIGTERM, SIG_DFL);
+			signal(SIGINT, SIG_DFL);
+			exit(server_worker(sock, init, cmd, data));
+		}
+
+		while (waitpid(pid, &status, 0) < 0) {
+			if (errno != EINTR)
+				goto out;
+			if (server_stop)
+				kill(pid, SIGTERM);
+		}
+		if (WIFEXITED(status)) {
+			if (WEXITSTATUS(status) != SERVER_RESPAWN)
+				break;
+			continue;
+		}
+		if (server_stop)
+			break;
+
+		now = time(NULL);
+		if (now - crash_start >= SERVER_CRASH_INTERVAL) {
+			crash_start = now;
+			crashes = 0;
+		}
+		if (++crashes > SERVER_CRASH_BURST) {
+			fprintf(stderr, "Worker keeps crashing, giving up\n");
+			break;
+		}
+		if (WIFSIGNALED(status))
+			fprintf(stderr, "Worker killed by signal %d, restarting\n",
+				WTERMSIG(status));
+	}
+
+out:
+	close(sock);
+	unlink(path);
+	return EXIT_FAILURE;
+}
+
 int parse_one_of(const char *msg, const char *realval, const char * const *list,
 		 size_t len, int *p_err)
 {
@@ -47,8 +47,11 @@ struct filter_entry {
 	uint8_t is_doit:1;
 };
 
+#define DEV_MAP_HASH_SIZE 256
+
 struct dev_map {
 	struct list_head list;
+	struct hlist_node hash;
 	char *dev_name;
 	uint32_t num_ports;
 	uint32_t idx;
@@ -62,8 +65,10 @@ struct rd {
 	uint8_t show_driver_details:1;
 	uint8_t show_raw:1;
 	struct list_head dev_map_list;
+	struct hlist_head dev_map_hash[DEV_MAP_HASH_SIZE];
 	uint32_t dev_idx;
 	uint32_t port_idx;
+	bool dump_all_ports;
 	struct mnl_socket *nl;
 	struct nlmsghdr *nlh;
 	char *buff;
@@ -102,6 +107,8 @@ int rd_exec_cmd(struct rd *rd, const struct rd_cmd *c, const char *str);
 int rd_exec_dev(struct rd *rd, int (*cb)(struct rd *rd));
 int rd_exec_require_dev(struct rd *rd, int (*cb)(struct rd *rd));
 int rd_exec_link(struct rd *rd, int (*cb)(struct rd *rd), bool strict_port);
+int rd_exec_dump(struct rd *rd, uint32_t (*prepare)(struct rd *rd),
+		 mnl_cb_t callback, bool strict_port);
 void rd_free(struct rd *rd);
 int rd_set_arg_to_devname(struct rd *rd);
 int rd_argc(struct rd *rd);
@@ -112,6 +119,8 @@ int strcmpx(const char *str1, const char *str2);
  * Device manipulation
  */
 struct dev_map *dev_map_lookup(struct rd *rd, bool allow_port_index);
+struct dev_map *rd_link_lookup(struct rd *rd, uint32_t *port,
+			       bool *is_dump_all, bool strict_port);
 
 /*
  * Filter manipulation
@@ -110,7 +110,7 @@ static int res_cm_id_line(struct rd *rd, const char *name, int idx,
 	if (nla_line[RDMA_NLDEV_ATTR_PORT_INDEX])
 		port = mnl_attr_get_u32(nla_line[RDMA_NLDEV_ATTR_PORT_INDEX]);
 
-	if (port && port != rd->port_idx)
+	if (port && !rd->dump_all_ports && port != rd->port_idx)
 		goto out;
 
 	if (nla_line[RDMA_NLDEV_ATTR_RES_LQPN])
@@ -67,11 +67,16 @@ static void print_pathmig(struct rd *rd, uint32_t val, struct nlattr **nla_line)
 static int res_qp_line_raw(struct rd *rd, const char *name, int idx,
 			   struct nlattr **nla_line)
 {
+	uint32_t port = rd->port_idx;
+
 	if (!nla_line[RDMA_NLDEV_ATTR_RES_RAW])
 		return MNL_CB_ERROR;
 
+	if (rd->dump_all_ports && nla_line[RDMA_NLDEV_ATTR_PORT_INDEX])
+		port = mnl_attr_get_u32(nla_line[RDMA_NLDEV_ATTR_PORT_INDEX]);
+
 	open_json_object(NULL);
-	print_link(rd, idx, name, rd->port_idx, nla_line);
+	print_link(rd, idx, name, port, nla_line);
 	print_raw_data(rd, nla_line);
 	newline(rd);
 
@@ -96,7 +101,7 @@ static int res_qp_line(struct rd *rd, const char *name, int idx,
 	if (nla_line[RDMA_NLDEV_ATTR_PORT_INDEX])
 		port = mnl_attr_get_u32(nla_line[RDMA_NLDEV_ATTR_PORT_INDEX]);
 
-	if (port != rd->port_idx)
+	if (!rd->dump_all_ports && port != rd->port_idx)
 		goto out;
 
 	lqpn = mnl_attr_get_u32(nla_line[RDMA_NLDEV_ATTR_RES_LQPN]);
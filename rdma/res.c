@@ -108,11 +108,10 @@ int _res_send_idx_msg(struct rd *rd, uint32_t command, mnl_cb_t callback,
 	return ret;
 }
 
-int _res_send_msg(struct rd *rd, uint32_t command, mnl_cb_t callback)
+uint32_t _res_prepare_msg(struct rd *rd, uint32_t command)
 {
 	uint32_t flags = NLM_F_REQUEST | NLM_F_ACK;
 	uint32_t seq;
-	int ret;
 
 	if (command != RDMA_NLDEV_CMD_RES_GET)
 		flags |= NLM_F_DUMP;
@@ -126,7 +125,15 @@ int _res_send_msg(struct rd *rd, uint32_t command, mnl_cb_t callback)
 	if (command == RDMA_NLDEV_CMD_STAT_GET)
 		mnl_attr_put_u32(rd->nlh, RDMA_NLDEV_ATTR_STAT_RES,
 				 RDMA_NLDEV_ATTR_RES_MR);
+	return seq;
+}
+
+int _res_send_msg(struct rd *rd, uint32_t command, mnl_cb_t callback)
+{
+	uint32_t seq;
+	int ret;
 
+	seq = _res_prepare_msg(rd, command);
 	ret = rd_send_msg(rd);
 	if (ret)
 		return ret;
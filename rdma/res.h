@@ -8,6 +8,7 @@
 
 #include "rdma.h"
 
+uint32_t _res_prepare_msg(struct rd *rd, uint32_t command);
 int _res_send_msg(struct rd *rd, uint32_t command, mnl_cb_t callback);
 int _res_send_idx_msg(struct rd *rd, uint32_t command, mnl_cb_t callback,
 		      uint32_t idx, uint32_t id);
@@ -41,6 +42,10 @@ static inline uint32_t res_get_command(uint32_t command, struct rd *rd)
 }
 
 #define RES_FUNC(name, command, valid_filters, strict_port, id)                        \
+	static inline uint32_t __##name##_prepare(struct rd *rd)                       \
+	{                                                                              \
+		return _res_prepare_msg(rd, res_get_command(command, rd));             \
+	}                                                                              \
 	static inline int _##name(struct rd *rd)                                       \
 	{                                                                              \
 		uint32_t idx, _command;                                                \
@@ -64,6 +69,7 @@ static inline uint32_t res_get_command(uint32_t command, struct rd *rd)
 	}                                                                              \
 	static inline int name(struct rd *rd)                                          \
 	{                                                                              \
+		uint32_t idx;                                                          \
 		int ret = rd_build_filter(rd, valid_filters);                          \
 		if (ret)                                                               \
 			return ret;                                                    \
@@ -72,6 +78,9 @@ static inline uint32_t res_get_command(uint32_t command, struct rd *rd)
 			if (ret)                                                       \
 				return ret;                                            \
 		}                                                                      \
+		if (id && !rd_doit_index(rd, &idx))                                    \
+			return rd_exec_dump(rd, __##name##_prepare,                    \
+					    name##_parse_cb, strict_port);             \
 		if (strict_port)                                                       \
 			return rd_exec_dev(rd, _##name);                               \
 		else                                                                   \
@@ -8,6 +8,7 @@
 #include "res.h"
 #include "stat.h"
 #include <inttypes.h>
+#include <signal.h>
 
 static int stat_help(struct rd *rd)
 {
@@ -20,6 +21,7 @@ static int stat_help(struct rd *rd)
 	pr_out("       %s statistic OBJECT unbind COUNTER_SCOPE [DEV/PORT_INDEX] [COUNTER-ID]\n", rd->filename);
 	pr_out("       %s statistic show\n", rd->filename);
 	pr_out("       %s statistic show link [ DEV/PORT_INDEX ]\n", rd->filename);
+	pr_out("       %s statistic watch [ link DEV/PORT_INDEX ] [ interval MS ] [ count COUNT ] [ top N ] [ all ]\n", rd->filename);
 	pr_out("where  OBJECT: = { qp }\n");
 	pr_out("       CRITERIA : = { type }\n");
 	pr_out("       COUNTER_SCOPE: = { link | dev }\n");
@@ -37,6 +39,7 @@ static int stat_help(struct rd *rd)
 	pr_out("       %s statistic qp unbind link mlx5_2/1 cntn 4 lqpn 178\n", rd->filename);
 	pr_out("       %s statistic show\n", rd->filename);
 	pr_out("       %s statistic show link mlx5_2/1\n", rd->filename);
+	pr_out("       %s statistic watch link mlx5_2/1 interval 500 top 10\n", rd->filename);
 
 	return 0;
 }
@@ -777,12 +780,502 @@ static int stat_show(struct rd *rd)
 	return rd_exec_cmd(rd, cmds, "parameter");
 }
 
+/*
+ * Interval sampling of the port hw counters and of the bound (mode)
+ * counters. Counters are kept in a hash keyed by device, port, counter
+ * id and name; the port hw counters use counter id 0.
+ */
+#define STAT_WATCH_HASH_SIZE		256
+#define STAT_WATCH_INTERVAL_DEFAULT	1000
+
+struct stat_watch_entry {
+	struct hlist_node hash;
+	struct list_head list;
+	char *dev_name;
+	char *name;
+	uint32_t dev_idx;
+	uint32_t port;
+	uint32_t cntn;
+	uint64_t value;
+	uint64_t delta;
+	unsigned int samples;
+	bool updated;
+};
+
+struct stat_watch {
+	struct rd *rd;
+	struct hlist_head hash[STAT_WATCH_HASH_SIZE];
+	struct list_head entries;
+	unsigned int entries_count;
+	struct dev_map *dev_map;
+	uint32_t port;
+	bool all_ports;
+	uint32_t interval;
+	uint32_t count;
+	uint32_t top;
+	bool all;
+};
+
+static volatile sig_atomic_t stat_watch_stop;
+
+static void stat_watch_sigint(int signum)
+{
+	stat_watch_stop = 1;
+}
+
+static unsigned int stat_watch_hash(uint32_t dev_idx, uint32_t port,
+				    uint32_t cntn, const char *name)
+{
+	unsigned int hash = dev_idx;
+
+	hash = hash * 31 + port;
+	hash = hash * 31 + cntn;
+	while (*name)
+		hash = hash * 31 + (unsigned char)*name++;
+	return hash % STAT_WATCH_HASH_SIZE;
+}
+
+static int stat_watch_update(struct stat_watch *watch, const char *dev_name,
+			     uint32_t dev_idx, uint32_t port, uint32_t cntn,
+			     const char *name, uint64_t value)
+{
+	unsigned int hash = stat_watch_hash(dev_idx, port, cntn, name);
+	struct stat_watch_entry *entry;
+	struct hlist_node *n;
+
+	hlist_for_each(n, &watch->hash[hash]) {
+		entry = container_of(n, struct stat_watch_entry, hash);
+		if (entry->dev_idx == dev_idx && entry->port == port &&
+		    entry->cntn == cntn && !strcmp(entry->name, name))
+			goto update;
+	}
+
+	entry = calloc(1, sizeof(*entry));
+	if (!entry)
+		return -ENOMEM;
+	entry->dev_name = strdup(dev_name);
+	entry->name = strdup(name);
+	if (!entry->dev_name || !entry->name) {
+		free(entry->dev_name);
+		free(entry->name);
+		free(entry);
+		return -ENOMEM;
+	}
+	entry->dev_idx = dev_idx;
+	entry->port = port;
+	entry->cntn = cntn;
+	hlist_add_head(&entry->hash, &watch->hash[hash]);
+	list_add_tail(&entry->list, &watch->entries);
+	watch->entries_count++;
+
+update:
+	/* A counter which went backwards was reset, count from zero. */
+	entry->delta = value >= entry->value ? value - entry->value : value;
+	entry->value = value;
+	entry->samples++;
+	entry->updated = true;
+	return 0;
+}
+
+static int stat_watch_hwcounters(struct stat_watch *watch,
+				 const char *dev_name, uint32_t dev_idx,
+				 uint32_t port, uint32_t cntn,
+				 struct nlattr *hwc_table)
+{
+	struct nlattr *nla_entry;
+	const char *nm;
+	uint64_t v;
+	int err;
+
+	mnl_attr_for_each_nested(nla_entry, hwc_table) {
+		struct nlattr *hw_line[RDMA_NLDEV_ATTR_MAX] = {};
+
+		err = mnl_attr_parse_nested(nla_entry, rd_attr_cb, hw_line);
+		if (err != MNL_CB_OK)
+			return MNL_CB_ERROR;
+
+		if (!hw_line[RDMA_NLDEV_ATTR_STAT_HWCOUNTER_ENTRY_NAME] ||
+		    !hw_line[RDMA_NLDEV_ATTR_STAT_HWCOUNTER_ENTRY_VALUE])
+			return MNL_CB_ERROR;
+
+		nm = mnl_attr_get_str(hw_line[RDMA_NLDEV_ATTR_STAT_HWCOUNTER_ENTRY_NAME]);
+		v = mnl_attr_get_u64(hw_line[RDMA_NLDEV_ATTR_STAT_HWCOUNTER_ENTRY_VALUE]);
+		if (stat_watch_update(watch, dev_name, dev_idx, port, cntn,
+				      nm, v))
+			return MNL_CB_ERROR;
+	}
+	return MNL_CB_OK;
+}
+
+static int stat_watch_port_cb(const struct nlmsghdr *nlh, void *data)
+{
+	struct nlattr *tb[RDMA_NLDEV_ATTR_MAX] = {};
+	struct stat_watch *watch = data;
+
+	mnl_attr_parse(nlh, 0, rd_attr_cb, tb);
+	if (!tb[RDMA_NLDEV_ATTR_DEV_INDEX] || !tb[RDMA_NLDEV_ATTR_DEV_NAME] ||
+	    !tb[RDMA_NLDEV_ATTR_PORT_INDEX] ||
+	    !tb[RDMA_NLDEV_ATTR_STAT_HWCOUNTERS])
+		return MNL_CB_ERROR;
+
+	return stat_watch_hwcounters(watch,
+				     mnl_attr_get_str(tb[RDMA_NLDEV_ATTR_DEV_NAME]),
+				     mnl_attr_get_u32(tb[RDMA_NLDEV_ATTR_DEV_INDEX]),
+				     mnl_attr_get_u32(tb[RDMA_NLDEV_ATTR_PORT_INDEX]),
+				     0, tb[RDMA_NLDEV_ATTR_STAT_HWCOUNTERS]);
+}
+
+static int stat_watch_counter_cb(const struct nlmsghdr *nlh, void *data)
+{
+	struct nlattr *tb[RDMA_NLDEV_ATTR_MAX] = {};
+	struct nlattr *nla_table, *nla_entry;
+	struct stat_watch *watch = data;
+	const char *name;
+	uint32_t idx;
+	int ret = MNL_CB_OK;
+
+	mnl_attr_parse(nlh, 0, rd_attr_cb, tb);
+	if (!tb[RDMA_NLDEV_ATTR_DEV_INDEX] || !tb[RDMA_NLDEV_ATTR_DEV_NAME] ||
+	    !tb[RDMA_NLDEV_ATTR_STAT_COUNTER])
+		return MNL_CB_ERROR;
+
+	name = mnl_attr_get_str(tb[RDMA_NLDEV_ATTR_DEV_NAME]);
+	idx = mnl_attr_get_u32(tb[RDMA_NLDEV_ATTR_DEV_INDEX]);
+	nla_table = tb[RDMA_NLDEV_ATTR_STAT_COUNTER];
+
+	mnl_attr_for_each_nested(nla_entry, nla_table) {
+		struct nlattr *nla_line[RDMA_NLDEV_ATTR_MAX] = {};
+		uint32_t port = 0, cntn;
+
+		ret = mnl_attr_parse_nested(nla_entry, rd_attr_cb, nla_line);
+		if (ret != MNL_CB_OK)
+			break;
+
+		if (!nla_line[RDMA_NLDEV_ATTR_STAT_COUNTER_ID] ||
+		    !nla_line[RDMA_NLDEV_ATTR_STAT_HWCOUNTERS])
+			return MNL_CB_ERROR;
+
+		if (nla_line[RDMA_NLDEV_ATTR_PORT_INDEX])
+			port = mnl_attr_get_u32(nla_line[RDMA_NLDEV_ATTR_PORT_INDEX]);
+		if (!watch->all_ports && port != watch->port)
+			continue;
+
+		cntn = mnl_attr_get_u32(nla_line[RDMA_NLDEV_ATTR_STAT_COUNTER_ID]);
+		ret = stat_watch_hwcounters(watch, name, idx, port, cntn,
+					    nla_line[RDMA_NLDEV_ATTR_STAT_HWCOUNTERS]);
+		if (ret != MNL_CB_OK)
+			break;
+	}
+	return ret;
+}
+
+/* Returns -EINTR without a message when SIGINT interrupts the request */
+static int stat_watch_request(struct rd *rd, uint32_t seq, mnl_cb_t cb,
+			      void *data)
+{
+	char buf[MNL_SOCKET_BUFFER_SIZE];
+	int ret;
+
+	ret = mnl_socket_sendto(rd->nl, rd->nlh, rd->nlh->nlmsg_len);
+	if (ret < 0) {
+		if (errno == EINTR)
+			return -EINTR;
+		pr_err("Failed to send to socket with err %d\n", ret);
+		return ret;
+	}
+
+	ret = mnlu_socket_recv_run(rd->nl, seq, buf, sizeof(buf), cb, data);
+	if (ret < 0 && errno == EINTR)
+		return -EINTR;
+	if (ret < 0 && !rd->suppress_errors)
+		perror("error");
+	return ret;
+}
+
+/*
+ * The kernel has no dump for the port hw counters, they take one request
+ * per port. All bound counters of a device come with a single dump.
+ */
+static int stat_watch_sample_dev(struct stat_watch *watch,
+				 struct dev_map *dev_map)
+{
+	struct rd *rd = watch->rd;
+	uint32_t port, last;
+	bool suppress;
+	uint32_t seq;
+	int ret;
+
+	port = watch->all_ports ? 1 : watch->port;
+	last = watch->all_ports ? dev_map->num_ports : watch->port;
+	for (; port && port <= last; port++) {
+		rd_prepare_msg(rd, RDMA_NLDEV_CMD_STAT_GET, &seq,
+			       NLM_F_REQUEST | NLM_F_ACK);
+		mnl_attr_put_u32(rd->nlh, RDMA_NLDEV_ATTR_DEV_INDEX,
+				 dev_map->idx);
+		mnl_attr_put_u32(rd->nlh, RDMA_NLDEV_ATTR_PORT_INDEX, port);
+		ret = stat_watch_request(rd, seq, stat_watch_port_cb, watch);
+		if (ret)
+			return ret;
+	}
+
+	rd_prepare_msg(rd, RDMA_NLDEV_CMD_STAT_GET, &seq,
+		       NLM_F_REQUEST | NLM_F_ACK | NLM_F_DUMP);
+	mnl_attr_put_u32(rd->nlh, RDMA_NLDEV_ATTR_DEV_INDEX, dev_map->idx);
+	mnl_attr_put_u32(rd->nlh, RDMA_NLDEV_ATTR_STAT_RES,
+			 RDMA_NLDEV_ATTR_RES_QP);
+
+	/* Devices without bound counter support just report port ones. */
+	suppress = rd->suppress_errors;
+	rd->suppress_errors = true;
+	ret = stat_watch_request(rd, seq, stat_watch_counter_cb, watch);
+	rd->suppress_errors = suppress;
+	/* the rest of an interrupted dump would answer the next request */
+	return ret == -EINTR ? ret : 0;
+}
+
+static int stat_watch_sample(struct stat_watch *watch)
+{
+	struct dev_map *dev_map;
+	int ret;
+
+	if (watch->dev_map)
+		return stat_watch_sample_dev(watch, watch->dev_map);
+
+	list_for_each_entry(dev_map, &watch->rd->dev_map_list, list) {
+		ret = stat_watch_sample_dev(watch, dev_map);
+		if (ret)
+			return ret;
+	}
+	return 0;
+}
+
+static int stat_watch_entry_cmp(const void *a, const void *b)
+{
+	const struct stat_watch_entry *ea = *(const struct stat_watch_entry **)a;
+	const struct stat_watch_entry *eb = *(const struct stat_watch_entry **)b;
+
+	if (ea->delta != eb->delta)
+		return ea->delta < eb->delta ? 1 : -1;
+	return 0;
+}
+
+static void stat_watch_entry_print(struct stat_watch *watch,
+				   struct stat_watch_entry *entry,
+				   uint64_t elapsed_ms)
+{
+	double rate = elapsed_ms ? entry->delta * 1000.0 / elapsed_ms : 0;
+	struct rd *rd = watch->rd;
+
+	open_json_object(NULL);
+	if (watch->all)
+		print_color_string(PRINT_FP, COLOR_NONE, NULL, "%s",
+				   entry->delta ? "* " : "  ");
+	print_color_string(PRINT_ANY, COLOR_NONE, "ifname", "link %s/",
+			   entry->dev_name);
+	print_color_uint(PRINT_ANY, COLOR_NONE, "port", "%u ", entry->port);
+	if (entry->cntn)
+		print_color_uint(PRINT_ANY, COLOR_NONE, "cntn", "cntn %u ",
+				 entry->cntn);
+	print_color_string(PRINT_ANY, COLOR_NONE, "name", "%s ", entry->name);
+	print_color_u64(PRINT_ANY, COLOR_NONE, "value", "%" PRIu64 " ",
+			entry->value);
+	print_color_u64(PRINT_ANY, COLOR_NONE, "delta", "delta %" PRIu64 " ",
+			entry->delta);
+	print_color_float(PRINT_ANY, COLOR_NONE, "rate", "rate %.1f/s ", rate);
+	print_color_bool(PRINT_JSON, COLOR_NONE, "changed", NULL,
+			 entry->delta != 0);
+	newline(rd);
+}
+
+static int stat_watch_print(struct stat_watch *watch, uint64_t elapsed_ms)
+{
+	struct stat_watch_entry **sorted, *entry;
+	unsigned int count = 0, i;
+
+	sorted = calloc(watch->entries_count ? : 1, sizeof(*sorted));
+	if (!sorted)
+		return -ENOMEM;
+
+	list_for_each_entry(entry, &watch->entries, list) {
+		if (!entry->updated || entry->samples < 2)
+			continue;
+		entry->updated = false;
+		if (!entry->delta && !watch->all)
+			continue;
+		sorted[count++] = entry;
+	}
+
+	if (watch->top) {
+		qsort(sorted, count, sizeof(*sorted), stat_watch_entry_cmp);
+		if (count > watch->top)
+			count = watch->top;
+	}
+
+	for (i = 0; i < count; i++)
+		stat_watch_entry_print(watch, sorted[i], elapsed_ms);
+	if (count)
+		print_color_string(PRINT_FP, COLOR_NONE, NULL, "\n", NULL);
+	fflush(stdout);
+
+	free(sorted);
+	return 0;
+}
+
+static void stat_watch_fini(struct stat_watch *watch)
+{
+	struct stat_watch_entry *entry, *tmp;
+
+	list_for_each_entry_safe(entry, tmp, &watch->entries, list) {
+		list_del(&entry->list);
+		free(entry->dev_name);
+		free(entry->name);
+		free(entry);
+	}
+}
+
+static int stat_watch_get_u32(struct rd *rd, const char *name, uint32_t *val)
+{
+	rd_arg_inc(rd);
+	if (rd_no_arg(rd) || get_u32(val, rd_argv(rd), 10)) {
+		pr_err("%s requires a number\n", name);
+		return -EINVAL;
+	}
+	rd_arg_inc(rd);
+	return 0;
+}
+
+static int stat_watch_parse(struct rd *rd, struct stat_watch *watch)
+{
+	int ret;
+
+	while (!rd_no_arg(rd)) {
+		if (!strcmpx(rd_argv(rd), "link")) {
+			bool is_dump_all;
+
+			rd_arg_inc(rd);
+			if (rd_no_arg(rd)) {
+				pr_err("No device name was supplied\n");
+				return -EINVAL;
+			}
+			watch->dev_map = rd_link_lookup(rd, &watch->port,
+							&is_dump_all, false);
+			if (!watch->dev_map) {
+				pr_err("Wrong device name\n");
+				return -ENOENT;
+			}
+			watch->all_ports = is_dump_all;
+			rd_arg_inc(rd);
+		} else if (!strcmpx(rd_argv(rd), "interval")) {
+			ret = stat_watch_get_u32(rd, "interval",
+						 &watch->interval);
+			if (ret)
+				return ret;
+			if (!watch->interval) {
+				pr_err("interval must be positive\n");
+				return -EINVAL;
+			}
+		} else if (!strcmpx(rd_argv(rd), "count")) {
+			ret = stat_watch_get_u32(rd, "count", &watch->count);
+			if (ret)
+				return ret;
+		} else if (!strcmpx(rd_argv(rd), "top")) {
+			ret = stat_watch_get_u32(rd, "top", &watch->top);
+			if (ret)
+				return ret;
+		} else if (!strcmpx(rd_argv(rd), "all")) {
+			watch->all = true;
+			rd_arg_inc(rd);
+		} else {
+			pr_err("Unknown parameter '%s'.\n", rd_argv(rd));
+			return -EINVAL;
+		}
+	}
+	return 0;
+}
+
+static uint64_t stat_watch_ms(const struct timespec *ts)
+{
+	return (uint64_t)ts->tv_sec * 1000 + ts->tv_nsec / 1000000;
+}
+
+static int stat_watch(struct rd *rd)
+{
+	struct stat_watch watch = {
+		.rd = rd,
+		.all_ports = true,
+		.interval = STAT_WATCH_INTERVAL_DEFAULT,
+	};
+	struct sigaction act = {}, oact;
+	struct timespec deadline, prev, now;
+	unsigned int samples = 0;
+	int ret;
+
+	INIT_LIST_HEAD(&watch.entries);
+	ret = stat_watch_parse(rd, &watch);
+	if (ret)
+		return ret;
+
+	/* One socket for the whole run instead of one per request. */
+	rd->nl = mnlu_socket_open(NETLINK_RDMA);
+	if (!rd->nl) {
+		pr_err("Failed to open NETLINK_RDMA socket\n");
+		return -ENODEV;
+	}
+
+	stat_watch_stop = 0;
+	act.sa_handler = stat_watch_sigint;
+	sigemptyset(&act.sa_mask);
+	sigaction(SIGINT, &act, &oact);
+
+	new_json_obj(rd->json_output);
+	clock_gettime(CLOCK_MONOTONIC, &deadline);
+	prev = deadline;
+	while (!stat_watch_stop) {
+		ret = stat_watch_sample(&watch);
+		if (ret) {
+			/* Ctrl-C while a sample was taken */
+			if (ret == -EINTR)
+				ret = 0;
+			break;
+		}
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		if (samples++) {
+			ret = stat_watch_print(&watch, stat_watch_ms(&now) -
+						       stat_watch_ms(&prev));
+			if (ret)
+				break;
+			if (watch.count && samples > watch.count)
+				break;
+		}
+		prev = now;
+
+		deadline.tv_sec += watch.interval / 1000;
+		deadline.tv_nsec += (watch.interval % 1000) * 1000000;
+		if (deadline.tv_nsec >= 1000000000) {
+			deadline.tv_sec++;
+			deadline.tv_nsec -= 1000000000;
+		}
+		while (!stat_watch_stop &&
+		       clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME,
+				       &deadline, NULL) == EINTR)
+			;
+	}
+	delete_json_obj();
+
+	sigaction(SIGINT, &oact, NULL);
+	mnl_socket_close(rd->nl);
+	rd->nl = NULL;
+	stat_watch_fini(&watch);
+	return ret;
+}
+
 int cmd_stat(struct rd *rd)
 {
 	const struct rd_cmd cmds[] =  {
 		{ NULL,		stat_show },
 		{ "show",	stat_show },
 		{ "list",	stat_show },
+		{ "watch",	stat_watch },
 		{ "help",	stat_help },
 		{ "qp",		stat_qp },
 		{ "mr",		stat_mr },
@@ -7,6 +7,7 @@
 #include "rdma.h"
 #include <ctype.h>
 #include <inttypes.h>
+#include <poll.h>
 
 int rd_argc(struct rd *rd)
 {
@@ -96,6 +97,19 @@ static int get_port_from_argv(struct rd *rd, uint32_t *port,
 	return 0;
 }
 
+struct dev_map *rd_link_lookup(struct rd *rd, uint32_t *port,
+			       bool *is_dump_all, bool strict_port)
+{
+	struct dev_map *dev_map;
+	int ret;
+
+	dev_map = dev_map_lookup(rd, true);
+	ret = get_port_from_argv(rd, port, is_dump_all, strict_port);
+	if (!dev_map || *port > dev_map->num_ports || (!*port && ret))
+		return NULL;
+	return dev_map;
+}
+
 static struct dev_map *dev_map_alloc(const char *dev_name)
 {
 	struct dev_map *dev_map;
@@ -119,11 +133,29 @@ static void dev_map_cleanup(struct rd *rd)
 	list_for_each_entry_safe(dev_map, tmp,
 				 &rd->dev_map_list, list) {
 		list_del(&dev_map->list);
+		hlist_del(&dev_map->hash);
 		free(dev_map->dev_name);
 		free(dev_map);
 	}
 }
 
+static unsigned int dev_map_hash(const char *dev_name, size_t len)
+{
+	unsigned int hash = 0;
+
+	while (len--)
+		hash = hash * 31 + (unsigned char)*dev_name++;
+	return hash % DEV_MAP_HASH_SIZE;
+}
+
+static void dev_map_add(struct rd *rd, struct dev_map *dev_map)
+{
+	list_add_tail(&dev_map->list, &rd->dev_map_list);
+	hlist_add_head(&dev_map->hash,
+		       &rd->dev_map_hash[dev_map_hash(dev_map->dev_name,
+						      strlen(dev_map->dev_name))]);
+}
+
 static int add_filter(struct rd *rd, char *key, char *value,
 		      const struct filters valid_filters[])
 {
@@ -515,10 +547,10 @@ int rd_dev_init_cb(const struct nlmsghdr *nlh, void *data)
 	if (!dev_map)
 		/* The main function will cleanup the allocations */
 		return MNL_CB_ERROR;
-	list_add_tail(&dev_map->list, &rd->dev_map_list);
 
 	dev_map->num_ports = mnl_attr_get_u32(tb[RDMA_NLDEV_ATTR_PORT_INDEX]);
 	dev_map->idx = mnl_attr_get_u32(tb[RDMA_NLDEV_ATTR_DEV_INDEX]);
+	dev_map_add(rd, dev_map);
 	return MNL_CB_OK;
 }
 
@@ -572,9 +604,8 @@ int rd_exec_link(struct rd *rd, int (*cb)(struct rd *rd), bool strict_port)
 	} else {
 		bool is_dump_all;
 
-		dev_map = dev_map_lookup(rd, true);
-		ret = get_port_from_argv(rd, &port, &is_dump_all, strict_port);
-		if (!dev_map || port > dev_map->num_ports || (!port && ret)) {
+		dev_map = rd_link_lookup(rd, &port, &is_dump_all, strict_port);
+		if (!dev_map) {
 			pr_err("Wrong device name\n");
 			ret = -ENOENT;
 			goto out;
@@ -629,6 +660,202 @@ out:
 	return ret;
 }
 
+/*
+ * Devices are dumped in parallel over a bounded set of sockets. A socket
+ * that finished the dump of one device is reused for the next one.
+ */
+#define RD_DUMP_SOCKETS_MAX	16
+
+struct rd_dump {
+	struct mnl_socket *nl;
+	unsigned int seq;
+};
+
+static int rd_dump_start(struct rd *rd, struct rd_dump *dump,
+			 struct dev_map *dev_map,
+			 uint32_t (*prepare)(struct rd *rd))
+{
+	int ret;
+
+	if (!dump->nl) {
+		dump->nl = mnlu_socket_open(NETLINK_RDMA);
+		if (!dump->nl) {
+			pr_err("Failed to open NETLINK_RDMA socket\n");
+			return -ENODEV;
+		}
+	}
+
+	rd->dev_idx = dev_map->idx;
+	dump->seq = prepare(rd);
+	ret = mnl_socket_sendto(dump->nl, rd->nlh, rd->nlh->nlmsg_len);
+	if (ret < 0) {
+		pr_err("Failed to send to socket with err %d\n", ret);
+		return ret;
+	}
+	return 0;
+}
+
+static void rd_dump_stop(struct rd_dump *dump)
+{
+	if (!dump->nl)
+		return;
+	mnl_socket_close(dump->nl);
+	dump->nl = NULL;
+}
+
+/*
+ * Messages are handled as they arrive, a message always carries complete
+ * objects, so lines never mix. A socket whose dump failed may still hold
+ * messages of it, so it is replaced rather than reused.
+ */
+static int rd_dump_run(struct rd *rd, struct dev_map **devs,
+		       unsigned int count, uint32_t (*prepare)(struct rd *rd),
+		       mnl_cb_t callback)
+{
+	char buf[MNL_SOCKET_BUFFER_SIZE];
+	struct pollfd pfds[RD_DUMP_SOCKETS_MAX];
+	struct rd_dump dumps[RD_DUMP_SOCKETS_MAX] = {};
+	unsigned int nsocks, pending = 0, next = 0;
+	unsigned int i;
+	int ret = 0;
+
+	nsocks = count < RD_DUMP_SOCKETS_MAX ? count : RD_DUMP_SOCKETS_MAX;
+	for (i = 0; i < nsocks; i++) {
+		ret = rd_dump_start(rd, &dumps[i], devs[next++], prepare);
+		if (ret)
+			goto out;
+		pfds[i].fd = mnl_socket_get_fd(dumps[i].nl);
+		pfds[i].events = POLLIN;
+		pending++;
+	}
+
+	while (pending) {
+		if (poll(pfds, nsocks, -1) < 0) {
+			if (errno == EINTR)
+				continue;
+			ret = -errno;
+			break;
+		}
+
+		for (i = 0; i < nsocks; i++) {
+			struct mnl_socket *nl = dumps[i].nl;
+			bool started;
+			int err;
+
+			if (pfds[i].fd < 0 || !pfds[i].revents)
+				continue;
+
+			err = mnl_socket_recvfrom(nl, buf, sizeof(buf));
+			if (err > 0)
+				err = mnlu_cb_run(buf, err, dumps[i].seq,
+						  mnl_socket_get_portid(nl),
+						  callback, rd);
+			if (err > 0)
+				continue;
+
+			if (err < 0) {
+				if (!rd->suppress_errors)
+					perror("error");
+				if (!ret)
+					ret = err;
+				rd_dump_stop(&dumps[i]);
+			}
+
+			started = false;
+			while (!started && next < count) {
+				err = rd_dump_start(rd, &dumps[i], devs[next++],
+						    prepare);
+				if (!err) {
+					started = true;
+				} else {
+					if (!ret)
+						ret = err;
+					rd_dump_stop(&dumps[i]);
+				}
+			}
+			if (started) {
+				pfds[i].fd = mnl_socket_get_fd(dumps[i].nl);
+				continue;
+			}
+			rd_dump_stop(&dumps[i]);
+			pfds[i].fd = -1;
+			pending--;
+		}
+	}
+
+out:
+	for (i = 0; i < nsocks; i++)
+		rd_dump_stop(&dumps[i]);
+	return ret;
+}
+
+/*
+ * Same device and port selection as rd_exec_link() and rd_exec_dev(),
+ * for object dumps. A dump without a port index returns the objects of
+ * all ports of the device at once, so the ports are not walked one by
+ * one, and all devices are dumped in parallel.
+ */
+int rd_exec_dump(struct rd *rd, uint32_t (*prepare)(struct rd *rd),
+		 mnl_cb_t callback, bool strict_port)
+{
+	struct dev_map **devs = NULL;
+	struct dev_map *dev_map;
+	unsigned int count = 0;
+	int ret = 0;
+
+	new_json_obj(rd->json_output);
+	if (rd_no_arg(rd)) {
+		list_for_each_entry(dev_map, &rd->dev_map_list, list)
+			count++;
+		if (!count)
+			goto out;
+
+		devs = calloc(count, sizeof(*devs));
+		if (!devs) {
+			ret = -ENOMEM;
+			goto out;
+		}
+
+		rd->port_idx = 0;
+		rd->dump_all_ports = true;
+		count = 0;
+		list_for_each_entry(dev_map, &rd->dev_map_list, list)
+			devs[count++] = dev_map;
+		ret = rd_dump_run(rd, devs, count, prepare, callback);
+	} else {
+		bool is_dump_all = false;
+		uint32_t port = 0;
+
+		if (strict_port) {
+			dev_map = dev_map_lookup(rd, false);
+			if (!dev_map) {
+				pr_err("Wrong device name - %s\n", rd_argv(rd));
+				ret = -ENOENT;
+				goto out;
+			}
+		} else {
+			dev_map = rd_link_lookup(rd, &port, &is_dump_all,
+						 strict_port);
+			if (!dev_map) {
+				pr_err("Wrong device name\n");
+				ret = -ENOENT;
+				goto out;
+			}
+		}
+		rd_arg_inc(rd);
+
+		rd->port_idx = port;
+		rd->dump_all_ports = is_dump_all;
+		ret = rd_dump_run(rd, &dev_map, 1, prepare, callback);
+	}
+
+out:
+	rd->dump_all_ports = false;
+	free(devs);
+	delete_json_obj();
+	return ret;
+}
+
 int rd_exec_require_dev(struct rd *rd, int (*cb)(struct rd *rd))
 {
 	if (rd_no_arg(rd)) {
@@ -718,36 +945,40 @@ int rd_sendrecv_msg(struct rd *rd, unsigned int seq)
 	return ret;
 }
 
-static struct dev_map *_dev_map_lookup(struct rd *rd, const char *dev_name)
+static struct dev_map *_dev_map_lookup(struct rd *rd, const char *dev_name,
+				       size_t len)
 {
 	struct dev_map *dev_map;
+	struct hlist_node *n;
 
-	list_for_each_entry(dev_map, &rd->dev_map_list, list)
-		if (strcmp(dev_name, dev_map->dev_name) == 0)
+	hlist_for_each(n, &rd->dev_map_hash[dev_map_hash(dev_name, len)]) {
+		dev_map = container_of(n, struct dev_map, hash);
+		if (strncmp(dev_name, dev_map->dev_name, len) == 0 &&
+		    dev_map->dev_name[len] == '\0')
 			return dev_map;
+	}
 
 	return NULL;
 }
 
 struct dev_map *dev_map_lookup(struct rd *rd, bool allow_port_index)
 {
-	struct dev_map *dev_map;
-	char *dev_name;
+	const char *dev_name;
 	char *slash;
+	size_t len;
 
 	if (rd_no_arg(rd))
 		return NULL;
 
-	dev_name = strdup(rd_argv(rd));
+	dev_name = rd_argv(rd);
+	len = strlen(dev_name);
 	if (allow_port_index) {
 		slash = strrchr(dev_name, '/');
 		if (slash)
-			*slash = '\0';
+			len = slash - dev_name;
 	}
 
-	dev_map = _dev_map_lookup(rd, dev_name);
-	free(dev_name);
-	return dev_map;
+	return _dev_map_lookup(rd, dev_name, len);
 }
 
 #define nla_type(attr) ((attr)->nla_type & NLA_TYPE_MASK)
@@ -845,10 +1076,15 @@ static int print_driver_entry(struct rd *rd, struct nlattr *key_attr,
 				enum rdma_nldev_print_type print_type)
 {
 	int attr_type = nla_type(val_attr);
+	char key_buf[64], *key_str = key_buf;
 	int ret = -EINVAL;
-	char *key_str;
+	int len;
 
-	if (asprintf(&key_str, "drv_%s", mnl_attr_get_str(key_attr)) == -1)
+	/* Printed for every object, allocate only for unusually long keys. */
+	len = snprintf(key_buf, sizeof(key_buf), "drv_%s",
+		       mnl_attr_get_str(key_attr));
+	if (len >= sizeof(key_buf) &&
+	    asprintf(&key_str, "drv_%s", mnl_attr_get_str(key_attr)) == -1)
 		return -ENOMEM;
 
 	switch (attr_type) {
@@ -873,7 +1109,8 @@ static int print_driver_entry(struct rd *rd, struct nlattr *key_attr,
 				       print_type);
 		break;
 	}
-	free(key_str);
+	if (key_str != key_buf)
+		free(key_str);
 	return ret;
 }
 
@@ -199,35 +199,45 @@ static void usage(void)
 	fprintf(stderr,
 		"Usage:	tc [ OPTIONS ] OBJECT { COMMAND | help }\n"
 		"	tc [-force] -batch filename\n"
+		"	tc -server socket\n"
 		"where  OBJECT := { qdisc | class | filter | chain |\n"
 		"		    action | monitor | exec }\n"
 		"       OPTIONS := { -V[ersion] | -s[tatistics] | -d[etails] | -r[aw] |\n"
-		"		    -o[neline] | -j[son] | -p[retty] | -c[olor]\n"
+		"		    -o[neline] | -j[son] | -cb[or] | -p[retty] | -c[olor]\n"
 		"		    -b[atch] [filename] | -n[etns] name | -N[umeric] |\n"
 		"		     -nm | -nam[es] | { -cf | -conf } path\n"
-		"		     -br[ief] }\n");
+		"		     -br[ief] | -rc[vbuf] [size] }\n");
 }
 
+static int do_help(int argc, char **argv)
+{
+	usage();
+	return 0;
+}
+
+static const struct cmd {
+	const char *cmd;
+	int (*func)(int argc, char **argv);
+} cmds[] = {
+	{ "qdisc",	do_qdisc },
+	{ "class",	do_class },
+	{ "filter",	do_filter },
+	{ "chain",	do_chain },
+	{ "actions",	do_action },
+	{ "monitor",	do_tcmonitor },
+	{ "exec",	do_exec },
+	{ "help",	do_help },
+	{ 0 }
+};
+
+static struct keyword_index cmds_index = KEYWORD_INDEX(cmds);
+
 static int do_cmd(int argc, char **argv)
 {
-	if (matches(*argv, "qdisc") == 0)
-		return do_qdisc(argc-1, argv+1);
-	if (matches(*argv, "class") == 0)
-		return do_class(argc-1, argv+1);
-	if (matches(*argv, "filter") == 0)
-		return do_filter(argc-1, argv+1);
-	if (matches(*argv, "chain") == 0)
-		return do_chain(argc-1, argv+1);
-	if (matches(*argv, "actions") == 0)
-		return do_action(argc-1, argv+1);
-	if (matches(*argv, "monitor") == 0)
-		return do_tcmonitor(argc-1, argv+1);
-	if (matches(*argv, "exec") == 0)
-		return do_exec(argc-1, argv+1);
-	if (matches(*argv, "help") == 0) {
-		usage();
-		return 0;
-	}
+	int i = keyword_lookup(&cmds_index, *argv);
+
+	if (i >= 0)
+		return cmds[i].func(argc-1, argv+1);
 
 	fprintf(stderr, "Object \"%s\" is unknown, try \"tc help\".\n",
 		*argv);
@@ -257,11 +267,29 @@ static int batch(const char *name)
 	return ret;
 }
 
+static int server_init(void *data)
+{
+	if (rtnl_open(&rth, 0) < 0) {
+		fprintf(stderr, "Cannot open rtnetlink\n");
+		return -1;
+	}
+	return 0;
+}
+
+static int server(const char *path)
+{
+	batch_mode = 1;
+	tc_core_init();
+
+	return do_server(path, server_init, tc_batch_cmd, NULL);
+}
+
 
 int main(int argc, char **argv)
 {
 	const char *libbpf_version;
 	char *batch_file = NULL;
+	char *server_path = NULL;
 	int ret;
 
 	while (argc > 1) {
@@ -297,6 +325,22 @@ int main(int argc, char **argv)
 			if (argc <= 1)
 				usage();
 			batch_file = argv[1];
+		} else if (matches(argv[1], "-server") == 0) {
+			argc--;	argv++;
+			if (argc <= 1)
+				usage();
+			server_path = argv[1];
+		} else if (matches(argv[1], "-rcvbuf") == 0) {
+			unsigned int size;
+
+			NEXT_ARG();
+			if (get_unsigned(&size, argv[1], 0)) {
+				fprintf(stderr, "Invalid rcvbuf size '%s'\n",
+					argv[1]);
+				return -1;
+			}
+			rcvbuf = size;
+			rcvbuf_force = 1;
 		} else if (matches(argv[1], "-netns") == 0) {
 			NEXT_ARG();
 			if (netns_switch(argv[1]))
@@ -311,6 +355,9 @@ int main(int argc, char **argv)
 			NEXT_ARG();
 			conf_file = argv[1];
 		} else if (matches_color(argv[1], &color)) {
+		} else if (matches(argv[1], "-cbor") == 0) {
+			++json;
+			cbor = 1;
 		} else if (matches(argv[1], "-timestamp") == 0) {
 			timestamp++;
 		} else if (matches(argv[1], "-tshort") == 0) {
@@ -338,6 +385,9 @@ int main(int argc, char **argv)
 	if (batch_file)
 		return batch(batch_file);
 
+	if (server_path)
+		return server(server_path);
+
 	if (argc <= 1) {
 		usage();
 		return 0;
@@ -29,7 +29,7 @@ static void usage(void) __attribute__((noreturn));
 
 static void usage(void)
 {
-	fprintf(stderr, "Usage: tc [-timestamp [-tshort] monitor\n");
+	fprintf(stderr, "Usage: tc [-timestamp [-tshort] monitor [ stats ]\n");
 	exit(-1);
 }
 
@@ -75,11 +75,15 @@ int do_tcmonitor(int argc, char **argv)
 	struct rtnl_handle rth;
 	char *file = NULL;
 	unsigned int groups = nl_mgrp(RTNLGRP_TC);
+	int lstats = 0;
+	int err;
 
 	while (argc > 0) {
 		if (matches(*argv, "file") == 0) {
 			NEXT_ARG();
 			file = *argv;
+		} else if (strcmp(*argv, "stats") == 0) {
+			lstats = 1;
 		} else {
 			if (matches(*argv, "help") == 0) {
 				usage();
@@ -100,7 +104,9 @@ int do_tcmonitor(int argc, char **argv)
 			exit(-1);
 		}
 
+		new_json_obj(json);
 		ret = rtnl_from_file(fp, accept_tcmsg, stdout);
+		delete_json_obj();
 		fclose(fp);
 		return ret;
 	}
@@ -110,7 +116,11 @@ int do_tcmonitor(int argc, char **argv)
 
 	ll_init_map(&rth);
 
-	if (rtnl_listen(&rth, accept_tcmsg, (void *)stdout) < 0) {
+	if (lstats)
+		err = rtnl_listen_counted(&rth, accept_tcmsg, (void *)stdout);
+	else
+		err = rtnl_listen(&rth, accept_tcmsg, (void *)stdout);
+	if (err < 0) {
 		rtnl_close(&rth);
 		exit(2);
 	}
@@ -0,0 +1,49 @@
+#!/bin/sh
+
+. lib/generic.sh
+
+ts_libiproute2()
+{
+	__ts_cmd "$LIBIPROUTE2_TEST" "$@"
+}
+
+ts_log "[Testing the libiproute2 API]"
+
+[ -x "$LIBIPROUTE2_TEST" ] || ts_skip
+
+NEW_DEV="$(rand_dev)"
+
+ts_ip "$0" "Add $NEW_DEV dummy interface" link add dev $NEW_DEV type dummy
+
+ts_libiproute2 "$0" "Set $NEW_DEV up" $NEW_DEV up
+ts_libiproute2 "$0" "Set $NEW_DEV mtu" $NEW_DEV mtu 1400
+ts_libiproute2 "$0" "Show $NEW_DEV" $NEW_DEV link
+test_on "link $NEW_DEV mtu 1400 up"
+
+ts_libiproute2 "$0" "Add address" $NEW_DEV address add 198.51.100.1/24
+ts_libiproute2 "$0" "Add IPv6 address" $NEW_DEV address add 2001:db8::1/64
+ts_libiproute2 "$0" "List addresses" $NEW_DEV address
+test_on "address 198.51.100.1/24"
+test_on "address 2001:db8::1/64"
+
+ts_libiproute2 "$0" "Add route" $NEW_DEV route add 203.0.113.0/24
+ts_ip "$0" "Show route" route show dev $NEW_DEV 203.0.113.0/24
+test_on "203.0.113.0/24"
+ts_libiproute2 "$0" "List routes" $NEW_DEV route
+test_on "route 203.0.113.0/24"
+ts_libiproute2 "$0" "Del route" $NEW_DEV route del 203.0.113.0/24
+ts_ip "$0" "Show route" route show dev $NEW_DEV 203.0.113.0/24
+test_lines_count 0
+
+ts_libiproute2 "$0" "Del address" $NEW_DEV address del 198.51.100.1/24
+ts_ip "$0" "Show addresses" -4 address show dev $NEW_DEV
+test_lines_count 0
+
+ts_tc "$0" "Add ingress qdisc" qdisc add dev $NEW_DEV ingress
+ts_libiproute2 "$0" "List qdiscs" $NEW_DEV qdisc
+test_on "qdisc ingress ffff: parent fffffff1"
+ts_libiproute2 "$0" "Del ingress qdisc" $NEW_DEV qdisc del ingress
+ts_tc "$0" "Show qdiscs" qdisc show dev $NEW_DEV ingress
+test_lines_count 0
+
+ts_ip "$0" "Del $NEW_DEV dummy interface" link del dev $NEW_DEV
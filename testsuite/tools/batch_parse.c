@@ -0,0 +1,158 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * batch_parse.c	Benchmark for the batch file reader and dispatcher
+ *
+ * Usage: batch_parse [ FILE ]
+ *
+ * Without a file, one million typical "ip -batch" lines are generated.
+ * Every line is read, split and its object word looked up, first with
+ * getcmdline() and a linear matches() walk, then with cmdline_read()
+ * and keyword_lookup().
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/mman.h>
+
+#include "utils.h"
+
+static const struct cmd {
+	const char *cmd;
+} cmds[] = {
+	{ "address" }, { "addrlabel" }, { "maddress" }, { "route" },
+	{ "rule" }, { "neighbor" }, { "neighbour" }, { "ntable" },
+	{ "ntbl" }, { "link" }, { "l2tp" }, { "fou" }, { "ila" },
+	{ "macsec" }, { "tunnel" }, { "tunl" }, { "tuntap" }, { "tap" },
+	{ "token" }, { "tcpmetrics" }, { "tcp_metrics" }, { "monitor" },
+	{ "xfrm" }, { "mroute" }, { "mrule" }, { "netns" }, { "netconf" },
+	{ "vrf" }, { "sr" }, { "nexthop" }, { "mptcp" }, { "help" },
+	{ 0 }
+};
+
+static const char * const sample[] = {
+	"route add 10.%u.%u.0/24 via 192.0.2.1 dev eth0 table %u\n",
+	"address add 198.51.%u.%u/32 dev lo label \"lo:%u\"\n",
+	"neigh replace 203.0.113.%u lladdr 02:00:00:00:%02x:%02x dev eth0 \\\n"
+	"\tnud permanent\n",
+	"# rule for tenant %u.%u.%u\n"
+	"rule add from 172.16.%u.0/24 lookup %u\n",
+	"nexthop add id %u via 192.0.2.%u dev eth0 # %u\n",
+};
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int generate(void)
+{
+	FILE *fp;
+	unsigned int i;
+	int fd;
+
+	fd = memfd_create("batch", 0);
+	if (fd < 0) {
+		perror("memfd_create");
+		exit(1);
+	}
+	fp = fdopen(dup(fd), "w");
+	for (i = 0; i < 1000000; i++)
+		fprintf(fp, sample[i % ARRAY_SIZE(sample)],
+			(i >> 8) & 255, i & 255, i % 4000 + 1);
+	fclose(fp);
+	return fd;
+}
+
+static unsigned long run_getcmdline(int fd)
+{
+	unsigned long sum = 0;
+	char *line = NULL;
+	size_t len = 0;
+	FILE *fp;
+
+	lseek(fd, 0, SEEK_SET);
+	fp = fdopen(dup(fd), "r");
+	while (getcmdline(&line, &len, fp) != -1) {
+		char *largv[100];
+		const struct cmd *c;
+		int largc;
+
+		largc = makeargs(line, largv, 100);
+		if (!largc)
+			continue;
+		for (c = cmds; c->cmd; c++) {
+			if (matches(largv[0], c->cmd) == 0)
+				break;
+		}
+		sum += (c - cmds) + largc;
+	}
+	free(line);
+	fclose(fp);
+	return sum;
+}
+
+static unsigned long run_reader(int fd)
+{
+	static struct keyword_index index = KEYWORD_INDEX(cmds);
+	struct cmdline_reader reader;
+	unsigned long sum = 0;
+	char *line;
+
+	lseek(fd, 0, SEEK_SET);
+	cmdline_reader_init(&reader, fd);
+	while ((line = cmdline_read(&reader)) != NULL) {
+		char *largv[100];
+		int largc, i;
+
+		largc = makeargs(line, largv, 100);
+		if (!largc)
+			continue;
+		i = keyword_lookup(&index, largv[0]);
+		sum += (i < 0 ? ARRAY_SIZE(cmds) - 1 : i) + largc;
+	}
+	cmdline_reader_free(&reader);
+	return sum;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long sum1, sum2;
+	double t0, t1;
+	int fd;
+
+	if (argc > 1) {
+		fd = open(argv[1], O_RDONLY);
+		if (fd < 0) {
+			perror(argv[1]);
+			return 1;
+		}
+	} else {
+		fd = generate();
+	}
+
+	cmdlineno = 0;
+	t0 = now();
+	sum1 = run_getcmdline(fd);
+	t1 = now();
+	printf("getcmdline:   %7.3f s, %d lines\n", t1 - t0, cmdlineno);
+
+	cmdlineno = 0;
+	t0 = now();
+	sum2 = run_reader(fd);
+	t1 = now();
+	printf("cmdline_read: %7.3f s, %d lines\n", t1 - t0, cmdlineno);
+
+	if (sum1 != sum2) {
+		fprintf(stderr, "Results differ: %lu != %lu\n", sum1, sum2);
+		return 1;
+	}
+	return 0;
+}
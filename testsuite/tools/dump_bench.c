@@ -0,0 +1,439 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * dump_bench.c		Synthetic netlink dumps for printer benchmarks
+ *
+ * Usage: dump_bench gen { route | link | fdb | flower | sock } COUNT [ VFS ]
+ *	  dump_bench run LABEL COUNT COMMAND [ ARGS ]
+ *
+ * "gen" writes COUNT objects as raw netlink messages to stdout, in the
+ * format read back by "ip monitor file", "bridge monitor file", "tc monitor
+ * file" and ss with TCPDIAG_FILE. Objects refer to links which are either
+ * part of the dump or exist everywhere (lo), so replaying does not depend
+ * on the host. "run" executes a replay with its output discarded and
+ * reports messages per second and the peak RSS of the command.
+ */
+
+#include <arpa/inet.h>
+#include <libnetlink.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <linux/if.h>
+#include <linux/if_arp.h>
+#include <linux/if_ether.h>
+#include <linux/pkt_sched.h>
+#include <linux/pkt_cls.h>
+#include <linux/tc_act/tc_gact.h>
+#include <linux/inet_diag.h>
+#include <linux/sock_diag.h>
+#include <linux/tcp.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MSG_BUFLEN	65536
+
+/* Links referenced by the generated routes and FDB entries */
+#define BENCH_IFINDEX	1000
+#define BENCH_NLINKS	4
+
+/* TCP_ESTABLISHED, the kernel's socket states are not in a uapi header */
+#define BENCH_TCP_ESTABLISHED	1
+
+static char buf[MSG_BUFLEN];
+
+#define ATTR_L(t, v, l)	addattr_l(h, MSG_BUFLEN, t, v, l)
+#define ATTR_8(t, v)	addattr8(h, MSG_BUFLEN, t, v)
+#define ATTR_16(t, v)	addattr16(h, MSG_BUFLEN, t, v)
+#define ATTR_32(t, v)	addattr32(h, MSG_BUFLEN, t, v)
+#define ATTR_64(t, v)	addattr64(h, MSG_BUFLEN, t, v)
+#define ATTR_STRZ(t, v)	addattrstrz(h, MSG_BUFLEN, t, v)
+#define NEST(t)		addattr_nest(h, MSG_BUFLEN, t)
+#define NEST_END(t)	addattr_nest_end(h, t)
+
+static struct nlmsghdr *msg_start(int type, int hdrlen)
+{
+	struct nlmsghdr *h = (struct nlmsghdr *)buf;
+
+	memset(buf, 0, NLMSG_SPACE(hdrlen));
+	h->nlmsg_type = type;
+	h->nlmsg_flags = NLM_F_MULTI;
+	h->nlmsg_len = NLMSG_LENGTH(hdrlen);
+	return h;
+}
+
+static void msg_emit(struct nlmsghdr *h)
+{
+	if (fwrite(h, NLMSG_ALIGN(h->nlmsg_len), 1, stdout) != 1) {
+		perror("fwrite");
+		exit(1);
+	}
+}
+
+static void gen_mac(unsigned char *mac, unsigned int id)
+{
+	mac[0] = 0x02;
+	mac[1] = id >> 24;
+	mac[2] = id >> 16;
+	mac[3] = id >> 8;
+	mac[4] = id;
+	mac[5] = 0x01;
+}
+
+static void gen_vf(struct nlmsghdr *h, unsigned int link, unsigned int vf)
+{
+	struct ifla_vf_mac vf_mac = { .vf = vf };
+	struct ifla_vf_vlan vf_vlan = { .vf = vf, .vlan = vf + 1 };
+	struct ifla_vf_tx_rate vf_tx_rate = { .vf = vf };
+	struct ifla_vf_rate vf_rate = { .vf = vf, .max_tx_rate = 10000 };
+	struct ifla_vf_spoofchk vf_spoofchk = { .vf = vf, .setting = 1 };
+	struct ifla_vf_link_state vf_link_state = { .vf = vf };
+	struct ifla_vf_trust vf_trust = { .vf = vf };
+	struct rtattr *vfinfo, *vfstats;
+
+	gen_mac(vf_mac.mac, link << 8 | vf);
+
+	vfinfo = NEST(IFLA_VF_INFO);
+	ATTR_L(IFLA_VF_MAC, &vf_mac, sizeof(vf_mac));
+	ATTR_L(IFLA_VF_VLAN, &vf_vlan, sizeof(vf_vlan));
+	ATTR_L(IFLA_VF_TX_RATE, &vf_tx_rate, sizeof(vf_tx_rate));
+	ATTR_L(IFLA_VF_RATE, &vf_rate, sizeof(vf_rate));
+	ATTR_L(IFLA_VF_SPOOFCHK, &vf_spoofchk, sizeof(vf_spoofchk));
+	ATTR_L(IFLA_VF_LINK_STATE, &vf_link_state, sizeof(vf_link_state));
+	ATTR_L(IFLA_VF_TRUST, &vf_trust, sizeof(vf_trust));
+
+	vfstats = NEST(IFLA_VF_STATS);
+	ATTR_64(IFLA_VF_STATS_RX_PACKETS, 1000 + vf);
+	ATTR_64(IFLA_VF_STATS_TX_PACKETS, 2000 + vf);
+	ATTR_64(IFLA_VF_STATS_RX_BYTES, 100000 + vf);
+	ATTR_64(IFLA_VF_STATS_TX_BYTES, 200000 + vf);
+	ATTR_64(IFLA_VF_STATS_BROADCAST, vf);
+	ATTR_64(IFLA_VF_STATS_MULTICAST, vf);
+	NEST_END(vfstats);
+
+	NEST_END(vfinfo);
+}
+
+static void gen_link(unsigned int ifindex, const char *name, int master,
+		     unsigned int nvfs)
+{
+	unsigned char bcmac[ETH_ALEN] = { 0xff, 0xff, 0xff, 0xff, 0xff, 0xff };
+	struct rtnl_link_stats64 stats = {
+		.rx_packets = ifindex * 10ULL,
+		.tx_packets = ifindex * 20ULL,
+		.rx_bytes = ifindex * 1500ULL,
+		.tx_bytes = ifindex * 3000ULL,
+	};
+	unsigned char mac[ETH_ALEN];
+	struct rtattr *vfinfo_list;
+	struct ifinfomsg *ifi;
+	struct nlmsghdr *h;
+	unsigned int vf;
+
+	h = msg_start(RTM_NEWLINK, sizeof(*ifi));
+	ifi = NLMSG_DATA(h);
+	ifi->ifi_type = ARPHRD_ETHER;
+	ifi->ifi_index = ifindex;
+	ifi->ifi_flags = IFF_RUNNING | IFF_BROADCAST |
+			 IFF_MULTICAST | IFF_UP | IFF_LOWER_UP;
+
+	gen_mac(mac, ifindex);
+
+	ATTR_STRZ(IFLA_IFNAME, name);
+	ATTR_32(IFLA_TXQLEN, 1000);
+	ATTR_8(IFLA_OPERSTATE, IF_OPER_UP);
+	ATTR_8(IFLA_LINKMODE, 0);
+	ATTR_32(IFLA_MTU, 1500);
+	ATTR_32(IFLA_MIN_MTU, 68);
+	ATTR_32(IFLA_MAX_MTU, 9000);
+	ATTR_32(IFLA_GROUP, 0);
+	ATTR_32(IFLA_PROMISCUITY, 0);
+	ATTR_32(IFLA_NUM_TX_QUEUES, 8);
+	ATTR_32(IFLA_NUM_RX_QUEUES, 8);
+	ATTR_32(IFLA_GSO_MAX_SEGS, 65535);
+	ATTR_32(IFLA_GSO_MAX_SIZE, 65536);
+	ATTR_8(IFLA_CARRIER, 1);
+	ATTR_32(IFLA_CARRIER_CHANGES, 2);
+	ATTR_STRZ(IFLA_QDISC, "mq");
+	if (master)
+		ATTR_32(IFLA_MASTER, master);
+	ATTR_L(IFLA_ADDRESS, mac, ETH_ALEN);
+	ATTR_L(IFLA_BROADCAST, bcmac, ETH_ALEN);
+	ATTR_L(IFLA_STATS64, &stats, sizeof(stats));
+
+	if (nvfs) {
+		ATTR_32(IFLA_NUM_VF, nvfs);
+		vfinfo_list = NEST(IFLA_VFINFO_LIST);
+		for (vf = 0; vf < nvfs; vf++)
+			gen_vf(h, ifindex, vf);
+		NEST_END(vfinfo_list);
+	}
+
+	msg_emit(h);
+}
+
+static void gen_bench_links(void)
+{
+	char name[IFNAMSIZ];
+	unsigned int i;
+
+	gen_link(BENCH_IFINDEX, "br0", 0, 0);
+	for (i = 1; i <= BENCH_NLINKS; i++) {
+		snprintf(name, sizeof(name), "eth%u", i - 1);
+		gen_link(BENCH_IFINDEX + i, name, BENCH_IFINDEX, 0);
+	}
+}
+
+static void gen_links(unsigned long count, unsigned int nvfs)
+{
+	char name[IFNAMSIZ];
+	unsigned long i;
+
+	for (i = 0; i < count; i++) {
+		snprintf(name, sizeof(name), "ens%lu", i);
+		gen_link(BENCH_IFINDEX + i, name, 0, nvfs);
+	}
+}
+
+static void gen_routes(unsigned long count)
+{
+	struct nlmsghdr *h;
+	struct rtmsg *r;
+	unsigned long i;
+
+	gen_bench_links();
+
+	for (i = 0; i < count; i++) {
+		__u32 dst = htonl(0x0a000000 | (i << 8));
+		__u32 gw = htonl(0xc0000200 | (i % 250 + 1));
+		int oif = BENCH_IFINDEX + 1 + i % BENCH_NLINKS;
+
+		h = msg_start(RTM_NEWROUTE, sizeof(*r));
+		r = NLMSG_DATA(h);
+		r->rtm_family = AF_INET;
+		r->rtm_dst_len = 24;
+		r->rtm_table = RT_TABLE_MAIN;
+		r->rtm_protocol = RTPROT_BGP;
+		r->rtm_scope = RT_SCOPE_UNIVERSE;
+		r->rtm_type = RTN_UNICAST;
+
+		ATTR_32(RTA_TABLE, RT_TABLE_MAIN);
+		ATTR_L(RTA_DST, &dst, sizeof(dst));
+		ATTR_32(RTA_PRIORITY, 20);
+		ATTR_L(RTA_GATEWAY, &gw, sizeof(gw));
+		ATTR_32(RTA_OIF, oif);
+		msg_emit(h);
+	}
+}
+
+static void gen_fdb(unsigned long count)
+{
+	struct nda_cacheinfo ci = { .ndm_used = 10, .ndm_updated = 20 };
+	unsigned char mac[ETH_ALEN];
+	struct nlmsghdr *h;
+	struct ndmsg *ndm;
+	unsigned long i;
+
+	gen_bench_links();
+
+	for (i = 0; i < count; i++) {
+		h = msg_start(RTM_NEWNEIGH, sizeof(*ndm));
+		ndm = NLMSG_DATA(h);
+		ndm->ndm_family = AF_BRIDGE;
+		ndm->ndm_ifindex = BENCH_IFINDEX + 1 + i % BENCH_NLINKS;
+		ndm->ndm_state = NUD_REACHABLE;
+		ndm->ndm_flags = NTF_MASTER;
+
+		gen_mac(mac, i);
+		ATTR_L(NDA_LLADDR, mac, ETH_ALEN);
+		ATTR_32(NDA_MASTER, BENCH_IFINDEX);
+		ATTR_16(NDA_VLAN, i % 4094 + 1);
+		ATTR_L(NDA_CACHEINFO, &ci, sizeof(ci));
+		msg_emit(h);
+	}
+}
+
+static void gen_flower(unsigned long count)
+{
+	struct tc_gact gact = {
+		.index = 1,
+		.action = TC_ACT_SHOT,
+		.refcnt = 1,
+		.bindcnt = 1,
+	};
+	struct rtattr *opts, *acts, *act, *aopts;
+	struct nlmsghdr *h;
+	struct tcmsg *t;
+	unsigned long i;
+
+	for (i = 0; i < count; i++) {
+		__u32 dst = htonl(0xc6120000 | (i & 0xffff));
+		__u32 mask = htonl(0xffffffff);
+
+		h = msg_start(RTM_NEWTFILTER, sizeof(*t));
+		t = NLMSG_DATA(h);
+		t->tcm_family = AF_UNSPEC;
+		t->tcm_ifindex = 1;
+		t->tcm_handle = i + 1;
+		t->tcm_parent = TC_H_MAKE(TC_H_CLSACT, TC_H_MIN_INGRESS);
+		t->tcm_info = TC_H_MAKE(1 << 16, htons(ETH_P_IP));
+
+		ATTR_STRZ(TCA_KIND, "flower");
+		ATTR_32(TCA_CHAIN, 0);
+
+		opts = NEST(TCA_OPTIONS);
+		ATTR_16(TCA_FLOWER_KEY_ETH_TYPE, htons(ETH_P_IP));
+		ATTR_8(TCA_FLOWER_KEY_IP_PROTO, IPPROTO_TCP);
+		ATTR_L(TCA_FLOWER_KEY_IPV4_DST, &dst, sizeof(dst));
+		ATTR_L(TCA_FLOWER_KEY_IPV4_DST_MASK, &mask, sizeof(mask));
+		ATTR_16(TCA_FLOWER_KEY_TCP_DST, htons(i % 65535 + 1));
+		ATTR_32(TCA_FLOWER_FLAGS, TCA_CLS_FLAGS_NOT_IN_HW);
+
+		acts = NEST(TCA_FLOWER_ACT);
+		act = NEST(1);
+		ATTR_STRZ(TCA_ACT_KIND, "gact");
+		aopts = NEST(TCA_ACT_OPTIONS);
+		ATTR_L(TCA_GACT_PARMS, &gact, sizeof(gact));
+		NEST_END(aopts);
+		NEST_END(act);
+		NEST_END(acts);
+		NEST_END(opts);
+		msg_emit(h);
+	}
+}
+
+static void gen_socks(unsigned long count)
+{
+	struct tcp_info info = {
+		.tcpi_state = BENCH_TCP_ESTABLISHED,
+		.tcpi_options = TCPI_OPT_TIMESTAMPS | TCPI_OPT_SACK,
+		.tcpi_rto = 204000,
+		.tcpi_ato = 40000,
+		.tcpi_snd_mss = 1448,
+		.tcpi_rcv_mss = 1448,
+		.tcpi_rtt = 1500,
+		.tcpi_rttvar = 700,
+		.tcpi_snd_cwnd = 10,
+		.tcpi_advmss = 1448,
+		.tcpi_rcv_space = 14480,
+	};
+	__u32 skmeminfo[SK_MEMINFO_VARS] = { 0 };
+	struct inet_diag_msg *r;
+	struct nlmsghdr *h;
+	unsigned long i;
+
+	for (i = 0; i < count; i++) {
+		h = msg_start(SOCK_DIAG_BY_FAMILY, sizeof(*r));
+		r = NLMSG_DATA(h);
+		r->idiag_family = AF_INET;
+		r->idiag_state = BENCH_TCP_ESTABLISHED;
+		r->id.idiag_sport = htons(443);
+		r->id.idiag_dport = htons(i % 64511 + 1024);
+		r->id.idiag_src[0] = htonl(0xc0000202);
+		r->id.idiag_dst[0] = htonl(0x0a000000 | (i >> 6));
+		r->id.idiag_cookie[0] = i;
+		r->idiag_uid = 0;
+		r->idiag_inode = 100000 + i;
+
+		ATTR_L(INET_DIAG_INFO, &info, sizeof(info));
+		ATTR_STRZ(INET_DIAG_CONG, "cubic");
+		ATTR_L(INET_DIAG_SKMEMINFO, skmeminfo, sizeof(skmeminfo));
+		msg_emit(h);
+	}
+
+	h = msg_start(NLMSG_DONE, sizeof(int));
+	msg_emit(h);
+}
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int run(const char *label, unsigned long count, char **argv)
+{
+	struct rusage ru;
+	double start, elapsed;
+	int status, fd;
+	pid_t pid;
+
+	start = now();
+	pid = fork();
+	if (pid < 0) {
+		perror("fork");
+		return 1;
+	}
+	if (pid == 0) {
+		fd = open("/dev/null", O_WRONLY);
+		if (fd < 0 || dup2(fd, STDOUT_FILENO) < 0) {
+			perror("/dev/null");
+			_exit(127);
+		}
+		execvp(argv[0], argv);
+		perror(argv[0]);
+		_exit(127);
+	}
+
+	if (wait4(pid, &status, 0, &ru) < 0) {
+		perror("wait4");
+		return 1;
+	}
+	elapsed = now() - start;
+
+	printf("%-24s %10lu msgs %8.3f s %12.0f msgs/s %8ld KiB max RSS%s\n",
+	       label, count, elapsed, count / elapsed, ru.ru_maxrss,
+	       WIFEXITED(status) && WEXITSTATUS(status) == 0 ? "" :
+	       " (failed)");
+	return 0;
+}
+
+static void usage(void)
+{
+	fprintf(stderr,
+		"Usage: dump_bench gen { route | link | fdb | flower | sock } COUNT [ VFS ]\n"
+		"       dump_bench run LABEL COUNT COMMAND [ ARGS ]\n");
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long count;
+
+	if (argc < 4)
+		usage();
+	count = strtoul(argv[3], NULL, 0);
+
+	if (strcmp(argv[1], "run") == 0) {
+		if (argc < 5)
+			usage();
+		return run(argv[2], count, argv + 4);
+	}
+	if (strcmp(argv[1], "gen") != 0)
+		usage();
+
+	if (strcmp(argv[2], "route") == 0)
+		gen_routes(count);
+	else if (strcmp(argv[2], "link") == 0)
+		gen_links(count, argc > 4 ? strtoul(argv[4], NULL, 0) : 0);
+	else if (strcmp(argv[2], "fdb") == 0)
+		gen_fdb(count);
+	else if (strcmp(argv[2], "flower") == 0)
+		gen_flower(count);
+	else if (strcmp(argv[2], "sock") == 0)
+		gen_socks(count);
+	else
+		usage();
+
+	if (fflush(stdout)) {
+		perror("fflush");
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,54 @@
+#!/bin/sh
+# SPDX-License-Identifier: GPL-2.0
+#
+# Replay large synthetic dumps through the printers of ip, bridge, tc and ss
+# in text and JSON mode and report messages per second and peak RSS. No
+# kernel state is touched, so this runs unprivileged.
+#
+# Sizes can be overridden from the environment, e.g.
+#	ROUTES=100000 LINKS=10000 ./dump_bench.sh
+
+TOOLS=$(dirname "$0")
+TOP=$TOOLS/../..
+BENCH=$TOOLS/dump_bench
+
+ROUTES=${ROUTES:-1000000}
+LINKS=${LINKS:-100000}
+VFS=${VFS:-4}
+FDB=${FDB:-1000000}
+FILTERS=${FILTERS:-100000}
+SOCKS=${SOCKS:-1000000}
+
+TMP=$(mktemp -d /tmp/dump_bench.XXXXXX) || exit 1
+trap 'rm -rf "$TMP"' EXIT
+
+$BENCH gen route $ROUTES > "$TMP/route" || exit 1
+$BENCH run "ip route" $ROUTES $TOP/ip/ip monitor file "$TMP/route"
+$BENCH run "ip -j route" $ROUTES $TOP/ip/ip -j monitor file "$TMP/route"
+rm -f "$TMP/route"
+
+$BENCH gen link $LINKS $VFS > "$TMP/link" || exit 1
+$BENCH run "ip -d -s link" $LINKS $TOP/ip/ip -d -s monitor file "$TMP/link"
+$BENCH run "ip -j -d -s link" $LINKS \
+	$TOP/ip/ip -j -d -s monitor file "$TMP/link"
+rm -f "$TMP/link"
+
+$BENCH gen fdb $FDB > "$TMP/fdb" || exit 1
+$BENCH run "bridge fdb" $FDB $TOP/bridge/bridge monitor file "$TMP/fdb"
+$BENCH run "bridge -j fdb" $FDB $TOP/bridge/bridge -j monitor file "$TMP/fdb"
+rm -f "$TMP/fdb"
+
+if [ -x $TOP/tc/tc ]; then
+	$BENCH gen flower $FILTERS > "$TMP/flower" || exit 1
+	$BENCH run "tc flower" $FILTERS $TOP/tc/tc monitor file "$TMP/flower"
+	$BENCH run "tc -j flower" $FILTERS \
+		$TOP/tc/tc -j monitor file "$TMP/flower"
+	rm -f "$TMP/flower"
+else
+	echo "tc not built, skipping flower filters"
+fi
+
+# ss has no JSON output
+$BENCH gen sock $SOCKS > "$TMP/sock" || exit 1
+TCPDIAG_FILE="$TMP/sock" $BENCH run "ss -tni" $SOCKS $TOP/misc/ss -tni
+TCPDIAG_FILE="$TMP/sock" $BENCH run "ss -tanie" $SOCKS $TOP/misc/ss -tanie
@@ -0,0 +1,165 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * libiproute2_test.c	Drives the libiproute2 API for the test suite
+ *
+ * Usage: libiproute2_test DEV { link | up | mtu MTU |
+ *			       address | address { add | del } PREFIX |
+ *			       route | route { add | del } PREFIX |
+ *			       qdisc | qdisc del ingress }
+ *
+ * Objects of DEV are printed one per line, failures go to stderr with
+ * the message kept in the context.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <net/if.h>
+#include <sys/socket.h>
+#include <linux/pkt_sched.h>
+
+#include "libiproute2.h"
+
+static int ifindex;
+
+static int print_link(const struct ipr2_link *link, void *data)
+{
+	printf("link %s mtu %u %s\n", link->name, link->mtu,
+	       link->flags & IFF_UP ? "up" : "down");
+	return 0;
+}
+
+static int print_address(const struct ipr2_address *addr, void *data)
+{
+	char buf[64];
+
+	if (addr->ifindex != ifindex)
+		return 0;
+	printf("address %s/%d\n",
+	       ipr2_addr_ntop(addr->local.len ? &addr->local : &addr->address,
+			      buf, sizeof(buf)),
+	       addr->prefixlen);
+	return 0;
+}
+
+static int print_route(const struct ipr2_route *route, void *data)
+{
+	char buf[64];
+
+	if (route->oif != ifindex || route->table != 254)
+		return 0;
+	printf("route %s/%d\n",
+	       route->dst.len ? ipr2_addr_ntop(&route->dst, buf, sizeof(buf)) :
+				"default",
+	       route->dst_len);
+	return 0;
+}
+
+static int print_qdisc(const struct ipr2_qdisc *qdisc, void *data)
+{
+	printf("qdisc %s %x: parent %x\n", qdisc->kind, qdisc->handle >> 16,
+	       qdisc->parent);
+	return 0;
+}
+
+static int modify(const char *op, enum ipr2_op *iop)
+{
+	if (strcmp(op, "add") == 0)
+		*iop = IPR2_ADD;
+	else if (strcmp(op, "del") == 0)
+		*iop = IPR2_DEL;
+	else
+		return -EINVAL;
+	return 0;
+}
+
+static int run(struct ipr2_ctx *ctx, int argc, char **argv)
+{
+	const char *obj = argv[0];
+	enum ipr2_op op;
+	int plen;
+
+	if (strcmp(obj, "link") == 0)
+		return ipr2_link_get(ctx, argv[-1], print_link, NULL);
+	if (strcmp(obj, "up") == 0)
+		return ipr2_link_set_up(ctx, ifindex, true);
+	if (strcmp(obj, "mtu") == 0 && argc == 2)
+		return ipr2_link_set_mtu(ctx, ifindex, atoi(argv[1]));
+
+	if (strcmp(obj, "address") == 0) {
+		struct ipr2_address addr = { .ifindex = ifindex };
+
+		if (argc == 1)
+			return ipr2_address_dump(ctx, AF_UNSPEC, print_address,
+						 NULL);
+		if (argc != 3 || modify(argv[1], &op) ||
+		    ipr2_parse_addr(argv[2], AF_UNSPEC, &addr.local, &plen))
+			return -EINVAL;
+		addr.family = addr.local.family;
+		addr.prefixlen = plen;
+		return ipr2_address_modify(ctx, op, &addr);
+	}
+
+	if (strcmp(obj, "route") == 0) {
+		struct ipr2_route route = { .oif = ifindex };
+
+		if (argc == 1)
+			return ipr2_route_dump(ctx, AF_UNSPEC, print_route,
+					       NULL);
+		if (argc != 3 || modify(argv[1], &op) ||
+		    ipr2_parse_addr(argv[2], AF_UNSPEC, &route.dst, &plen))
+			return -EINVAL;
+		route.family = route.dst.family;
+		route.dst_len = plen;
+		return ipr2_route_modify(ctx, op, &route);
+	}
+
+	if (strcmp(obj, "qdisc") == 0) {
+		struct ipr2_qdisc qdisc = {
+			.ifindex = ifindex,
+			.parent = TC_H_INGRESS,
+		};
+
+		if (argc == 1)
+			return ipr2_qdisc_dump(ctx, ifindex, print_qdisc, NULL);
+		if (argc != 3 || strcmp(argv[1], "del") ||
+		    strcmp(argv[2], "ingress"))
+			return -EINVAL;
+		return ipr2_qdisc_del(ctx, &qdisc);
+	}
+
+	return -EINVAL;
+}
+
+int main(int argc, char **argv)
+{
+	struct ipr2_ctx *ctx;
+	int err;
+
+	if (argc < 3) {
+		fprintf(stderr, "Usage: libiproute2_test DEV OBJECT [ ARGS ]\n");
+		return 1;
+	}
+
+	ctx = ipr2_open();
+	if (!ctx) {
+		perror("ipr2_open");
+		return 1;
+	}
+
+	ifindex = ipr2_link_index(ctx, argv[1]);
+	if (ifindex < 0) {
+		fprintf(stderr, "%s: %s\n", argv[1], strerror(-ifindex));
+		err = ifindex;
+	} else {
+		err = run(ctx, argc - 2, argv + 2);
+		if (err == -EINVAL && !*ipr2_errmsg(ctx))
+			fprintf(stderr, "invalid arguments\n");
+		else if (err < 0)
+			fprintf(stderr, "%s: %s\n", argv[2], ipr2_errmsg(ctx));
+	}
+
+	ipr2_close(ctx);
+	return err < 0;
+}